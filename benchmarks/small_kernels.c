@@ -0,0 +1,132 @@
+#include "jellyfish.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+  Timing driver for benchmarks/small_kernels.py.
+
+  For each length given on the command line it builds PAIRS string pairs of
+  that length (random lower-case words, the second a copy of the first with
+  about one edit in four characters) and prints one line per metric:
+
+      <metric> <length> <nanoseconds per call>
+
+  The script links it once as is and once with JFISH_NO_SMALL_KERNELS, so
+  the same lengths run through the fixed-size kernels and the generic path.
+*/
+
+#define PAIRS 256
+#define MIN_SECONDS 0.1
+#define ROUNDS 3
+
+static volatile double sink;
+
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+static void make_pair(JFISH_UNICODE *a, JFISH_UNICODE *b, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        a[i] = 'a' + rand() % 26;
+        b[i] = rand() % 4 ? a[i] : (JFISH_UNICODE)('a' + rand() % 26);
+    }
+}
+
+
+static double run(int metric, JFISH_UNICODE **a, JFISH_UNICODE **b, int len, long reps)
+{
+    double total = 0;
+    long r;
+    int i;
+
+    for (r = 0; r < reps; r++) {
+        for (i = 0; i < PAIRS; i++) {
+            switch (metric) {
+            case 0:
+                total += levenshtein_distance(a[i], len, b[i], len);
+                break;
+            case 1:
+                total += damerau_levenshtein_distance(a[i], b[i], len, len);
+                break;
+            default:
+                total += jaro_winkler_similarity(a[i], len, b[i], len, 0);
+                break;
+            }
+        }
+    }
+    return total;
+}
+
+
+/* Best of ROUNDS runs of at least MIN_SECONDS each, in ns per call. */
+static double time_metric(int metric, JFISH_UNICODE **a, JFISH_UNICODE **b, int len)
+{
+    double start, elapsed, best;
+    long reps = 1;
+    int round;
+
+    for (;;) {
+        start = now();
+        sink = run(metric, a, b, len, reps);
+        elapsed = now() - start;
+        if (elapsed >= MIN_SECONDS) {
+            break;
+        }
+        reps *= 2;
+    }
+    best = elapsed;
+    for (round = 1; round < ROUNDS; round++) {
+        start = now();
+        sink = run(metric, a, b, len, reps);
+        elapsed = now() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best * 1e9 / ((double)reps * PAIRS);
+}
+
+
+int main(int argc, char **argv)
+{
+    static const char *names[] = {"levenshtein", "damerau_levenshtein", "jaro_winkler"};
+    JFISH_UNICODE *a[PAIRS], *b[PAIRS];
+    int arg, len, metric, i;
+
+    srand(1);
+    for (arg = 1; arg < argc; arg++) {
+        len = atoi(argv[arg]);
+        if (len < 1) {
+            fprintf(stderr, "bad length: %s\n", argv[arg]);
+            return 1;
+        }
+        for (i = 0; i < PAIRS; i++) {
+            a[i] = safe_malloc(len, sizeof(JFISH_UNICODE));
+            b[i] = safe_malloc(len, sizeof(JFISH_UNICODE));
+            if (!a[i] || !b[i]) {
+                fprintf(stderr, "out of memory\n");
+                return 1;
+            }
+            make_pair(a[i], b[i], len);
+        }
+        for (metric = 0; metric < 3; metric++) {
+            printf("%s %d %.1f\n", names[metric], len, time_metric(metric, a, b, len));
+            fflush(stdout);
+        }
+        for (i = 0; i < PAIRS; i++) {
+            free(a[i]);
+            free(b[i]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+"""
+Time the fixed-size Levenshtein, Damerau-Levenshtein and Jaro-Winkler
+kernels against the generic path they stand in for.
+
+small_kernels.c is linked against the library twice, once as is and once
+with JFISH_NO_SMALL_KERNELS, and both builds time the same string pairs.
+Lengths 8, 16 and 32 sit on the dispatch thresholds; the other defaults
+fall between them, and 40 is past them, so both builds should agree there.
+
+    python3 benchmarks/small_kernels.py [--cc gcc] [length ...]
+"""
+import argparse
+import glob
+import os
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(HERE)
+DEFAULT_LENGTHS = [4, 8, 12, 16, 24, 32, 40]
+
+
+def build(cc, out, defines):
+    sources = [
+        path
+        for path in sorted(glob.glob(os.path.join(ROOT, "*.c")))
+        if os.path.basename(path) != "jellyfishmodule.c"
+    ]
+    cmd = [cc, "-O2", "-std=c99", "-D_POSIX_C_SOURCE=200809L", "-I", ROOT]
+    cmd += defines + [os.path.join(HERE, "small_kernels.c")] + sources
+    cmd += ["-o", out, "-lm", "-pthread"]
+    subprocess.run(cmd, check=True)
+
+
+def timings(binary, lengths):
+    output = subprocess.run(
+        [binary] + [str(n) for n in lengths],
+        check=True,
+        stdout=subprocess.PIPE,
+        universal_newlines=True,
+    ).stdout
+    result = {}
+    for line in output.splitlines():
+        metric, length, ns = line.split()
+        result[metric, int(length)] = float(ns)
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"))
+    parser.add_argument("lengths", nargs="*", type=int, default=DEFAULT_LENGTHS)
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        small = os.path.join(tmp, "small")
+        generic = os.path.join(tmp, "generic")
+        build(args.cc, small, [])
+        build(args.cc, generic, ["-DJFISH_NO_SMALL_KERNELS"])
+        # alternate the builds length by length so drift in machine load
+        # hits both columns alike
+        fast, slow = {}, {}
+        for length in args.lengths:
+            fast.update(timings(small, [length]))
+            slow.update(timings(generic, [length]))
+
+    print("%-20s %6s %12s %12s %8s" % ("metric", "length", "generic ns", "small ns", "speedup"))
+    for metric, length in sorted(fast, key=lambda key: (key[0], key[1])):
+        print(
+            "%-20s %6d %12.1f %12.1f %7.2fx"
+            % (
+                metric,
+                length,
+                slow[metric, length],
+                fast[metric, length],
+                slow[metric, length] / fast[metric, length],
+            )
+        )
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
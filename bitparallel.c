@@ -0,0 +1,193 @@
+#include "jellyfish.h"
+#include <string.h>
+
+/*
+  Pattern match vectors ("peq" in Myers' and Hyyro's papers) shared by the
+  bit-parallel kernels.
+
+  For a pattern of m characters every distinct character gets a row of
+  ceil(m / 64) words.  Rows for ASCII characters live at the front of
+  `rows`, one per code point, so the common case is a plain index.  Other
+  characters are hashed into `keys` (0 marks an empty slot, which is safe
+  because 0 is ASCII and never hashed) and their rows follow the ASCII
+  block.  A final all-zero row is returned for characters that do not
+  occur in the pattern.
+*/
+
+#define PEQ_ASCII 128
+
+static size_t peq_slot(const struct jfish_peq *peq, JFISH_UNICODE c)
+{
+    size_t mask = peq->capacity - 1;
+    size_t i = ((size_t)c * 2654435761u) & mask;
+
+    while (peq->keys[i] && peq->keys[i] != c) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+
+int jfish_peq_init(struct jfish_peq *peq, const JFISH_UNICODE *str, size_t len)
+{
+    size_t i, slot, nrows;
+    size_t extended = 0;
+    uint64_t *row;
+
+    peq->words = len ? (len + 63) / 64 : 1;
+    peq->capacity = 0;
+    peq->keys = NULL;
+
+    for (i = 0; i < len; i++) {
+        if (str[i] >= PEQ_ASCII) {
+            extended++;
+        }
+    }
+    if (extended) {
+        peq->capacity = 8;
+        while (peq->capacity < extended * 2) {
+            peq->capacity *= 2;
+        }
+        peq->keys = calloc(peq->capacity, sizeof(JFISH_UNICODE));
+        if (!peq->keys) {
+            return 0;
+        }
+    }
+
+    nrows = PEQ_ASCII + peq->capacity + 1;
+    peq->rows = safe_matrix_malloc(nrows, peq->words, sizeof(uint64_t));
+    if (!peq->rows) {
+        free(peq->keys);
+        peq->keys = NULL;
+        return 0;
+    }
+    memset(peq->rows, 0, nrows * peq->words * sizeof(uint64_t));
+
+    for (i = 0; i < len; i++) {
+        if (str[i] < PEQ_ASCII) {
+            row = peq->rows + (size_t)str[i] * peq->words;
+        } else {
+            slot = peq_slot(peq, str[i]);
+            peq->keys[slot] = str[i];
+            row = peq->rows + (PEQ_ASCII + slot) * peq->words;
+        }
+        row[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+
+    return 1;
+}
+
+
+const uint64_t* jfish_peq_get(const struct jfish_peq *peq, JFISH_UNICODE c)
+{
+    size_t slot;
+
+    if (c < PEQ_ASCII) {
+        return peq->rows + (size_t)c * peq->words;
+    }
+    if (peq->capacity) {
+        slot = peq_slot(peq, c);
+        if (peq->keys[slot]) {
+            return peq->rows + (PEQ_ASCII + slot) * peq->words;
+        }
+    }
+    return peq->rows + (PEQ_ASCII + peq->capacity) * peq->words;
+}
+
+
+void jfish_peq_free(struct jfish_peq *peq)
+{
+    free(peq->keys);
+    free(peq->rows);
+    peq->keys = NULL;
+    peq->rows = NULL;
+}
+
+
+/*
+  Levenshtein distance between the pattern described by peq (m characters)
+  and text, using Myers' bit-vector algorithm in the blocked form given by
+  Hyyro.  Every text character advances each 64-bit block of the vertical
+  delta vectors, passing the horizontal delta at the block's last row on to
+  the next block; the score tracks the bottom row.  Returns -1 on
+  allocation failure.
+*/
+int jfish_myers_distance(const struct jfish_peq *peq, int m, const JFISH_UNICODE *text, int n)
+{
+    return jfish_myers_distance_bounded(peq, m, text, n, m > n ? m : n);
+}
+
+
+/*
+  As jfish_myers_distance(), but gives up once the distance is known to
+  exceed max_distance and returns max_distance + 1.  The bottom row can
+  drop by at most one per remaining text character, so the scan stops as
+  soon as score - (characters left) > max_distance.
+*/
+int jfish_myers_distance_bounded(const struct jfish_peq *peq, int m,
+                                 const JFISH_UNICODE *text, int n, int max_distance)
+{
+    const uint64_t *eq_row;
+    uint64_t small[8];
+    uint64_t *pv, *mv;
+    uint64_t eq, xv, xh, ph, mh, high;
+    uint64_t last_high = (uint64_t)1 << ((m - 1) % 64);
+    size_t words = peq->words, w;
+    int j, score = m, carry, hout;
+
+    if (abs(m - n) > max_distance) {
+        return max_distance + 1;
+    }
+    if (!m) {
+        return n;
+    }
+
+    /* patterns up to 256 characters keep their state on the stack */
+    pv = words <= 4 ? small : safe_malloc(2 * words, sizeof(uint64_t));
+    if (!pv) {
+        return -1;
+    }
+    mv = pv + words;
+    memset(pv, 0xff, words * sizeof(uint64_t));
+    memset(mv, 0, words * sizeof(uint64_t));
+
+    for (j = 0; j < n; j++) {
+        eq_row = jfish_peq_get(peq, text[j]);
+        /* the top row is D[0][j] = j, so every column starts with +1 */
+        carry = 1;
+        for (w = 0; w < words; w++) {
+            high = (w == words - 1) ? last_high : (uint64_t)1 << 63;
+            eq = eq_row[w];
+            xv = eq | mv[w];
+            if (carry < 0) {
+                eq |= 1;
+            }
+            xh = (((eq & pv[w]) + pv[w]) ^ pv[w]) | eq;
+            ph = mv[w] | ~(xh | pv[w]);
+            mh = pv[w] & xh;
+
+            hout = (ph & high) ? 1 : (mh & high) ? -1 : 0;
+
+            ph <<= 1;
+            mh <<= 1;
+            if (carry < 0) {
+                mh |= 1;
+            } else if (carry > 0) {
+                ph |= 1;
+            }
+            pv[w] = mh | ~(xv | ph);
+            mv[w] = ph & xv;
+            carry = hout;
+        }
+        score += carry;
+        if (score - (n - j - 1) > max_distance) {
+            score = max_distance + 1;
+            break;
+        }
+    }
+
+    if (pv != small) {
+        free(pv);
+    }
+    return score;
+}
@@ -0,0 +1,81 @@
+/* clock_gettime() and CLOCK_MONOTONIC are POSIX, hidden under -std=c99;
+ * same value as Python's pyconfig.h so the two definitions agree. */
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "jellyfish.h"
+
+/*
+  Work limits for the *_budget() distance functions.
+
+  The dynamic programming kernels ask jfish_budget_exceeded() before each
+  row whether they may compute it.  The cell limit is checked on every row
+  and costs one comparison; the deadline needs a clock read, so it is only
+  looked at every check_rows rows.
+*/
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define BUDGET_CHECK_ROWS 64
+
+
+/* Seconds on a monotonic clock, for building jfish_budget deadlines. */
+double jfish_monotonic_seconds(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER counter, frequency;
+
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+
+/*
+  Non-zero if computing row number `row` (counting from 0), of row_cells
+  cells, after cells_done cells would break the budget.  A NULL budget
+  never runs out.
+*/
+int jfish_budget_exceeded(const struct jfish_budget *budget, uint64_t cells_done,
+                          uint64_t row_cells, size_t row)
+{
+    int check_rows;
+
+    if (!budget) {
+        return 0;
+    }
+    if (budget->max_cells && cells_done + row_cells > budget->max_cells) {
+        return 1;
+    }
+    if (budget->deadline > 0) {
+        check_rows = budget->check_rows > 0 ? budget->check_rows : BUDGET_CHECK_ROWS;
+        if (row % check_rows == 0 && jfish_monotonic_seconds() >= budget->deadline) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/* Non-zero if the budget allows the whole len1 x len2 table outright. */
+int jfish_budget_unlimited(const struct jfish_budget *budget, size_t len1, size_t len2)
+{
+    if (!budget) {
+        return 1;
+    }
+    if (budget->deadline > 0) {
+        return 0;
+    }
+    return !budget->max_cells || (uint64_t)len1 * len2 <= budget->max_cells;
+}
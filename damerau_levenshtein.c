@@ -137,42 +137,410 @@ int trie_set(struct trie* d, size_t key, size_t val)
 }
 
 
+/*
+  Stack-only kernels for short strings, one per size class N.
+
+  The matrix lives on the stack and the trie is replaced by two small
+  tables: the distinct characters of s1 are numbered once, every position
+  of s2 is mapped to the number of its character (or -1), and the last row
+  each character was seen on is then a plain array lookup per cell.
+*/
+#define DAMERAU_SMALL(N)                                                        \
+static int damerau_levenshtein_distance_##N(const JFISH_UNICODE *s1,            \
+                                            const JFISH_UNICODE *s2,            \
+                                            size_t len1, size_t len2)           \
+{                                                                               \
+    unsigned dist[(N + 2) * (N + 2)];                                           \
+    JFISH_UNICODE alphabet[N];                                                  \
+    int s1_slot[N], s2_slot[N];                                                 \
+    unsigned da[N];                                                             \
+    unsigned infinite = len1 + len2;                                            \
+    unsigned d1, d4, db, i1, j1, diag, left, up;                                \
+    const size_t cols = N + 2;                                                  \
+    size_t i, j;                                                                \
+    int symbols = 0, k;                                                         \
+                                                                                \
+    for (i = 0; i < len1; i++) {                                                \
+        for (k = 0; k < symbols && alphabet[k] != s1[i]; k++);                  \
+        if (k == symbols) {                                                     \
+            alphabet[symbols] = s1[i];                                          \
+            da[symbols++] = 0;                                                  \
+        }                                                                       \
+        s1_slot[i] = k;                                                         \
+    }                                                                           \
+    for (j = 0; j < len2; j++) {                                                \
+        for (k = 0; k < symbols && alphabet[k] != s2[j]; k++);                  \
+        s2_slot[j] = k < symbols ? k : -1;                                      \
+    }                                                                           \
+                                                                                \
+    dist[0] = infinite;                                                         \
+    for (i = 0; i <= len1; i++) {                                               \
+        dist[((i + 1) * cols) + 0] = infinite;                                  \
+        dist[((i + 1) * cols) + 1] = i;                                         \
+    }                                                                           \
+    for (j = 0; j <= len2; j++) {                                               \
+        dist[j + 1] = infinite;                                                 \
+        dist[cols + j + 1] = j;                                                 \
+    }                                                                           \
+                                                                                \
+    for (i = 1; i <= len1; i++) {                                               \
+        db = 0;                                                                 \
+        diag = dist[(i * cols) + 1];                                            \
+        left = dist[((i + 1) * cols) + 1];                                      \
+        for (j = 1; j <= len2; j++) {                                           \
+            up = dist[(i * cols) + j + 1];                                      \
+            i1 = s2_slot[j - 1] < 0 ? 0 : da[s2_slot[j - 1]];                   \
+            j1 = db;                                                            \
+            d1 = diag + (s1[i - 1] != s2[j - 1]);                               \
+            if (s1[i - 1] == s2[j - 1]) {                                       \
+                db = j;                                                         \
+            }                                                                   \
+            d4 = dist[(i1 * cols) + j1] + (i - i1 - 1) + 1 + (j - j1 - 1);      \
+            left = MIN(MIN(d1, left + 1), MIN(up + 1, d4));                     \
+            dist[((i + 1) * cols) + j + 1] = left;                              \
+            diag = up;                                                          \
+        }                                                                       \
+        da[s1_slot[i - 1]] = i;                                                 \
+    }                                                                           \
+                                                                                \
+    return dist[((len1 + 1) * cols) + len2 + 1];                                \
+}
+
+#ifndef JFISH_NO_SMALL_KERNELS
+DAMERAU_SMALL(16)
+DAMERAU_SMALL(32)
+#endif
+
+
+/*
+  Full-matrix kernels, one per cell type.  The largest value in the matrix
+  is the "infinite" sentinel len1 + len2, so damerau_levenshtein_distance()
+  uses 8-bit cells when that is below 255 and 16-bit cells below 65535,
+  shrinking the (len1 + 2) x (len2 + 2) matrix two to eight times.
+*/
+#define DAMERAU_MATRIX(NAME, CELL)                                              \
+static int NAME(const JFISH_UNICODE *s1, const JFISH_UNICODE *s2,               \
+                size_t len1, size_t len2)                                       \
+{                                                                               \
+    size_t infinite = len1 + len2;                                              \
+    size_t cols = len2 + 2;                                                     \
+                                                                                \
+    size_t i, j, i1, j1;                                                        \
+    size_t db;                                                                  \
+    size_t d1, d2, d3, d4, result;                                              \
+    unsigned short cost;                                                        \
+                                                                                \
+    CELL *dist = NULL;                                                          \
+    struct trie* da;                                                            \
+                                                                                \
+    da = trie_create();                                                         \
+    if (!da) {                                                                  \
+        return -1;                                                              \
+    }                                                                           \
+                                                                                \
+    dist = safe_matrix_malloc((len1 + 2), cols, sizeof(CELL));                  \
+    if (!dist) {                                                                \
+        result = -1;                                                            \
+        goto cleanup_da;                                                        \
+    }                                                                           \
+                                                                                \
+    dist[0] = infinite;                                                         \
+                                                                                \
+    for (i = 0; i <= len1; i++) {                                               \
+        dist[((i + 1) * cols) + 0] = infinite;                                  \
+        dist[((i + 1) * cols) + 1] = i;                                         \
+    }                                                                           \
+                                                                                \
+    for (i = 0; i <= len2; i++) {                                               \
+        dist[i + 1] = infinite;       /* 0*cols + row */                        \
+        dist[cols + i + 1] = i;       /* 1*cols + row */                        \
+    }                                                                           \
+                                                                                \
+    for (i = 1; i <= len1; i++) {                                               \
+        db = 0;                                                                 \
+        for (j = 1; j <= len2; j++) {                                           \
+            i1 = trie_get(da, s2[j-1]);                                         \
+            j1 = db;                                                            \
+                                                                                \
+            if (s1[i - 1] == s2[j - 1]) {                                       \
+                cost = 0;                                                       \
+                db = j;                                                         \
+            } else {                                                            \
+                cost = 1;                                                       \
+            }                                                                   \
+                                                                                \
+            d1 = dist[(i * cols) + j] + cost;                                   \
+            d2 = dist[((i + 1) * cols) + j] + 1;                                \
+            d3 = dist[(i * cols) + j + 1] + 1;                                  \
+            d4 = dist[(i1 * cols) + j1] + (i - i1 - 1) + 1 + (j - j1 - 1);      \
+                                                                                \
+            dist[((i+1)*cols) + j + 1] = MIN(MIN(d1, d2), MIN(d3, d4));         \
+        }                                                                       \
+                                                                                \
+        if (!trie_set(da, s1[i-1], i)) {                                        \
+            result = -1;                                                        \
+            goto cleanup;                                                       \
+        };                                                                      \
+    }                                                                           \
+                                                                                \
+    result = dist[((len1+1) * cols) + len2 + 1];                                \
+                                                                                \
+                                                                                \
+ cleanup:                                                                       \
+    free(dist);                                                                 \
+                                                                                \
+ cleanup_da:                                                                    \
+    trie_destroy(da);                                                           \
+                                                                                \
+    return result;                                                              \
+}
+
+DAMERAU_MATRIX(damerau_matrix_u8, uint8_t)
+DAMERAU_MATRIX(damerau_matrix_u16, uint16_t)
+DAMERAU_MATRIX(damerau_matrix_size, size_t)
+
+
+/*
+  Damerau-Levenshtein distance if it is at most k, otherwise k + 1.
+
+  As for Levenshtein, only the band |i - j| <= k can hold values within
+  the bound.  A transposition from (i1, j1) costs at least i - i1 and
+  j - j1, so only the last k + 1 rows can feed one that stays within the
+  bound: the band is kept for the last k + 2 rows in a ring, O(k^2) cells
+  in all.  Gives up as soon as a whole band row exceeds k.  Returns -1 on
+  failed malloc.
+*/
+static int damerau_levenshtein_distance_bounded(const JFISH_UNICODE *s1, const JFISH_UNICODE *s2,
+                                                size_t len1, size_t len2, size_t k)
+{
+    size_t width = 2 * k + 1, ring = k + 2;
+    size_t i, j, lo, hi, i1, j1, db;
+    size_t d1, d2, d3, d4, limit = k + 1, row_min;
+    size_t *band, *row, *above;
+    struct trie* da;
+    int result;
+
+/* cell (r, c) of the band, for |r - c| <= k */
+#define BAND(r, c) band[((r) % ring) * width + (c) + k - (r)]
+
+    da = trie_create();
+    if (!da) {
+        return -1;
+    }
+    band = safe_matrix_malloc(ring, width, sizeof(size_t));
+    if (!band) {
+        trie_destroy(da);
+        return -1;
+    }
+
+    for (j = 0; j <= MIN(k, len2); j++) {
+        BAND(0, j) = j;
+    }
+
+    for (i = 1; i <= len1; i++) {
+        lo = i > k ? i - k : 0;
+        hi = MIN(len2, i + k);
+        /* row[j - lo] is cell (i, j); above[j - lo] is cell (i - 1, j - 1) */
+        row = band + (i % ring) * width + (lo + k - i);
+        above = band + ((i - 1) % ring) * width + (lo + k - i);
+        row_min = limit;
+        db = 0;
+
+        for (j = lo; j <= hi; j++) {
+            if (j == 0) {
+                row[0] = i;
+                row_min = MIN(row_min, i);
+                continue;
+            }
+            i1 = trie_get(da, s2[j - 1]);
+            j1 = db;
+
+            if (s1[i - 1] == s2[j - 1]) {
+                d1 = above[j - lo];
+                db = j;
+            } else {
+                d1 = above[j - lo] + 1;
+            }
+            d2 = j > lo ? row[j - lo - 1] + 1 : limit;
+            d3 = j < i + k ? above[j - lo + 1] + 1 : limit;
+            d4 = limit;
+            if (i1 && j1 && i - i1 <= k && j - j1 <= k &&
+                    (i1 > j1 ? i1 - j1 : j1 - i1) <= k) {
+                d4 = BAND(i1 - 1, j1 - 1) + (i - i1 - 1) + 1 + (j - j1 - 1);
+            }
+
+            d1 = MIN(MIN(d1, d2), MIN(d3, d4));
+            row[j - lo] = MIN(d1, limit);
+            row_min = MIN(row_min, row[j - lo]);
+        }
+
+        if (row_min >= limit) {
+            result = limit;
+            goto cleanup;
+        }
+        if (!trie_set(da, s1[i - 1], i)) {
+            result = -1;
+            goto cleanup;
+        }
+    }
+    result = BAND(len1, len2);
+
+ cleanup:
+#undef BAND
+    free(band);
+    trie_destroy(da);
+    return result;
+}
+
+
 int damerau_levenshtein_distance(const JFISH_UNICODE *s1, const JFISH_UNICODE *s2, size_t len1, size_t len2)
 {
-    size_t infinite = len1 + len2;
-    size_t cols = len2 + 2;
+    size_t k;
+    int result;
+
+#ifndef JFISH_NO_SMALL_KERNELS
+    if (len1 <= 16 && len2 <= 16) {
+        return damerau_levenshtein_distance_16(s1, s2, len1, len2);
+    }
+    if (len1 <= 32 && len2 <= 32) {
+        return damerau_levenshtein_distance_32(s1, s2, len1, len2);
+    }
+#endif
+
+    /* strip common affixes, then search bands of doubling width (see
+     * levenshtein_distance()) before falling back to the full matrix */
+    while (len1 && len2 && *s1 == *s2) {
+        s1++;
+        s2++;
+        len1--;
+        len2--;
+    }
+    while (len1 && len2 && s1[len1 - 1] == s2[len2 - 1]) {
+        len1--;
+        len2--;
+    }
+    if (!len1 || !len2) {
+        return len1 + len2;
+    }
+    k = len1 > len2 ? len1 - len2 : len2 - len1;
+    if (k < 1) {
+        k = 1;
+    }
+    for (; 4 * k < MIN(len1, len2); k *= 2) {
+        result = damerau_levenshtein_distance_bounded(s1, s2, len1, len2, k);
+        if (result < 0 || (size_t)result <= k) {
+            return result;
+        }
+    }
+#ifndef JFISH_NO_SMALL_KERNELS
+    if (len1 <= 32 && len2 <= 32) {
+        return damerau_levenshtein_distance_32(s1, s2, len1, len2);
+    }
+#endif
 
-    size_t i, j, i1, j1;
-    size_t db;
-    size_t d1, d2, d3, d4, result;
+    if (len1 + len2 < UINT8_MAX) {
+        return damerau_matrix_u8(s1, s2, len1, len2);
+    }
+    if (len1 + len2 < UINT16_MAX) {
+        return damerau_matrix_u16(s1, s2, len1, len2);
+    }
+    return damerau_matrix_size(s1, s2, len1, len2);
+}
+
+
+/*
+  damerau_levenshtein_distance() that stops when budget runs out.
+
+  Common affixes are stripped first.  A transposition can reach back to
+  any earlier row, so the rows filled so far are kept, in a table that
+  grows as rows are added rather than being sized for the whole matrix.
+  If the budget runs out, returns JFISH_BUDGET_EXCEEDED and sets
+  *lower_bound to the larger of the length difference and the smallest
+  value of the last finished row (row minima never decrease, since a cell
+  reached by a transposition from row k - 1 pays at least the i - k rows it
+  skips).  Returns -1 on failed malloc.
+*/
+int damerau_levenshtein_distance_budget(const JFISH_UNICODE *s1, const JFISH_UNICODE *s2,
+                                        size_t len1, size_t len2,
+                                        const struct jfish_budget *budget, int *lower_bound)
+{
+    size_t infinite, cols, capacity;
+    size_t i, j, i1, j1, db;
+    size_t d1, d2, d3, d4, bound;
+    size_t *dist = NULL, *grown;
+    uint64_t cells = 0;
     unsigned short cost;
+    struct trie* da;
+    int result;
+
+    if (jfish_budget_unlimited(budget, len1, len2)) {
+        return damerau_levenshtein_distance(s1, s2, len1, len2);
+    }
 
-    size_t *dist = NULL;
+    while (len1 && len2 && *s1 == *s2) {
+        s1++;
+        s2++;
+        len1--;
+        len2--;
+    }
+    while (len1 && len2 && s1[len1 - 1] == s2[len2 - 1]) {
+        len1--;
+        len2--;
+    }
+    if (!len1 || !len2) {
+        return len1 + len2;
+    }
+
+    infinite = len1 + len2;
+    cols = len2 + 2;
 
-    struct trie* da = trie_create();
+    da = trie_create();
     if (!da) {
         return -1;
     }
-
-    dist = safe_matrix_malloc((len1 + 2), cols, sizeof(size_t));
+    /* the table may grow to len1 + 2 rows */
+    if ((len1 + 2) > SIZE_MAX / cols / sizeof(size_t)) {
+        result = -1;
+        goto cleanup;
+    }
+    capacity = MIN(len1 + 2, 64);
+    dist = safe_matrix_malloc(capacity, cols, sizeof(size_t));
     if (!dist) {
         result = -1;
-        goto cleanup_da;
+        goto cleanup;
     }
 
     dist[0] = infinite;
+    for (j = 0; j <= len2; j++) {
+        dist[j + 1] = infinite;
+        dist[cols + j + 1] = j;
+    }
+    dist[cols] = infinite;
 
-    for (i = 0; i <= len1; i++) {
+    for (i = 1; i <= len1; i++) {
+        if (jfish_budget_exceeded(budget, cells, len2, i - 1)) {
+            bound = len1 > len2 ? len1 - len2 : len2 - len1;
+            d1 = infinite;
+            for (j = 1; j <= len2 + 1; j++) {
+                d1 = MIN(d1, dist[(i * cols) + j]);
+            }
+            *lower_bound = (int)MIN(infinite, bound > d1 ? bound : d1);
+            result = JFISH_BUDGET_EXCEEDED;
+            goto cleanup;
+        }
+
+        if (i + 2 > capacity) {
+            capacity = MIN(len1 + 2, 2 * capacity);
+            grown = realloc(dist, capacity * cols * sizeof(size_t));
+            if (!grown) {
+                result = -1;
+                goto cleanup;
+            }
+            dist = grown;
+        }
         dist[((i + 1) * cols) + 0] = infinite;
         dist[((i + 1) * cols) + 1] = i;
-    }
 
-    for (i = 0; i <= len2; i++) {
-        dist[i + 1] = infinite;       // 0*cols + row
-        dist[cols + i + 1] = i;       // 1*cols + row
-    }
-
-    for (i = 1; i <= len1; i++) {
         db = 0;
         for (j = 1; j <= len2; j++) {
             i1 = trie_get(da, s2[j-1]);
@@ -192,21 +560,124 @@ int damerau_levenshtein_distance(const JFISH_UNICODE *s1, const JFISH_UNICODE *s
 
             dist[((i+1)*cols) + j + 1] = MIN(MIN(d1, d2), MIN(d3, d4));
         }
+        cells += len2;
 
         if (!trie_set(da, s1[i-1], i)) {
             result = -1;
             goto cleanup;
-        };
+        }
     }
 
     result = dist[((len1+1) * cols) + len2 + 1];
 
-
  cleanup:
     free(dist);
-
- cleanup_da:
     trie_destroy(da);
-
     return result;
 }
+
+
+/* Bit-parallel OSA distance for a pattern p of 1 to 64 characters. */
+static int osa_distance_hyyro(const JFISH_UNICODE *p, int m, const JFISH_UNICODE *t, int n)
+{
+    uint64_t ascii[128];
+    JFISH_UNICODE other_chars[64];
+    uint64_t other_masks[64];
+    uint64_t vp = ~(uint64_t)0, vn = 0, d0 = 0, pm, pm_prev = 0, tr, hp, hn;
+    uint64_t last = (uint64_t)1 << (m - 1);
+    int i, k, others = 0, score = m;
+
+    memset(ascii, 0, sizeof(ascii));
+    for (i = 0; i < m; i++) {
+        if (p[i] < 128) {
+            ascii[p[i]] |= (uint64_t)1 << i;
+            continue;
+        }
+        for (k = 0; k < others && other_chars[k] != p[i]; k++);
+        if (k == others) {
+            other_chars[others] = p[i];
+            other_masks[others++] = 0;
+        }
+        other_masks[k] |= (uint64_t)1 << i;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (t[i] < 128) {
+            pm = ascii[t[i]];
+        } else {
+            for (k = 0; k < others && other_chars[k] != t[i]; k++);
+            pm = k < others ? other_masks[k] : 0;
+        }
+
+        tr = (((~d0) & pm) << 1) & pm_prev;
+        d0 = (((pm & vp) + vp) ^ vp) | pm | vn | tr;
+        hp = vn | ~(d0 | vp);
+        hn = d0 & vp;
+        score += (hp & last) ? 1 : 0;
+        score -= (hn & last) ? 1 : 0;
+        hp = (hp << 1) | 1;
+        hn <<= 1;
+        vp = hn | ~(d0 | hp);
+        vn = hp & d0;
+        pm_prev = pm;
+    }
+    return score;
+}
+
+
+/*
+  Optimal string alignment distance (restricted Damerau-Levenshtein): like
+  damerau_levenshtein_distance(), but a transposed pair cannot be edited
+  again, so only the previous two rows of the matrix are ever consulted.
+
+  When either string has at most 64 characters it becomes the pattern of
+  Hyyro's bit-parallel algorithm, Myers' Levenshtein recurrence extended
+  with a transposition vector; otherwise three rolling rows are used.
+  Returns -1 on failed malloc.
+*/
+int osa_distance(const JFISH_UNICODE *s1, int len1, const JFISH_UNICODE *s2, int len2)
+{
+    unsigned *rows, *prev2, *prev, *cur, *tmp;
+    unsigned d1, d2, d3;
+    int i, j;
+
+    if (!len1 || !len2) {
+        return len1 + len2;
+    }
+    if (len1 <= 64) {
+        return osa_distance_hyyro(s1, len1, s2, len2);
+    }
+    if (len2 <= 64) {
+        return osa_distance_hyyro(s2, len2, s1, len1);
+    }
+
+    rows = safe_matrix_malloc(3, (size_t)len2 + 1, sizeof(unsigned));
+    if (!rows) {
+        return -1;
+    }
+    prev2 = rows;
+    prev = prev2 + len2 + 1;
+    cur = prev + len2 + 1;
+
+    for (j = 0; j <= len2; j++) {
+        prev[j] = j;
+    }
+
+    for (i = 1; i <= len1; i++) {
+        cur[0] = i;
+        for (j = 1; j <= len2; j++) {
+            d1 = prev[j - 1] + (s1[i - 1] != s2[j - 1]);
+            d2 = prev[j] + 1;
+            d3 = cur[j - 1] + 1;
+            cur[j] = MIN(d1, MIN(d2, d3));
+            if (i > 1 && j > 1 && s1[i - 1] == s2[j - 2] && s1[i - 2] == s2[j - 1]) {
+                cur[j] = MIN(cur[j], prev2[j - 2] + 1);
+            }
+        }
+        tmp = prev2; prev2 = prev; prev = cur; cur = tmp;
+    }
+
+    d1 = prev[len2];
+    free(rows);
+    return d1;
+}
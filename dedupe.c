@@ -0,0 +1,318 @@
+#include "jellyfish.h"
+#include <string.h>
+#include <stdlib.h>
+
+/*
+  Sorted-neighbourhood deduplication.
+
+  1. every string gets a phonetic blocking key (soundex or nysiis) packed
+     into a uint64_t, first character in the most significant byte, so
+     integer order is the lexicographic order of the code;
+  2. (key, index) pairs are LSD radix sorted a byte at a time: threads
+     histogram their slice, offsets are combined per thread, and each thread
+     scatters its slice, keeping the sort stable.  Bytes that are equal
+     across all keys are skipped;
+  3. each sorted position is compared with the next `window` positions
+     using jaro_winkler_similarity_threshold(), and pairs scoring at least
+     min_score are collected in per-thread buffers.
+
+  All three phases are split over nthreads threads with
+  jfish_parallel_run().
+*/
+
+struct pair_buffer {
+    int *pairs;
+    size_t n;
+    size_t cap;
+};
+
+struct neighborhood {
+    const JFISH_UNICODE *const *strs;
+    const int *lens;
+    int count;
+    int key_type;
+    int window;
+    double min_score;
+
+    uint64_t *keys, *keys_tmp;
+    int *order, *order_tmp;
+    size_t (*hist)[256];
+    int shift;
+
+    struct pair_buffer *buffers;
+    int *failed;        /* one flag per thread, combined after the join */
+};
+
+
+static void slice(int count, int index, int nthreads, int *lo, int *hi)
+{
+    int chunk = (count + nthreads - 1) / nthreads;
+    *lo = MIN(count, index * chunk);
+    *hi = MIN(count, *lo + chunk);
+}
+
+
+static int pair_buffer_push(struct pair_buffer *buf, int a, int b)
+{
+    int *grown;
+
+    if (buf->n == buf->cap) {
+        buf->cap = buf->cap ? buf->cap * 2 : 64;
+        grown = realloc(buf->pairs, buf->cap * 2 * sizeof(int));
+        if (!grown) {
+            return 0;
+        }
+        buf->pairs = grown;
+    }
+    buf->pairs[2 * buf->n] = a;
+    buf->pairs[2 * buf->n + 1] = b;
+    buf->n++;
+    return 1;
+}
+
+
+/* Pack up to 8 code points, saturating non-Latin-1 ones, into a sort key. */
+static uint64_t pack_code(const JFISH_UNICODE *code, size_t len)
+{
+    uint64_t key = 0;
+    size_t i;
+
+    for (i = 0; i < 8; i++) {
+        key <<= 8;
+        if (i < len) {
+            key |= code[i] < 0xff ? code[i] : 0xff;
+        }
+    }
+    return key;
+}
+
+
+/* The blocking key of one string: its nysiis code, or the soundex code of
+ * its NFKD form as soundex() computes it.  Nothing is allocated. */
+static uint64_t blocking_key(const JFISH_UNICODE *str, int len, int key_type)
+{
+    JFISH_UNICODE packed[9];
+    char sdx[5];
+    int n;
+
+    if (key_type == JFISH_KEY_NYSIIS) {
+        n = (int)MIN(nysiis_into(str, len, packed, 9, 0), 8);
+        return pack_code(packed, n);
+    }
+
+    soundex_ucs(str, len, sdx);
+    for (n = 0; n < 4 && sdx[n]; n++) {
+        packed[n] = (unsigned char)sdx[n];
+    }
+    return pack_code(packed, n);
+}
+
+
+static void keys_worker(void *arg, int index, int nthreads)
+{
+    struct neighborhood *nb = arg;
+    int i, lo, hi;
+
+    slice(nb->count, index, nthreads, &lo, &hi);
+    for (i = lo; i < hi; i++) {
+        nb->keys[i] = blocking_key(nb->strs[i], nb->lens[i], nb->key_type);
+        nb->order[i] = i;
+    }
+}
+
+
+static void histogram_worker(void *arg, int index, int nthreads)
+{
+    struct neighborhood *nb = arg;
+    int i, lo, hi;
+
+    slice(nb->count, index, nthreads, &lo, &hi);
+    memset(nb->hist[index], 0, sizeof(nb->hist[index]));
+    for (i = lo; i < hi; i++) {
+        nb->hist[index][(nb->keys[i] >> nb->shift) & 0xff]++;
+    }
+}
+
+
+static void scatter_worker(void *arg, int index, int nthreads)
+{
+    struct neighborhood *nb = arg;
+    size_t *offsets = nb->hist[index];
+    size_t dest;
+    int i, lo, hi;
+
+    slice(nb->count, index, nthreads, &lo, &hi);
+    for (i = lo; i < hi; i++) {
+        dest = offsets[(nb->keys[i] >> nb->shift) & 0xff]++;
+        nb->keys_tmp[dest] = nb->keys[i];
+        nb->order_tmp[dest] = nb->order[i];
+    }
+}
+
+
+static void window_worker(void *arg, int index, int nthreads)
+{
+    struct neighborhood *nb = arg;
+    struct pair_buffer *buf = &nb->buffers[index];
+    int p, q, a, b, lo, hi;
+    double score;
+
+    slice(nb->count, index, nthreads, &lo, &hi);
+    for (p = lo; p < hi; p++) {
+        for (q = p + 1; q <= p + nb->window && q < nb->count; q++) {
+            a = nb->order[p];
+            b = nb->order[q];
+            score = jaro_winkler_similarity_threshold(nb->strs[a], nb->lens[a],
+                                                      nb->strs[b], nb->lens[b],
+                                                      0, nb->min_score);
+            if (score < -1) {
+                nb->failed[index] = 1;
+                return;
+            }
+            if (score < nb->min_score) {
+                continue;
+            }
+            if (!pair_buffer_push(buf, MIN(a, b), a < b ? b : a)) {
+                nb->failed[index] = 1;
+                return;
+            }
+        }
+    }
+}
+
+
+static int any_failed(const struct neighborhood *nb, int nthreads)
+{
+    int t, failed = 0;
+
+    for (t = 0; t < nthreads; t++) {
+        failed |= nb->failed[t];
+    }
+    return failed;
+}
+
+
+static void radix_sort(struct neighborhood *nb, int nthreads)
+{
+    uint64_t *keys_swap;
+    int *order_swap;
+    size_t total, count;
+    int byte, b, t;
+
+    for (byte = 0; byte < 8; byte++) {
+        nb->shift = byte * 8;
+        jfish_parallel_run(histogram_worker, nb, nthreads);
+
+        /* skip bytes every key agrees on */
+        for (b = 0; b < 256; b++) {
+            for (count = 0, t = 0; t < nthreads; t++) {
+                count += nb->hist[t][b];
+            }
+            if (count) {
+                break;
+            }
+        }
+        if (count == (size_t)nb->count) {
+            continue;
+        }
+
+        /* turn per-thread counts into per-thread starting offsets */
+        total = 0;
+        for (b = 0; b < 256; b++) {
+            for (t = 0; t < nthreads; t++) {
+                count = nb->hist[t][b];
+                nb->hist[t][b] = total;
+                total += count;
+            }
+        }
+        jfish_parallel_run(scatter_worker, nb, nthreads);
+
+        keys_swap = nb->keys; nb->keys = nb->keys_tmp; nb->keys_tmp = keys_swap;
+        order_swap = nb->order; nb->order = nb->order_tmp; nb->order_tmp = order_swap;
+    }
+}
+
+
+/*
+  Sort strs by phonetic key and compare every string with the next
+  `window` strings in that order.  Pairs (i, j), i < j, with a Jaro-Winkler
+  similarity of at least min_score are returned in *pairs as a malloc'd
+  array of 2 * *npairs ints (caller frees).  Returns 0 on success or -1 on
+  allocation failure.
+*/
+int sorted_neighborhood_pairs(const JFISH_UNICODE *const *strs, const int *lens, int count,
+                              int key_type, int window, double min_score, int nthreads,
+                              int **pairs, size_t *npairs)
+{
+    struct neighborhood nb;
+    size_t total, offset;
+    int t, ret = -1;
+
+    *pairs = NULL;
+    *npairs = 0;
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    if (nthreads > count) {
+        nthreads = count > 0 ? count : 1;
+    }
+    if (nthreads > JFISH_MAX_THREADS) {
+        nthreads = JFISH_MAX_THREADS;
+    }
+
+    memset(&nb, 0, sizeof(nb));
+    nb.strs = strs;
+    nb.lens = lens;
+    nb.count = count;
+    nb.key_type = key_type;
+    nb.window = window;
+    nb.min_score = min_score;
+
+    nb.keys = safe_malloc((size_t)count + 1, sizeof(uint64_t));
+    nb.keys_tmp = safe_malloc((size_t)count + 1, sizeof(uint64_t));
+    nb.order = safe_malloc((size_t)count + 1, sizeof(int));
+    nb.order_tmp = safe_malloc((size_t)count + 1, sizeof(int));
+    nb.hist = safe_malloc(nthreads, sizeof(*nb.hist));
+    nb.buffers = calloc(nthreads, sizeof(struct pair_buffer));
+    nb.failed = calloc(nthreads, sizeof(int));
+    if (!nb.keys || !nb.keys_tmp || !nb.order || !nb.order_tmp || !nb.hist || !nb.buffers ||
+        !nb.failed) {
+        goto cleanup;
+    }
+
+    jfish_parallel_run(keys_worker, &nb, nthreads);
+    radix_sort(&nb, nthreads);
+    jfish_parallel_run(window_worker, &nb, nthreads);
+    if (any_failed(&nb, nthreads)) {
+        goto cleanup;
+    }
+
+    for (total = 0, t = 0; t < nthreads; t++) {
+        total += nb.buffers[t].n;
+    }
+    *pairs = safe_malloc(2 * total + 1, sizeof(int));
+    if (!*pairs) {
+        goto cleanup;
+    }
+    for (offset = 0, t = 0; t < nthreads; t++) {
+        memcpy(*pairs + 2 * offset, nb.buffers[t].pairs, 2 * nb.buffers[t].n * sizeof(int));
+        offset += nb.buffers[t].n;
+    }
+    *npairs = total;
+    ret = 0;
+
+ cleanup:
+    if (nb.buffers) {
+        for (t = 0; t < nthreads; t++) {
+            free(nb.buffers[t].pairs);
+        }
+    }
+    free(nb.buffers);
+    free(nb.failed);
+    free(nb.hist);
+    free(nb.keys);
+    free(nb.keys_tmp);
+    free(nb.order);
+    free(nb.order_tmp);
+    return ret;
+}
@@ -0,0 +1,265 @@
+#include "jellyfish.h"
+#include <string.h>
+#include <stdlib.h>
+
+/*
+  Feature vectors for string pairs.
+
+  jellyfish_pair_features() computes any subset of the JFISH_FEATURE_*
+  metrics for one pair and shares the work they have in common:
+
+  - the common prefix and suffix are measured once.  Identical strings
+    short-circuit every distance, Levenshtein and Damerau-Levenshtein run
+    on what is left between the affixes, Hamming skips the prefix, and the
+    Winkler bonus comes from the prefix length instead of a second Jaro
+    pass: Jaro-Winkler is derived from the Jaro score with the same
+    arithmetic _jaro_winkler_weight() uses (long_tolerance off);
+  - the upper-cased copies the Match Rating comparison needs share one
+    workspace, on the stack for short strings;
+  - each string's phonetic keys come from a single phonetic_keys() call;
+    keys it had to truncate are compared again at full length with
+    phonetic_key_equal().
+
+  Features are written to out in the order of their bits, one double each,
+  with nothing written for features that are not in mask.  Distances are
+  plain counts, the Match Rating feature is 1, 0 or -1 (codices too
+  different to compare) and the phonetic features are 1 when both strings
+  have the same key.
+*/
+
+#define FEATURE_STACK 64
+
+
+static int features_upper(const JFISH_UNICODE *str, int len, JFISH_UNICODE *out)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        out[i] = TOUPPER(str[i]);
+    }
+    return len;
+}
+
+
+/* Whether two NUL terminated keys are equal; nothing past the NUL is
+ * looked at. */
+static int features_key_equal(const JFISH_UNICODE *a, const JFISH_UNICODE *b)
+{
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+
+/*
+  Write the features selected by mask for (s1, s2) into out.  Returns the
+  number of values written, or -1 on allocation failure.
+*/
+int jellyfish_pair_features(const JFISH_UNICODE *s1, int len1, const JFISH_UNICODE *s2, int len2,
+                            int mask, double *out)
+{
+    JFISH_UNICODE upper_stack[2 * FEATURE_STACK];
+    JFISH_UNICODE *upper = upper_stack;
+    struct jfish_phonetic_keys keys1, keys2;
+    int prefix = 0, suffix = 0, shortest = MIN(len1, len2);
+    int identical, flags, result, n = 0, ret = -1;
+    double jaro = 0, weight;
+
+    while (prefix < shortest && s1[prefix] == s2[prefix]) {
+        prefix++;
+    }
+    while (suffix < shortest - prefix && s1[len1 - suffix - 1] == s2[len2 - suffix - 1]) {
+        suffix++;
+    }
+    identical = prefix == len1 && prefix == len2;
+
+    flags = 0;
+    if (mask & JFISH_FEATURE_SOUNDEX) flags |= JFISH_PHONETIC_SOUNDEX;
+    if (mask & JFISH_FEATURE_METAPHONE) flags |= JFISH_PHONETIC_METAPHONE;
+    if (mask & JFISH_FEATURE_NYSIIS) flags |= JFISH_PHONETIC_NYSIIS;
+    if (flags && !identical) {
+        if (phonetic_keys(s1, len1, flags, &keys1) < 0 ||
+            phonetic_keys(s2, len2, flags, &keys2) < 0) {
+            return -1;
+        }
+    }
+
+    if ((mask & JFISH_FEATURE_MATCH_RATING) && len1 + len2 > 2 * FEATURE_STACK) {
+        upper = safe_malloc((size_t)len1 + len2 + 1, sizeof(JFISH_UNICODE));
+        if (!upper) {
+            return -1;
+        }
+    }
+
+    if (mask & JFISH_FEATURE_LEVENSHTEIN) {
+        result = identical ? 0 : levenshtein_distance(s1 + prefix, len1 - prefix - suffix,
+                                                      s2 + prefix, len2 - prefix - suffix);
+        if (result < 0) {
+            goto cleanup;
+        }
+        out[n++] = result;
+    }
+
+    if (mask & JFISH_FEATURE_DAMERAU_LEVENSHTEIN) {
+        result = identical ? 0 : damerau_levenshtein_distance(s1 + prefix, s2 + prefix,
+                                                              len1 - prefix - suffix,
+                                                              len2 - prefix - suffix);
+        if (result < 0) {
+            goto cleanup;
+        }
+        out[n++] = result;
+    }
+
+    if (mask & (JFISH_FEATURE_JARO | JFISH_FEATURE_JARO_WINKLER)) {
+        if (identical) {
+            jaro = len1 ? 1 : 0;
+        } else {
+            jaro = jaro_similarity(s1, len1, s2, len2);
+            if (jaro < -1) {
+                goto cleanup;
+            }
+        }
+    }
+    if (mask & JFISH_FEATURE_JARO) {
+        out[n++] = jaro;
+    }
+    if (mask & JFISH_FEATURE_JARO_WINKLER) {
+        weight = jaro;
+        if (weight > 0.7 && MIN(prefix, 4)) {
+            weight += MIN(prefix, 4) * 0.1 * (1.0 - weight);
+        }
+        out[n++] = weight;
+    }
+
+    if (mask & JFISH_FEATURE_HAMMING) {
+        out[n++] = identical ? 0 : (double)hamming_distance(s1 + prefix, len1 - prefix,
+                                                            s2 + prefix, len2 - prefix);
+    }
+
+    if (mask & JFISH_FEATURE_MATCH_RATING) {
+        features_upper(s1, len1, upper);
+        features_upper(s2, len2, upper + len1);
+        out[n++] = match_rating_comparison(upper, len1, upper + len1, len2);
+    }
+
+    if (mask & JFISH_FEATURE_SOUNDEX) {
+        out[n++] = identical || !strcmp(keys1.soundex, keys2.soundex);
+    }
+    if (mask & JFISH_FEATURE_METAPHONE) {
+        if (identical) {
+            result = 1;
+        } else if ((keys1.truncated | keys2.truncated) & JFISH_PHONETIC_METAPHONE) {
+            result = phonetic_key_equal(s1, len1, s2, len2, JFISH_PHONETIC_METAPHONE);
+        } else {
+            result = !strcmp(keys1.metaphone, keys2.metaphone);
+        }
+        if (result < 0) {
+            goto cleanup;
+        }
+        out[n++] = result;
+    }
+    if (mask & JFISH_FEATURE_NYSIIS) {
+        if (identical) {
+            result = 1;
+        } else if ((keys1.truncated | keys2.truncated) & JFISH_PHONETIC_NYSIIS) {
+            result = phonetic_key_equal(s1, len1, s2, len2, JFISH_PHONETIC_NYSIIS);
+        } else {
+            result = features_key_equal(keys1.nysiis, keys2.nysiis);
+        }
+        if (result < 0) {
+            goto cleanup;
+        }
+        out[n++] = result;
+    }
+    ret = n;
+
+ cleanup:
+    if (upper != upper_stack) {
+        free(upper);
+    }
+    return ret;
+}
+
+
+struct feature_batch {
+    const JFISH_UNICODE *const *strs1;
+    const int *lens1;
+    const JFISH_UNICODE *const *strs2;
+    const int *lens2;
+    int count;
+    int mask;
+    int width;
+    double *out;
+    int failed[JFISH_MAX_THREADS];  /* per thread, combined after the join */
+};
+
+
+static void feature_worker(void *arg, int index, int nthreads)
+{
+    struct feature_batch *batch = arg;
+    int chunk = (batch->count + nthreads - 1) / nthreads;
+    int lo = MIN(batch->count, index * chunk);
+    int hi = MIN(batch->count, lo + chunk);
+    int i;
+
+    for (i = lo; i < hi; i++) {
+        if (jellyfish_pair_features(batch->strs1[i], batch->lens1[i],
+                                    batch->strs2[i], batch->lens2[i], batch->mask,
+                                    batch->out + (size_t)i * batch->width) < 0) {
+            batch->failed[index] = 1;
+            return;
+        }
+    }
+}
+
+
+/*
+  jellyfish_pair_features() for the count pairs (strs1[i], strs2[i]),
+  written as a row-major count x jellyfish_feature_count(mask) matrix and
+  split over nthreads threads.  Returns 0, or -1 on allocation failure.
+*/
+int jellyfish_pair_features_batch(const JFISH_UNICODE *const *strs1, const int *lens1,
+                                  const JFISH_UNICODE *const *strs2, const int *lens2,
+                                  int count, int mask, double *out, int nthreads)
+{
+    struct feature_batch batch;
+    int t, failed = 0;
+
+    if (count < 1) {
+        return 0;
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    if (nthreads > count) {
+        nthreads = count;
+    }
+    if (nthreads > JFISH_MAX_THREADS) {
+        nthreads = JFISH_MAX_THREADS;
+    }
+
+    batch.strs1 = strs1;
+    batch.lens1 = lens1;
+    batch.strs2 = strs2;
+    batch.lens2 = lens2;
+    batch.count = count;
+    batch.mask = mask;
+    batch.width = jellyfish_feature_count(mask);
+    batch.out = out;
+    memset(batch.failed, 0, nthreads * sizeof(int));
+
+    jfish_parallel_run(feature_worker, &batch, nthreads);
+    for (t = 0; t < nthreads; t++) {
+        failed |= batch.failed[t];
+    }
+    return failed ? -1 : 0;
+}
+
+
+/* Number of values jellyfish_pair_features() writes for mask. */
+int jellyfish_feature_count(int mask)
+{
+    return jfish_popcount64((uint64_t)(mask & JFISH_FEATURE_ALL));
+}
@@ -0,0 +1,266 @@
+#include "jellyfish.h"
+#include <string.h>
+#include <stdlib.h>
+
+/*
+  Incremental Levenshtein distances for a query typed one character at a
+  time against a fixed set of candidates.
+
+  Each candidate is the pattern of Myers' bit-vector algorithm and the
+  query is the text, so appending a query character is one more column:
+  the candidate's vertical delta vectors (and its distance, the bottom row)
+  are advanced in O(candidate length / 64) words after building the match
+  mask of that character.  The vectors and distances of every query prefix
+  are kept as levels of a stack, so removing characters only moves the top
+  of the stack and typing again reuses the level's storage.
+*/
+
+struct jellyfish_incremental {
+    int count;
+    JFISH_UNICODE *pool;
+    size_t *offsets;     /* count + 1 entries into pool */
+    size_t *word_start;  /* count + 1 entries into each level's vectors */
+    size_t words;
+
+    int depth;           /* current query length */
+    int levels;          /* allocated levels, at least depth + 1 */
+    JFISH_UNICODE *query;
+    uint64_t **vectors;  /* per level: pv for all words, then mv */
+    int **scores;        /* per level: one distance per candidate */
+};
+
+
+void jellyfish_incremental_free(struct jellyfish_incremental *inc)
+{
+    int i;
+
+    if (!inc) {
+        return;
+    }
+    for (i = 0; i < inc->levels; i++) {
+        free(inc->vectors[i]);
+        free(inc->scores[i]);
+    }
+    free(inc->vectors);
+    free(inc->scores);
+    free(inc->query);
+    free(inc->pool);
+    free(inc->offsets);
+    free(inc->word_start);
+    free(inc);
+}
+
+
+/* Make sure levels [0, n) exist.  Returns 0 on allocation failure. */
+static int incremental_reserve(struct jellyfish_incremental *inc, int n)
+{
+    uint64_t **vectors;
+    int **scores;
+    JFISH_UNICODE *query;
+    int levels = inc->levels ? inc->levels : 8;
+
+    if (n <= inc->levels) {
+        return 1;
+    }
+    while (levels < n) {
+        levels *= 2;
+    }
+
+    vectors = realloc(inc->vectors, levels * sizeof(uint64_t*));
+    if (!vectors) {
+        return 0;
+    }
+    inc->vectors = vectors;
+    scores = realloc(inc->scores, levels * sizeof(int*));
+    if (!scores) {
+        return 0;
+    }
+    inc->scores = scores;
+    query = realloc(inc->query, levels * sizeof(JFISH_UNICODE));
+    if (!query) {
+        return 0;
+    }
+    inc->query = query;
+
+    for (; inc->levels < n; inc->levels++) {
+        inc->vectors[inc->levels] = safe_matrix_malloc(2, inc->words + 1, sizeof(uint64_t));
+        inc->scores[inc->levels] = safe_malloc((size_t)inc->count + 1, sizeof(int));
+        if (!inc->vectors[inc->levels] || !inc->scores[inc->levels]) {
+            free(inc->vectors[inc->levels]);
+            free(inc->scores[inc->levels]);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+struct jellyfish_incremental* jellyfish_incremental_create(const JFISH_UNICODE *const *candidates,
+                                                           const int *lens, int count)
+{
+    struct jellyfish_incremental *inc;
+    size_t total_len = 0;
+    int k;
+
+    if (count < 0) {
+        return NULL;
+    }
+    inc = calloc(1, sizeof(struct jellyfish_incremental));
+    if (!inc) {
+        return NULL;
+    }
+    inc->count = count;
+
+    for (k = 0; k < count; k++) {
+        total_len += lens[k];
+    }
+    inc->pool = safe_malloc(total_len + 1, sizeof(JFISH_UNICODE));
+    inc->offsets = safe_malloc((size_t)count + 1, sizeof(size_t));
+    inc->word_start = safe_malloc((size_t)count + 1, sizeof(size_t));
+    if (!inc->pool || !inc->offsets || !inc->word_start) {
+        jellyfish_incremental_free(inc);
+        return NULL;
+    }
+
+    inc->offsets[0] = 0;
+    inc->word_start[0] = 0;
+    for (k = 0; k < count; k++) {
+        memcpy(inc->pool + inc->offsets[k], candidates[k], lens[k] * sizeof(JFISH_UNICODE));
+        inc->offsets[k + 1] = inc->offsets[k] + lens[k];
+        inc->word_start[k + 1] = inc->word_start[k] + (lens[k] ? (lens[k] + 63) / 64 : 1);
+    }
+    inc->words = inc->word_start[count];
+
+    if (!incremental_reserve(inc, 1)) {
+        jellyfish_incremental_free(inc);
+        return NULL;
+    }
+
+    /* the empty query is len(candidate) edits away from each candidate */
+    memset(inc->vectors[0], 0xff, inc->words * sizeof(uint64_t));
+    memset(inc->vectors[0] + inc->words, 0, inc->words * sizeof(uint64_t));
+    for (k = 0; k < count; k++) {
+        inc->scores[0][k] = lens[k];
+    }
+    return inc;
+}
+
+
+/* Advance one candidate by the query character c. */
+static int incremental_step(const JFISH_UNICODE *s, int m, JFISH_UNICODE c,
+                            const uint64_t *pv_in, const uint64_t *mv_in,
+                            uint64_t *pv_out, uint64_t *mv_out, size_t words)
+{
+    uint64_t eq, xv, xh, ph, mh, pv, mv, high;
+    size_t w;
+    int i, end, carry = 1, hout;
+
+    for (w = 0; w < words; w++) {
+        end = (int)MIN((size_t)m, (w + 1) * 64);
+        eq = 0;
+        for (i = (int)w * 64; i < end; i++) {
+            eq |= (uint64_t)(s[i] == c) << (i % 64);
+        }
+        high = (uint64_t)1 << ((end - 1) % 64);
+        pv = pv_in[w];
+        mv = mv_in[w];
+
+        xv = eq | mv;
+        if (carry < 0) {
+            eq |= 1;
+        }
+        xh = (((eq & pv) + pv) ^ pv) | eq;
+        ph = mv | ~(xh | pv);
+        mh = pv & xh;
+
+        hout = (ph & high) ? 1 : (mh & high) ? -1 : 0;
+
+        ph <<= 1;
+        mh <<= 1;
+        if (carry < 0) {
+            mh |= 1;
+        } else if (carry > 0) {
+            ph |= 1;
+        }
+        pv_out[w] = mh | ~(xv | ph);
+        mv_out[w] = ph & xv;
+        carry = hout;
+    }
+    return carry;
+}
+
+
+/*
+  Append c to the query and update every candidate's distance.  Returns 0,
+  or -1 on allocation failure (the query is then left unchanged).
+*/
+int jellyfish_incremental_push(struct jellyfish_incremental *inc, JFISH_UNICODE c)
+{
+    const uint64_t *pv_in, *mv_in;
+    uint64_t *pv_out, *mv_out;
+    const int *prev;
+    int *next;
+    size_t start, words;
+    int k, m;
+
+    if (!incremental_reserve(inc, inc->depth + 2)) {
+        return -1;
+    }
+
+    pv_in = inc->vectors[inc->depth];
+    mv_in = pv_in + inc->words;
+    pv_out = inc->vectors[inc->depth + 1];
+    mv_out = pv_out + inc->words;
+    prev = inc->scores[inc->depth];
+    next = inc->scores[inc->depth + 1];
+
+    for (k = 0; k < inc->count; k++) {
+        m = (int)(inc->offsets[k + 1] - inc->offsets[k]);
+        if (!m) {
+            next[k] = prev[k] + 1;
+            continue;
+        }
+        start = inc->word_start[k];
+        words = inc->word_start[k + 1] - start;
+        next[k] = prev[k] + incremental_step(inc->pool + inc->offsets[k], m, c,
+                                             pv_in + start, mv_in + start,
+                                             pv_out + start, mv_out + start, words);
+    }
+
+    inc->query[inc->depth++] = c;
+    return 0;
+}
+
+
+/* Remove the last n query characters (all of them if n exceeds the length). */
+void jellyfish_incremental_pop(struct jellyfish_incremental *inc, int n)
+{
+    if (n > 0) {
+        inc->depth = n < inc->depth ? inc->depth - n : 0;
+    }
+}
+
+
+int jellyfish_incremental_size(const struct jellyfish_incremental *inc)
+{
+    return inc->count;
+}
+
+
+int jellyfish_incremental_length(const struct jellyfish_incremental *inc)
+{
+    return inc->depth;
+}
+
+
+const JFISH_UNICODE* jellyfish_incremental_query(const struct jellyfish_incremental *inc)
+{
+    return inc->query;
+}
+
+
+/* Levenshtein distance of each candidate to the current query. */
+const int* jellyfish_incremental_distances(const struct jellyfish_incremental *inc)
+{
+    return inc->scores[inc->depth];
+}
@@ -4,6 +4,79 @@
 #include <stdlib.h>
 #include "jellyfish.h"
 
+/*
+  Stack-only kernels for strings of up to N (8, 16 or 32) characters.
+
+  yang is copied into a buffer of exactly N characters, so for each ying
+  character the positions of yang holding it are found with a fixed-length,
+  fully unrollable loop into a bit mask.  The flags are bit masks too: the
+  first unflagged match inside the search window is the lowest set bit of
+  eq & window & ~flagged, which is the same position the scan in
+  _jaro_winkler() settles on.
+*/
+#define JARO_WINKLER_SMALL(N)                                                   \
+static double _jaro_winkler_##N(const JFISH_UNICODE *ying, int ying_length,    \
+                                const JFISH_UNICODE *yang, int yang_length,    \
+                                int long_tolerance, int winklerize)            \
+{                                                                               \
+    JFISH_UNICODE padded[N];                                                    \
+    JFISH_UNICODE matched[N];                                                   \
+    uint32_t flagged = 0, window, eq, candidates;                               \
+    long search_range, lowlim, hilim;                                           \
+    long common_chars = 0, trans_count = 0;                                     \
+    int i, j;                                                                   \
+                                                                                \
+    memset(padded, 0, sizeof(padded));                                          \
+    memcpy(padded, yang, yang_length * sizeof(JFISH_UNICODE));                  \
+                                                                                \
+    search_range = ying_length > yang_length ? ying_length : yang_length;       \
+    search_range = (search_range / 2) - 1;                                      \
+    if (search_range < 0) search_range = 0;                                     \
+                                                                                \
+    for (i = 0; i < ying_length; i++) {                                         \
+        lowlim = (i >= search_range) ? i - search_range : 0;                    \
+        hilim = (i + search_range <= yang_length - 1) ? (i + search_range) : yang_length - 1; \
+        if (lowlim > hilim) {                                                   \
+            continue;                                                           \
+        }                                                                       \
+        window = (hilim == 31) ? ~(uint32_t)0 : ((uint32_t)1 << (hilim + 1)) - 1; \
+        window &= ~(((uint32_t)1 << lowlim) - 1);                               \
+                                                                                \
+        eq = 0;                                                                 \
+        for (j = 0; j < N; j++) {                                               \
+            eq |= (uint32_t)(padded[j] == ying[i]) << j;                        \
+        }                                                                       \
+        candidates = eq & window & ~flagged;                                    \
+        if (candidates) {                                                       \
+            flagged |= candidates & (~candidates + 1);                          \
+            matched[common_chars++] = ying[i];                                  \
+        }                                                                       \
+    }                                                                           \
+                                                                                \
+    if (!common_chars) {                                                        \
+        return 0;                                                               \
+    }                                                                           \
+                                                                                \
+    for (i = 0, j = 0; j < yang_length; j++) {                                  \
+        if (flagged & ((uint32_t)1 << j)) {                                     \
+            if (matched[i++] != yang[j]) {                                      \
+                trans_count++;                                                  \
+            }                                                                   \
+        }                                                                       \
+    }                                                                           \
+    trans_count /= 2;                                                           \
+                                                                                \
+    return _jaro_winkler_weight(ying, ying_length, yang, yang_length,           \
+                                common_chars, trans_count, long_tolerance, winklerize); \
+}
+
+#ifndef JFISH_NO_SMALL_KERNELS
+JARO_WINKLER_SMALL(8)
+JARO_WINKLER_SMALL(16)
+JARO_WINKLER_SMALL(32)
+#endif
+
+
 /* borrowed heavily from strcmp95.c
  *    http://www.census.gov/geo/msb/stand/strcmp.c
  */
@@ -26,9 +99,6 @@ double _jaro_winkler(const JFISH_UNICODE *ying, int ying_length,
     */
     JFISH_UNICODE *ying_flag=0, *yang_flag=0;
 
-    double weight;
-
-    long min_len;
     long search_range;
     long lowlim, hilim;
     long trans_count, common_chars;
@@ -38,12 +108,22 @@ double _jaro_winkler(const JFISH_UNICODE *ying, int ying_length,
     // ensure that neither string is blank
     if (!ying_length || !yang_length) return 0;
 
+#ifndef JFISH_NO_SMALL_KERNELS
+    if (ying_length <= 8 && yang_length <= 8) {
+        return _jaro_winkler_8(ying, ying_length, yang, yang_length, long_tolerance, winklerize);
+    }
+    if (ying_length <= 16 && yang_length <= 16) {
+        return _jaro_winkler_16(ying, ying_length, yang, yang_length, long_tolerance, winklerize);
+    }
+    if (ying_length <= 32 && yang_length <= 32) {
+        return _jaro_winkler_32(ying, ying_length, yang, yang_length, long_tolerance, winklerize);
+    }
+#endif
+
     if (ying_length > yang_length) {
         search_range = ying_length;
-        min_len = yang_length;
     } else {
         search_range = yang_length;
-        min_len = ying_length;
     }
   
     // Blank out the flags
@@ -101,6 +181,25 @@ double _jaro_winkler(const JFISH_UNICODE *ying, int ying_length,
     }
     trans_count /= 2;
 
+    free(ying_flag);
+    free(yang_flag);
+
+    return _jaro_winkler_weight(ying, ying_length, yang, yang_length,
+                                common_chars, trans_count, long_tolerance, winklerize);
+}
+
+
+/* Final Jaro / Jaro-Winkler weight once the matching characters and
+ * transpositions have been counted (common_chars must be non-zero). */
+double _jaro_winkler_weight(const JFISH_UNICODE *ying, int ying_length,
+                            const JFISH_UNICODE *yang, int yang_length,
+                            long common_chars, long trans_count,
+                            int long_tolerance, int winklerize)
+{
+    double weight;
+    long min_len = MIN(ying_length, yang_length);
+    int i, j;
+
     // adjust for similarities in nonmatched characters
 
     // Main weight computation.
@@ -128,8 +227,6 @@ double _jaro_winkler(const JFISH_UNICODE *ying, int ying_length,
         }
     }
 
-    free(ying_flag);
-    free(yang_flag);
     return weight;
 }
 
@@ -145,3 +242,78 @@ double jaro_similarity(const JFISH_UNICODE *ying, int ying_len, const JFISH_UNIC
 {
     return _jaro_winkler(ying, ying_len, yang, yang_len, 0, 0);
 }
+
+
+/* Jaro-Winkler score for `common` matched characters, no transpositions and
+ * `prefix` agreeing leading characters.  This is the largest score any pair
+ * with those parameters can reach, so it bounds _jaro_winkler() from above.
+ */
+double _jaro_winkler_bound(long common, int ying_length, int yang_length,
+                           int prefix, int long_tolerance)
+{
+    long min_len = MIN(ying_length, yang_length);
+    double weight;
+
+    if (!common) {
+        return 0;
+    }
+    weight = (common / ((double) ying_length) + common / ((double) yang_length) + 1.0) / 3.0;
+    weight += prefix * 0.1 * (1.0 - weight);
+    if (long_tolerance && min_len > 4 && common > prefix + 1) {
+        weight += (1.0 - weight) *
+            ((double) (common - prefix - 1) / ((double) (ying_length + yang_length - prefix * 2 + 2)));
+    }
+    return weight;
+}
+
+
+/*
+  Like jaro_winkler_similarity(), but returns 0 for any pair scoring below
+  min_score, without doing the full comparison when the pair cannot reach
+  it.
+
+  Two upper bounds are tried before _jaro_winkler() allocates its flag
+  arrays: one where every character of the shorter string matches, and one
+  where the number of matches is limited by the overlap of the character
+  histograms (ASCII counted per character, everything else pooled).  Both
+  assume no transpositions and the actual common prefix of up to 4
+  characters for the Winkler boost.
+*/
+double jaro_winkler_similarity_threshold(const JFISH_UNICODE *ying, int ying_len,
+                                         const JFISH_UNICODE *yang, int yang_len,
+                                         int long_tolerance, double min_score)
+{
+    int hist[129];
+    int i, prefix;
+    long common;
+    double weight;
+
+    if (!ying_len || !yang_len) {
+        return 0;
+    }
+
+    for (prefix = 0; prefix < 4 && prefix < ying_len && prefix < yang_len &&
+             ying[prefix] == yang[prefix]; prefix++);
+
+    common = MIN(ying_len, yang_len);
+    if (_jaro_winkler_bound(common, ying_len, yang_len, prefix, long_tolerance) < min_score) {
+        return 0;
+    }
+
+    memset(hist, 0, sizeof(hist));
+    for (i = 0; i < ying_len; i++) {
+        hist[ying[i] < 128 ? ying[i] : 128]++;
+    }
+    common = 0;
+    for (i = 0; i < yang_len; i++) {
+        if (hist[yang[i] < 128 ? yang[i] : 128]-- > 0) {
+            common++;
+        }
+    }
+    if (_jaro_winkler_bound(common, ying_len, yang_len, prefix, long_tolerance) < min_score) {
+        return 0;
+    }
+
+    weight = _jaro_winkler(ying, ying_len, yang, yang_len, long_tolerance, 1);
+    return (weight < min_score && weight >= 0) ? 0 : weight;
+}
@@ -2,16 +2,21 @@
 #define _JELLYFISH_H_
 
 #include <stdlib.h>
+#include <stdint.h>
 
 #if CJELLYFISH_PYTHON
 #include <Python.h>
 #define JFISH_UNICODE Py_UCS4
 #define ISALPHA Py_UNICODE_ISALPHA
+#define ISALNUM Py_UNICODE_ISALNUM
+#define TOUPPER Py_UNICODE_TOUPPER
 #else
 #include <wctype.h>
 #include <wchar.h>
 #define JFISH_UNICODE wint_t
 #define ISALPHA iswalpha
+#define ISALNUM iswalnum
+#define TOUPPER towupper
 #endif
 
 #ifndef MIN
@@ -38,29 +43,281 @@ static inline void* safe_matrix_malloc(size_t rows, size_t cols, size_t size)
     return safe_malloc(matrix_size, size);
 }
 
+/* Pattern match vectors for the bit-parallel kernels: bit i of the row
+ * for character c is set when str[i] == c.  ASCII rows are indexed
+ * directly, anything else goes through a small open-addressing table.
+ */
+struct jfish_peq {
+    size_t words;
+    size_t capacity;
+    JFISH_UNICODE *keys;
+    uint64_t *rows;
+};
+
+int jfish_peq_init(struct jfish_peq *peq, const JFISH_UNICODE *str, size_t len);
+const uint64_t* jfish_peq_get(const struct jfish_peq *peq, JFISH_UNICODE c);
+void jfish_peq_free(struct jfish_peq *peq);
+int jfish_myers_distance(const struct jfish_peq *peq, int m, const JFISH_UNICODE *text, int n);
+int jfish_myers_distance_bounded(const struct jfish_peq *peq, int m,
+        const JFISH_UNICODE *text, int n, int max_distance);
+
+static inline int jfish_popcount64(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    int n = 0;
+    while (x) {
+        x &= x - 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/* jfish_parallel_run() never starts more workers than this. */
+#define JFISH_MAX_THREADS 256
+
+typedef void (*jfish_worker_fn)(void *ctx, int index, int nthreads);
+void jfish_parallel_run(jfish_worker_fn fn, void *ctx, int nthreads);
+
+/* Work limits for the *_budget() distance functions: at most max_cells
+ * dynamic programming cells (0 for no limit) and/or stop once
+ * jfish_monotonic_seconds() reaches deadline (0 for none), read every
+ * check_rows rows (0 for a default).  Running out returns
+ * JFISH_BUDGET_EXCEEDED and a lower bound on the distance. */
+struct jfish_budget {
+    uint64_t max_cells;
+    double deadline;
+    int check_rows;
+};
+
+#define JFISH_BUDGET_EXCEEDED (-2)
+
+double jfish_monotonic_seconds(void);
+int jfish_budget_exceeded(const struct jfish_budget *budget, uint64_t cells_done,
+        uint64_t row_cells, size_t row);
+int jfish_budget_unlimited(const struct jfish_budget *budget, size_t len1, size_t len2);
+
 double jaro_winkler_similarity(const JFISH_UNICODE *str1, int len1, const JFISH_UNICODE *str2, int len2, int long_tolerance);
 double jaro_similarity(const JFISH_UNICODE *str1, int len1, const JFISH_UNICODE *str2, int len2);
+double _jaro_winkler(const JFISH_UNICODE *ying, int ying_length,
+        const JFISH_UNICODE *yang, int yang_length, int long_tolerance, int winklerize);
+double _jaro_winkler_weight(const JFISH_UNICODE *ying, int ying_length,
+        const JFISH_UNICODE *yang, int yang_length, long common_chars, long trans_count,
+        int long_tolerance, int winklerize);
+double _jaro_winkler_bound(long common, int ying_length, int yang_length,
+        int prefix, int long_tolerance);
+double jaro_winkler_similarity_threshold(const JFISH_UNICODE *str1, int len1,
+        const JFISH_UNICODE *str2, int len2, int long_tolerance, double min_score);
 
 size_t hamming_distance(const JFISH_UNICODE *str1, int len1,
         const JFISH_UNICODE *str2, int len2);
 
 int levenshtein_distance(const JFISH_UNICODE *str1, int len1, const JFISH_UNICODE *str2, int len2);
+int levenshtein_distance_bounded(const JFISH_UNICODE *str1, int len1,
+        const JFISH_UNICODE *str2, int len2, int max_distance);
+int levenshtein_distance_budget(const JFISH_UNICODE *str1, int len1,
+        const JFISH_UNICODE *str2, int len2, const struct jfish_budget *budget, int *lower_bound);
+int levenshtein_distance_parallel(const JFISH_UNICODE *str1, size_t len1,
+        const JFISH_UNICODE *str2, size_t len2, int nthreads);
 
 int damerau_levenshtein_distance(const JFISH_UNICODE *str1, const JFISH_UNICODE *str2,
         size_t len1, size_t len2);
+int damerau_levenshtein_distance_budget(const JFISH_UNICODE *str1, const JFISH_UNICODE *str2,
+        size_t len1, size_t len2, const struct jfish_budget *budget, int *lower_bound);
+int osa_distance(const JFISH_UNICODE *str1, int len1, const JFISH_UNICODE *str2, int len2);
+
+int lcs_length(const JFISH_UNICODE *str1, int len1, const JFISH_UNICODE *str2, int len2);
+double lcs_similarity(const JFISH_UNICODE *str1, int len1, const JFISH_UNICODE *str2, int len2);
+int longest_common_substring(const JFISH_UNICODE *str1, int len1, const JFISH_UNICODE *str2, int len2,
+        int *start1, int *start2);
+double longest_common_substring_similarity(const JFISH_UNICODE *str1, int len1,
+        const JFISH_UNICODE *str2, int len2);
+
+size_t jfish_utf8_decode(const char *str, size_t len, JFISH_UNICODE *out);
+int jfish_utf8_encode(JFISH_UNICODE c, char *out);
+int levenshtein_distance_utf8(const char *s1, size_t len1, const char *s2, size_t len2);
+int damerau_levenshtein_distance_utf8(const char *s1, size_t len1, const char *s2, size_t len2);
+int osa_distance_utf8(const char *s1, size_t len1, const char *s2, size_t len2);
+size_t hamming_distance_utf8(const char *s1, size_t len1, const char *s2, size_t len2);
+double jaro_similarity_utf8(const char *s1, size_t len1, const char *s2, size_t len2);
+double jaro_winkler_similarity_utf8(const char *s1, size_t len1, const char *s2, size_t len2,
+        int long_tolerance);
+
+struct jfish_token {
+    int start;
+    int len;
+};
+
+enum {
+    JFISH_TOKEN_LEVENSHTEIN = 0,
+    JFISH_TOKEN_JARO_WINKLER = 1
+};
+
+int jfish_tokenize(const JFISH_UNICODE *str, int len, struct jfish_token *tokens, int max_tokens);
+double token_sort_similarity(const JFISH_UNICODE *str1, int len1,
+        const JFISH_UNICODE *str2, int len2, int metric);
+double token_set_similarity(const JFISH_UNICODE *str1, int len1,
+        const JFISH_UNICODE *str2, int len2, int metric);
+double token_alignment_similarity(const JFISH_UNICODE *str1, int len1,
+        const JFISH_UNICODE *str2, int len2, int metric);
+
+struct qgram_index;
+struct qgram_index* qgram_index_create(const JFISH_UNICODE *const *strs, const int *lens,
+        int count, int q);
+void qgram_index_free(struct qgram_index *idx);
+int qgram_index_size(const struct qgram_index *idx);
+int qgram_index_search(const struct qgram_index *idx, const JFISH_UNICODE *query, int len,
+        int max_distance, int *out_ids, int *out_dists, int max_results);
+
+struct symspell_index;
+struct symspell_index* symspell_index_create(const JFISH_UNICODE *const *strs, const int *lens,
+        int count, int max_distance);
+void symspell_index_free(struct symspell_index *idx);
+int symspell_index_size(const struct symspell_index *idx);
+int symspell_index_max_distance(const struct symspell_index *idx);
+int symspell_index_search(const struct symspell_index *idx, const JFISH_UNICODE *query, int len,
+        int max_distance, int *out_ids, int *out_dists, int max_results);
+
+struct minhash;
+struct minhash* minhash_create(int num_perm, int shingle, uint64_t seed);
+void minhash_free(struct minhash *mh);
+void minhash_signature(const struct minhash *mh, const JFISH_UNICODE *str, int len, uint32_t *sig);
+void minhash_signatures(const struct minhash *mh, const JFISH_UNICODE *const *strs, const int *lens,
+        int count, uint32_t *out);
+double minhash_similarity(const uint32_t *sig1, const uint32_t *sig2, int num_perm);
+int lsh_candidate_pairs(const uint32_t *sigs, int count, int num_perm, int bands,
+        int **pairs, size_t *npairs);
+
+enum {
+    JFISH_KEY_SOUNDEX = 0,
+    JFISH_KEY_NYSIIS = 1
+};
+
+int sorted_neighborhood_pairs(const JFISH_UNICODE *const *strs, const int *lens, int count,
+        int key_type, int window, double min_score, int nthreads,
+        int **pairs, size_t *npairs);
+
+int jfish_nfkd_latin(JFISH_UNICODE c, JFISH_UNICODE out[3]);
+
+struct jellyfish_query;
+struct jellyfish_query* jellyfish_query_create(const JFISH_UNICODE *str, int len);
+void jellyfish_query_free(struct jellyfish_query *query);
+int jellyfish_query_levenshtein(const struct jellyfish_query *query, const JFISH_UNICODE *str, int len);
+int jellyfish_query_levenshtein_bounded(const struct jellyfish_query *query,
+        const JFISH_UNICODE *str, int len, int max_distance);
+int jellyfish_query_damerau_levenshtein(const struct jellyfish_query *query,
+        const JFISH_UNICODE *str, int len);
+size_t jellyfish_query_hamming(const struct jellyfish_query *query, const JFISH_UNICODE *str, int len);
+double jellyfish_query_jaro(const struct jellyfish_query *query, const JFISH_UNICODE *str, int len);
+double jellyfish_query_jaro_winkler(const struct jellyfish_query *query,
+        const JFISH_UNICODE *str, int len, int long_tolerance);
+double jellyfish_query_jaro_winkler_threshold(const struct jellyfish_query *query,
+        const JFISH_UNICODE *str, int len, int long_tolerance, double min_score);
+
+struct jellyfish_incremental;
+struct jellyfish_incremental* jellyfish_incremental_create(const JFISH_UNICODE *const *candidates,
+        const int *lens, int count);
+void jellyfish_incremental_free(struct jellyfish_incremental *inc);
+int jellyfish_incremental_push(struct jellyfish_incremental *inc, JFISH_UNICODE c);
+void jellyfish_incremental_pop(struct jellyfish_incremental *inc, int n);
+int jellyfish_incremental_size(const struct jellyfish_incremental *inc);
+int jellyfish_incremental_length(const struct jellyfish_incremental *inc);
+const JFISH_UNICODE* jellyfish_incremental_query(const struct jellyfish_incremental *inc);
+const int* jellyfish_incremental_distances(const struct jellyfish_incremental *inc);
+
+/* Called for each match of an approximate search with its exclusive end
+ * offset in the text and its distance; return non-zero to stop. */
+typedef int (*jfish_search_fn)(void *ctx, size_t end, int distance);
+
+struct jellyfish_search;
+struct jellyfish_search* jellyfish_search_create(const JFISH_UNICODE *pattern, int m, int max_distance);
+void jellyfish_search_free(struct jellyfish_search *search);
+void jellyfish_search_reset(struct jellyfish_search *search);
+int jellyfish_search_feed(struct jellyfish_search *search, const JFISH_UNICODE *text, size_t n,
+        jfish_search_fn fn, void *ctx);
+int approximate_search(const JFISH_UNICODE *pattern, int m, const JFISH_UNICODE *text, size_t n,
+        int max_distance, jfish_search_fn fn, void *ctx);
+
+struct jfish_match {
+    int index;
+    double score;
+};
+
+int jellyfish_topk(int metric, const JFISH_UNICODE *query, int query_len,
+        const JFISH_UNICODE *const *candidates, const int *lens, int count,
+        int k, struct jfish_match *out);
+int jellyfish_topk_parallel(int metric, const JFISH_UNICODE *query, int query_len,
+        const JFISH_UNICODE *const *candidates, const int *lens, int count,
+        int k, struct jfish_match *out, int nthreads);
 
 char* soundex(const char *str);
+void soundex_into(const char *str, char result[5]);
+void soundex_ucs(const JFISH_UNICODE *str, int len, char result[5]);
 
 char* metaphone(const char *str);
+size_t metaphone_into(const char *str, char *out, size_t out_size);
 
 JFISH_UNICODE *nysiis(const JFISH_UNICODE *str, int len);
+size_t nysiis_into(const JFISH_UNICODE *str, int len, JFISH_UNICODE *out,
+                   size_t out_cap, size_t max_code_len);
+int nysiis_batch(const JFISH_UNICODE *const *strs, const int *lens, int count,
+                 JFISH_UNICODE *out, size_t out_cap, size_t max_code_len);
 
 JFISH_UNICODE* match_rating_codex(const JFISH_UNICODE *str, size_t len);
+size_t match_rating_codex_into(const JFISH_UNICODE *str, size_t len, JFISH_UNICODE codex[7]);
 int match_rating_comparison(const JFISH_UNICODE *str1, size_t len1, const JFISH_UNICODE *str2, size_t len2);
 
+#define JFISH_PHONETIC_KEY_MAX 64
+
+enum {
+    JFISH_PHONETIC_SOUNDEX = 1,
+    JFISH_PHONETIC_METAPHONE = 2,
+    JFISH_PHONETIC_NYSIIS = 4,
+    JFISH_PHONETIC_MATCH_RATING = 8,
+    JFISH_PHONETIC_ALL = 15
+};
+
+struct jfish_phonetic_keys {
+    int flags;
+    int truncated;
+    char soundex[5];
+    char metaphone[JFISH_PHONETIC_KEY_MAX];
+    JFISH_UNICODE nysiis[JFISH_PHONETIC_KEY_MAX];
+    JFISH_UNICODE match_rating_codex[7];
+};
+
+int phonetic_keys(const JFISH_UNICODE *str, int len, int flags, struct jfish_phonetic_keys *out);
+int phonetic_keys_batch(const JFISH_UNICODE *const *strs, const int *lens, int count,
+        int flags, struct jfish_phonetic_keys *out);
+int phonetic_key_equal(const JFISH_UNICODE *s1, int len1, const JFISH_UNICODE *s2, int len2,
+        int flag);
+
+enum {
+    JFISH_FEATURE_LEVENSHTEIN = 1,
+    JFISH_FEATURE_DAMERAU_LEVENSHTEIN = 2,
+    JFISH_FEATURE_JARO = 4,
+    JFISH_FEATURE_JARO_WINKLER = 8,
+    JFISH_FEATURE_HAMMING = 16,
+    JFISH_FEATURE_MATCH_RATING = 32,
+    JFISH_FEATURE_SOUNDEX = 64,
+    JFISH_FEATURE_METAPHONE = 128,
+    JFISH_FEATURE_NYSIIS = 256,
+    JFISH_FEATURE_ALL = 511
+};
+
+int jellyfish_pair_features(const JFISH_UNICODE *s1, int len1, const JFISH_UNICODE *s2, int len2,
+        int mask, double *out);
+int jellyfish_pair_features_batch(const JFISH_UNICODE *const *strs1, const int *lens1,
+        const JFISH_UNICODE *const *strs2, const int *lens2,
+        int count, int mask, double *out, int nthreads);
+int jellyfish_feature_count(int mask);
+
 struct stemmer;
 extern struct stemmer * create_stemmer(void);
 extern void free_stemmer(struct stemmer * z);
 extern int stem(struct stemmer * z, JFISH_UNICODE * b, int k);
+extern void stem_tokens(struct stemmer * z, JFISH_UNICODE * str, struct jfish_token * tokens, int count);
 
 #endif
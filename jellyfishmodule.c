@@ -1,6 +1,7 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include <math.h>
+#include <string.h>
 #include "jellyfish.h"
 
 struct jellyfish_state {
@@ -26,26 +27,150 @@ static PyObject* unicode_from_ucs4(const Py_UCS4 *str)
     return PyUnicode_FromKindAndData(PyUnicode_4BYTE_KIND, (void*)str, len);
 }
 
-/* Returns a new reference to a PyString (python < 3) or
- * PyBytes (python >= 3.0).
+static void free_ucs4_sequence(Py_UCS4 **strs, int *lens, Py_ssize_t count);
+
+/* Copy every str in a sequence to a NUL terminated UCS4 buffer.  Returns
+ * the number of strings, or -1 with an exception set.  Release the buffers
+ * with free_ucs4_sequence(). */
+static Py_ssize_t ucs4_sequence(PyObject *obj, Py_UCS4 ***strs, int **lens)
+{
+    PyObject *seq, *item;
+    Py_ssize_t i, count;
+
+    *strs = NULL;
+    *lens = NULL;
+    seq = PySequence_Fast(obj, "sequence of str expected");
+    if (!seq) {
+        return -1;
+    }
+    count = PySequence_Fast_GET_SIZE(seq);
+    *strs = PyMem_Calloc(count + 1, sizeof(Py_UCS4*));
+    *lens = PyMem_Calloc(count + 1, sizeof(int));
+    if (!*strs || !*lens) {
+        PyErr_NoMemory();
+        goto fail;
+    }
+    for (i = 0; i < count; i++) {
+        item = PySequence_Fast_GET_ITEM(seq, i);
+        if (!PyUnicode_Check(item)) {
+            PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+            goto fail;
+        }
+        (*strs)[i] = PyUnicode_AsUCS4Copy(item);
+        if (!(*strs)[i]) {
+            goto fail;
+        }
+        (*lens)[i] = PyUnicode_GET_LENGTH(item);
+    }
+    Py_DECREF(seq);
+    return count;
+
+ fail:
+    free_ucs4_sequence(*strs, *lens, count);
+    *strs = NULL;
+    *lens = NULL;
+    Py_DECREF(seq);
+    return -1;
+}
+
+static void free_ucs4_sequence(Py_UCS4 **strs, int *lens, Py_ssize_t count)
+{
+    Py_ssize_t i;
+
+    if (strs) {
+        for (i = 0; i < count; i++) {
+            PyMem_Free(strs[i]);
+        }
+    }
+    PyMem_Free(strs);
+    PyMem_Free(lens);
+}
+
+/* Build a list of (i, j) tuples from 2 * n ints. */
+static PyObject* pairs_to_list(const int *pairs, size_t n)
+{
+    PyObject *ret, *item;
+    size_t i;
+
+    ret = PyList_New(n);
+    for (i = 0; ret && i < n; i++) {
+        item = Py_BuildValue("(ii)", pairs[2 * i], pairs[2 * i + 1]);
+        if (!item) {
+            Py_CLEAR(ret);
+            break;
+        }
+        PyList_SET_ITEM(ret, i, item);
+    }
+    return ret;
+}
+
+/* Size of the stack buffer callers pass to normalize(); longer results are
+ * returned in a bytes object instead. */
+#define NORMALIZE_BUF 256
+
+/* Returns the NFKD form of pystr as NUL terminated UTF-8.
  *
- * If passed a PyUnicode, the returned object will be NFKD UTF-8.
- * If passed a PyString or PyBytes no conversion is done.
+ * Pure ASCII input is returned as is (NFKD leaves it unchanged).  Input
+ * made of ASCII and Latin letters is decomposed natively with the table in
+ * nfkd.c, into buf if it fits in NORMALIZE_BUF bytes.  Anything else goes
+ * through unicodedata.normalize.  If *owner is set on return it holds a
+ * new reference that must be released once the result is no longer used.
  */
-static INLINE PyObject* normalize(PyObject *mod, PyObject *pystr) {
+static INLINE const char* normalize(PyObject *mod, PyObject *pystr, char *buf, PyObject **owner) {
     PyObject *unicodedata_normalize;
     PyObject *normalized;
-    PyObject *utf8;
+    Py_UCS4 decomposed[3];
+    Py_ssize_t i, len, size;
+    int kind, n, k;
+    const void *data;
+    char *dest, scratch[4];
+
+    *owner = NULL;
+    if (PyUnicode_IS_ASCII(pystr)) {
+        return PyUnicode_AsUTF8(pystr);
+    }
+
+    kind = PyUnicode_KIND(pystr);
+    data = PyUnicode_DATA(pystr);
+    len = PyUnicode_GET_LENGTH(pystr);
+    for (size = 0, i = 0; i < len; i++) {
+        n = jfish_nfkd_latin(PyUnicode_READ(kind, data, i), decomposed);
+        if (!n) {
+            goto fallback;
+        }
+        for (k = 0; k < n; k++) {
+            size += jfish_utf8_encode(decomposed[k], scratch);
+        }
+    }
+
+    if (size < NORMALIZE_BUF) {
+        dest = buf;
+    } else {
+        *owner = PyBytes_FromStringAndSize(NULL, size);
+        if (!*owner) {
+            return NULL;
+        }
+        dest = PyBytes_AS_STRING(*owner);
+    }
+    for (size = 0, i = 0; i < len; i++) {
+        n = jfish_nfkd_latin(PyUnicode_READ(kind, data, i), decomposed);
+        for (k = 0; k < n; k++) {
+            size += jfish_utf8_encode(decomposed[k], dest + size);
+        }
+    }
+    dest[size] = '\0';
+    return dest;
 
+ fallback:
     unicodedata_normalize = GETSTATE(mod)->unicodedata_normalize;
     normalized = PyObject_CallFunction(unicodedata_normalize,
                                        "sO", "NFKD", pystr);
     if (!normalized) {
         return NULL;
     }
-    utf8 = PyUnicode_AsUTF8String(normalized);
+    *owner = PyUnicode_AsUTF8String(normalized);
     Py_DECREF(normalized);
-    return utf8;
+    return *owner ? UTF8_BYTES(*owner) : NULL;
 }
 
 static PyObject * jellyfish_jaro_winkler_similarity(PyObject *self, PyObject *args, PyObject *kw)
@@ -89,6 +214,44 @@ static PyObject * jellyfish_jaro_winkler_similarity(PyObject *self, PyObject *ar
     return Py_BuildValue("d", result);
 }
 
+static PyObject * jellyfish_jaro_winkler_similarity_threshold(PyObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *u1, *u2;
+    Py_UCS4 *s1, *s2;
+    Py_ssize_t len1, len2;
+    double result, min_score;
+    int long_tolerance = 0;
+    static char *keywords[] = {"s1", "s2", "min_score", "long_tolerance", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "UUd|i", keywords, &u1, &u2, &min_score, &long_tolerance)) {
+        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+        return NULL;
+    }
+    s1 = PyUnicode_AsUCS4Copy(u1);
+    if (s1 == NULL) {
+        return NULL;
+    }
+    s2 = PyUnicode_AsUCS4Copy(u2);
+    if (s2 == NULL) {
+        PyMem_Free(s1);
+        return NULL;
+    }
+    len1 = PyUnicode_GET_LENGTH(u1);
+    len2 = PyUnicode_GET_LENGTH(u2);
+
+    result = jaro_winkler_similarity_threshold(s1, len1, s2, len2, long_tolerance, min_score);
+    PyMem_Free(s1);
+    PyMem_Free(s2);
+
+    // see earlier note about jaro_winkler_similarity return value
+    if (result < -1) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    return Py_BuildValue("d", result);
+}
+
 static PyObject * jellyfish_jaro_similarity(PyObject *self, PyObject *args)
 {
     PyObject *u1, *u2;
@@ -227,109 +390,145 @@ static PyObject* jellyfish_damerau_levenshtein_distance(PyObject *self,
     return Py_BuildValue("i", result);
 }
 
-static PyObject* jellyfish_soundex(PyObject *self, PyObject *args)
+static PyObject* jellyfish_levenshtein_parallel(PyObject *self, PyObject *args, PyObject *kw)
 {
-    PyObject *str;
-    PyObject *normalized;
-    PyObject* ret;
-    char *result;
+    PyObject *u1, *u2;
+    Py_UCS4 *s1, *s2;
+    Py_ssize_t len1, len2;
+    int threads = 1, result;
+    static char *keywords[] = {"s1", "s2", "threads", NULL};
 
-    if (!PyArg_ParseTuple(args, "U", &str)) {
-        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "UU|i", keywords, &u1, &u2, &threads)) {
         return NULL;
     }
-
-    normalized = normalize(self, str);
-    if (!normalized) {
+    len1 = PyUnicode_GET_LENGTH(u1);
+    len2 = PyUnicode_GET_LENGTH(u2);
+    s1 = PyUnicode_AsUCS4Copy(u1);
+    if (s1 == NULL) {
         return NULL;
     }
-
-    result = soundex(UTF8_BYTES(normalized));
-    Py_DECREF(normalized);
-
-    if (!result) {
-        // soundex only fails on bad malloc
-        PyErr_NoMemory();
+    s2 = PyUnicode_AsUCS4Copy(u2);
+    if (s2 == NULL) {
+        PyMem_Free(s1);
         return NULL;
     }
 
-    ret = Py_BuildValue("s", result);
-    free(result);
+    Py_BEGIN_ALLOW_THREADS
+    result = levenshtein_distance_parallel(s1, len1, s2, len2, threads);
+    Py_END_ALLOW_THREADS
+    PyMem_Free(s1);
+    PyMem_Free(s2);
 
-    return ret;
+    if (result == -1) {
+        return PyErr_NoMemory();
+    }
+    return Py_BuildValue("i", result);
 }
 
-static PyObject* jellyfish_metaphone(PyObject *self, PyObject *args)
+/* Shared by levenshtein_distance_budget and
+ * damerau_levenshtein_distance_budget: returns (distance, False), or
+ * (lower bound, True) when max_cells or timeout ran out first. */
+static PyObject* budget_distance(PyObject *args, PyObject *kw, int damerau)
 {
-    PyObject *str;
-    PyObject *normalized;
-    PyObject *ret;
-    char *result;
-
-    if (!PyArg_ParseTuple(args, "U", &str)) {
-        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+    PyObject *u1, *u2;
+    Py_UCS4 *s1, *s2;
+    Py_ssize_t len1, len2;
+    unsigned long long max_cells = 0;
+    double timeout = 0.0;
+    struct jfish_budget budget;
+    int result, lower_bound = 0;
+    static char *keywords[] = {"s1", "s2", "max_cells", "timeout", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "UU|Kd", keywords,
+                                     &u1, &u2, &max_cells, &timeout)) {
         return NULL;
     }
-
-    normalized = normalize(self, str);
-    if (!normalized) {
+    if (timeout < 0) {
+        PyErr_SetString(PyExc_ValueError, "timeout must not be negative");
+        return NULL;
+    }
+    len1 = PyUnicode_GET_LENGTH(u1);
+    len2 = PyUnicode_GET_LENGTH(u2);
+    s1 = PyUnicode_AsUCS4Copy(u1);
+    if (s1 == NULL) {
+        return NULL;
+    }
+    s2 = PyUnicode_AsUCS4Copy(u2);
+    if (s2 == NULL) {
+        PyMem_Free(s1);
         return NULL;
     }
 
-    result = metaphone((const char*)UTF8_BYTES(normalized));
-    Py_DECREF(normalized);
+    budget.max_cells = max_cells;
+    budget.deadline = timeout > 0 ? jfish_monotonic_seconds() + timeout : 0;
+    budget.check_rows = 0;
 
-    if (!result) {
-        // metaphone only fails on bad malloc
-        PyErr_NoMemory();
-        return NULL;
+    Py_BEGIN_ALLOW_THREADS
+    if (damerau) {
+        result = damerau_levenshtein_distance_budget(s1, s2, len1, len2, &budget, &lower_bound);
+    } else {
+        result = levenshtein_distance_budget(s1, len1, s2, len2, &budget, &lower_bound);
     }
+    Py_END_ALLOW_THREADS
+    PyMem_Free(s1);
+    PyMem_Free(s2);
 
-    ret = Py_BuildValue("s", result);
-    free(result);
+    if (result == -1) {
+        return PyErr_NoMemory();
+    }
+    if (result == JFISH_BUDGET_EXCEEDED) {
+        return Py_BuildValue("(iO)", lower_bound, Py_True);
+    }
+    return Py_BuildValue("(iO)", result, Py_False);
+}
 
-    return ret;
+static PyObject* jellyfish_levenshtein_budget(PyObject *self, PyObject *args, PyObject *kw)
+{
+    return budget_distance(args, kw, 0);
 }
 
-static PyObject* jellyfish_match_rating_codex(PyObject *self, PyObject *args)
+static PyObject* jellyfish_damerau_levenshtein_budget(PyObject *self, PyObject *args, PyObject *kw)
 {
-    PyObject *ustr, *ustr_upper;
-    Py_UCS4 *str;
-    Py_ssize_t len;
-    Py_UCS4 *result;
-    PyObject *ret;
+    return budget_distance(args, kw, 1);
+}
 
-    if (!PyArg_ParseTuple(args, "U", &ustr)) {
+static PyObject* jellyfish_osa_distance(PyObject *self, PyObject *args)
+{
+    PyObject *u1, *u2;
+    Py_UCS4 *s1, *s2;
+    Py_ssize_t len1, len2;
+    int result;
+
+    if (!PyArg_ParseTuple(args, "UU", &u1, &u2)) {
         PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
         return NULL;
     }
-    ustr_upper = PyObject_CallMethod(ustr, "upper", NULL);
-    len = PyUnicode_GET_LENGTH(ustr_upper);
-    str = PyUnicode_AsUCS4Copy(ustr_upper);
-    if (str == NULL) {
-        Py_DECREF(ustr_upper);
+    len1 = PyUnicode_GET_LENGTH(u1);
+    len2 = PyUnicode_GET_LENGTH(u2);
+    s1 = PyUnicode_AsUCS4Copy(u1);
+    if (s1 == NULL) {
+        return NULL;
+    }
+    s2 = PyUnicode_AsUCS4Copy(u2);
+    if (s2 == NULL) {
+        PyMem_Free(s1);
         return NULL;
     }
 
-    result = match_rating_codex(str, len);
-    PyMem_Free(str);
-    Py_DECREF(ustr_upper);
-    if (!result) {
+    result = osa_distance(s1, len1, s2, len2);
+    PyMem_Free(s1);
+    PyMem_Free(s2);
+    if (result == -1) {
         PyErr_NoMemory();
         return NULL;
     }
-
-    ret = unicode_from_ucs4(result);
-    free(result);
-
-    return ret;
+    return Py_BuildValue("i", result);
 }
 
-static PyObject* jellyfish_match_rating_comparison(PyObject *self,
-                                                   PyObject *args)
+static PyObject* jellyfish_lcs_length(PyObject *self, PyObject *args)
 {
-    PyObject *u1, *u2, *u_upper1, *u_upper2;
-    Py_UCS4 *str1, *str2;
+    PyObject *u1, *u2;
+    Py_UCS4 *s1, *s2;
     Py_ssize_t len1, len2;
     int result;
 
@@ -337,75 +536,2175 @@ static PyObject* jellyfish_match_rating_comparison(PyObject *self,
         PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
         return NULL;
     }
-    u_upper1 = PyObject_CallMethod(u1, "upper", NULL);
-    u_upper2 = PyObject_CallMethod(u2, "upper", NULL);
-    len1 = PyUnicode_GET_LENGTH(u_upper1);
-    len2 = PyUnicode_GET_LENGTH(u_upper2);
-    str1 = PyUnicode_AsUCS4Copy(u_upper1);
-    if (str1 == NULL) {
-        Py_DECREF(u_upper1);
-        Py_DECREF(u_upper2);
+    len1 = PyUnicode_GET_LENGTH(u1);
+    len2 = PyUnicode_GET_LENGTH(u2);
+    s1 = PyUnicode_AsUCS4Copy(u1);
+    if (s1 == NULL) {
         return NULL;
     }
-    str2 = PyUnicode_AsUCS4Copy(u_upper2);
-    if (str2 == NULL) {
-        PyMem_Free(str1);
-        Py_DECREF(u_upper1);
-        Py_DECREF(u_upper2);
+    s2 = PyUnicode_AsUCS4Copy(u2);
+    if (s2 == NULL) {
+        PyMem_Free(s1);
         return NULL;
     }
 
-    result = match_rating_comparison(str1, len1, str2, len2);
-    PyMem_Free(str1);
-    PyMem_Free(str2);
-    Py_DECREF(u_upper1);
-    Py_DECREF(u_upper2);
-
+    result = lcs_length(s1, len1, s2, len2);
+    PyMem_Free(s1);
+    PyMem_Free(s2);
     if (result == -1) {
-        Py_RETURN_NONE;
-    } else if (result) {
-        Py_RETURN_TRUE;
-    } else {
-        Py_RETURN_FALSE;
+        PyErr_NoMemory();
+        return NULL;
     }
+    return Py_BuildValue("i", result);
 }
 
-static PyObject* jellyfish_nysiis(PyObject *self, PyObject *args)
+static PyObject* jellyfish_lcs_similarity(PyObject *self, PyObject *args)
 {
-    PyObject *ustr;
-    Py_UCS4 *str;
-    Py_UCS4 *result;
-    Py_ssize_t len;
-    PyObject *ret;
+    PyObject *u1, *u2;
+    Py_UCS4 *s1, *s2;
+    Py_ssize_t len1, len2;
+    double result;
 
-    if (!PyArg_ParseTuple(args, "U", &ustr)) {
+    if (!PyArg_ParseTuple(args, "UU", &u1, &u2)) {
         PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
         return NULL;
     }
-    str = PyUnicode_AsUCS4Copy(ustr);
-    len = PyUnicode_GET_LENGTH(ustr);
-    if (str == NULL) {
+    len1 = PyUnicode_GET_LENGTH(u1);
+    len2 = PyUnicode_GET_LENGTH(u2);
+    s1 = PyUnicode_AsUCS4Copy(u1);
+    if (s1 == NULL) {
         return NULL;
     }
-
-    result = nysiis(str, len);
-    if (!result) {
-        PyErr_NoMemory();
+    s2 = PyUnicode_AsUCS4Copy(u2);
+    if (s2 == NULL) {
+        PyMem_Free(s1);
         return NULL;
     }
 
-    ret = unicode_from_ucs4(result);
-    free(result);
+    result = lcs_similarity(s1, len1, s2, len2);
+    PyMem_Free(s1);
+    PyMem_Free(s2);
 
-    return ret;
+    // see earlier note about jaro_similarity return value
+    if (result < -1) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    return Py_BuildValue("d", result);
 }
 
+static PyObject* jellyfish_longest_common_substring(PyObject *self, PyObject *args)
+{
+    PyObject *u1, *u2;
+    Py_UCS4 *s1, *s2;
+    Py_ssize_t len1, len2;
+    int result, start1, start2;
+
+    if (!PyArg_ParseTuple(args, "UU", &u1, &u2)) {
+        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+        return NULL;
+    }
+    len1 = PyUnicode_GET_LENGTH(u1);
+    len2 = PyUnicode_GET_LENGTH(u2);
+    s1 = PyUnicode_AsUCS4Copy(u1);
+    if (s1 == NULL) {
+        return NULL;
+    }
+    s2 = PyUnicode_AsUCS4Copy(u2);
+    if (s2 == NULL) {
+        PyMem_Free(s1);
+        return NULL;
+    }
+
+    result = longest_common_substring(s1, len1, s2, len2, &start1, &start2);
+    PyMem_Free(s1);
+    PyMem_Free(s2);
+    if (result == -1) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    return Py_BuildValue("(iii)", result, start1, start2);
+}
+
+static PyObject* jellyfish_longest_common_substring_similarity(PyObject *self, PyObject *args)
+{
+    PyObject *u1, *u2;
+    Py_UCS4 *s1, *s2;
+    Py_ssize_t len1, len2;
+    double result;
+
+    if (!PyArg_ParseTuple(args, "UU", &u1, &u2)) {
+        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+        return NULL;
+    }
+    len1 = PyUnicode_GET_LENGTH(u1);
+    len2 = PyUnicode_GET_LENGTH(u2);
+    s1 = PyUnicode_AsUCS4Copy(u1);
+    if (s1 == NULL) {
+        return NULL;
+    }
+    s2 = PyUnicode_AsUCS4Copy(u2);
+    if (s2 == NULL) {
+        PyMem_Free(s1);
+        return NULL;
+    }
+
+    result = longest_common_substring_similarity(s1, len1, s2, len2);
+    PyMem_Free(s1);
+    PyMem_Free(s2);
+
+    if (result < -1) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    return Py_BuildValue("d", result);
+}
+
+/* Map the metric= keyword of the token scorers to a JFISH_TOKEN_* value,
+ * setting ValueError and returning -1 for unknown names. */
+static int token_metric(const char *name)
+{
+    if (!name || !strcmp(name, "levenshtein")) {
+        return JFISH_TOKEN_LEVENSHTEIN;
+    } else if (!strcmp(name, "jaro_winkler")) {
+        return JFISH_TOKEN_JARO_WINKLER;
+    }
+    PyErr_Format(PyExc_ValueError, "unknown metric '%s'", name);
+    return -1;
+}
+
+static PyObject* jellyfish_token_sort_similarity(PyObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *u1, *u2;
+    Py_UCS4 *s1, *s2;
+    Py_ssize_t len1, len2;
+    const char *metric_name = NULL;
+    int metric;
+    double result;
+    static char *keywords[] = {"s1", "s2", "metric", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "UU|s", keywords, &u1, &u2, &metric_name)) {
+        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+        return NULL;
+    }
+    metric = token_metric(metric_name);
+    if (metric < 0) {
+        return NULL;
+    }
+    len1 = PyUnicode_GET_LENGTH(u1);
+    len2 = PyUnicode_GET_LENGTH(u2);
+    s1 = PyUnicode_AsUCS4Copy(u1);
+    if (s1 == NULL) {
+        return NULL;
+    }
+    s2 = PyUnicode_AsUCS4Copy(u2);
+    if (s2 == NULL) {
+        PyMem_Free(s1);
+        return NULL;
+    }
+
+    result = token_sort_similarity(s1, len1, s2, len2, metric);
+    PyMem_Free(s1);
+    PyMem_Free(s2);
+
+    if (result < -1) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    return Py_BuildValue("d", result);
+}
+
+static PyObject* jellyfish_token_set_similarity(PyObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *u1, *u2;
+    Py_UCS4 *s1, *s2;
+    Py_ssize_t len1, len2;
+    const char *metric_name = NULL;
+    int metric;
+    double result;
+    static char *keywords[] = {"s1", "s2", "metric", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "UU|s", keywords, &u1, &u2, &metric_name)) {
+        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+        return NULL;
+    }
+    metric = token_metric(metric_name);
+    if (metric < 0) {
+        return NULL;
+    }
+    len1 = PyUnicode_GET_LENGTH(u1);
+    len2 = PyUnicode_GET_LENGTH(u2);
+    s1 = PyUnicode_AsUCS4Copy(u1);
+    if (s1 == NULL) {
+        return NULL;
+    }
+    s2 = PyUnicode_AsUCS4Copy(u2);
+    if (s2 == NULL) {
+        PyMem_Free(s1);
+        return NULL;
+    }
+
+    result = token_set_similarity(s1, len1, s2, len2, metric);
+    PyMem_Free(s1);
+    PyMem_Free(s2);
+
+    if (result < -1) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    return Py_BuildValue("d", result);
+}
+
+static PyObject* jellyfish_token_alignment_similarity(PyObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *u1, *u2;
+    Py_UCS4 *s1, *s2;
+    Py_ssize_t len1, len2;
+    const char *metric_name = NULL;
+    int metric;
+    double result;
+    static char *keywords[] = {"s1", "s2", "metric", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "UU|s", keywords, &u1, &u2, &metric_name)) {
+        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+        return NULL;
+    }
+    metric = token_metric(metric_name);
+    if (metric < 0) {
+        return NULL;
+    }
+    len1 = PyUnicode_GET_LENGTH(u1);
+    len2 = PyUnicode_GET_LENGTH(u2);
+    s1 = PyUnicode_AsUCS4Copy(u1);
+    if (s1 == NULL) {
+        return NULL;
+    }
+    s2 = PyUnicode_AsUCS4Copy(u2);
+    if (s2 == NULL) {
+        PyMem_Free(s1);
+        return NULL;
+    }
+
+    result = token_alignment_similarity(s1, len1, s2, len2, metric);
+    PyMem_Free(s1);
+    PyMem_Free(s2);
+
+    if (result < -1) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    return Py_BuildValue("d", result);
+}
+
+static PyObject* jellyfish_soundex(PyObject *self, PyObject *args)
+{
+    PyObject *str;
+    PyObject *owner;
+    const char *normalized;
+    char buf[NORMALIZE_BUF];
+    PyObject* ret;
+    char *result;
+
+    if (!PyArg_ParseTuple(args, "U", &str)) {
+        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+        return NULL;
+    }
+
+    normalized = normalize(self, str, buf, &owner);
+    if (!normalized) {
+        return NULL;
+    }
+
+    result = soundex(normalized);
+    Py_XDECREF(owner);
+
+    if (!result) {
+        // soundex only fails on bad malloc
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    ret = Py_BuildValue("s", result);
+    free(result);
+
+    return ret;
+}
+
+static PyObject* jellyfish_metaphone(PyObject *self, PyObject *args)
+{
+    PyObject *str;
+    PyObject *owner;
+    const char *normalized;
+    char buf[NORMALIZE_BUF];
+    PyObject *ret;
+    char *result;
+
+    if (!PyArg_ParseTuple(args, "U", &str)) {
+        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+        return NULL;
+    }
+
+    normalized = normalize(self, str, buf, &owner);
+    if (!normalized) {
+        return NULL;
+    }
+
+    result = metaphone(normalized);
+    Py_XDECREF(owner);
+
+    if (!result) {
+        // metaphone only fails on bad malloc
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    ret = Py_BuildValue("s", result);
+    free(result);
+
+    return ret;
+}
+
+static PyObject* jellyfish_match_rating_codex(PyObject *self, PyObject *args)
+{
+    PyObject *ustr, *ustr_upper;
+    Py_UCS4 *str;
+    Py_ssize_t len;
+    Py_UCS4 *result;
+    PyObject *ret;
+
+    if (!PyArg_ParseTuple(args, "U", &ustr)) {
+        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+        return NULL;
+    }
+    ustr_upper = PyObject_CallMethod(ustr, "upper", NULL);
+    len = PyUnicode_GET_LENGTH(ustr_upper);
+    str = PyUnicode_AsUCS4Copy(ustr_upper);
+    if (str == NULL) {
+        Py_DECREF(ustr_upper);
+        return NULL;
+    }
+
+    result = match_rating_codex(str, len);
+    PyMem_Free(str);
+    Py_DECREF(ustr_upper);
+    if (!result) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    ret = unicode_from_ucs4(result);
+    free(result);
+
+    return ret;
+}
+
+static PyObject* jellyfish_match_rating_comparison(PyObject *self,
+                                                   PyObject *args)
+{
+    PyObject *u1, *u2, *u_upper1, *u_upper2;
+    Py_UCS4 *str1, *str2;
+    Py_ssize_t len1, len2;
+    int result;
+
+    if (!PyArg_ParseTuple(args, "UU", &u1, &u2)) {
+        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+        return NULL;
+    }
+    u_upper1 = PyObject_CallMethod(u1, "upper", NULL);
+    u_upper2 = PyObject_CallMethod(u2, "upper", NULL);
+    len1 = PyUnicode_GET_LENGTH(u_upper1);
+    len2 = PyUnicode_GET_LENGTH(u_upper2);
+    str1 = PyUnicode_AsUCS4Copy(u_upper1);
+    if (str1 == NULL) {
+        Py_DECREF(u_upper1);
+        Py_DECREF(u_upper2);
+        return NULL;
+    }
+    str2 = PyUnicode_AsUCS4Copy(u_upper2);
+    if (str2 == NULL) {
+        PyMem_Free(str1);
+        Py_DECREF(u_upper1);
+        Py_DECREF(u_upper2);
+        return NULL;
+    }
+
+    result = match_rating_comparison(str1, len1, str2, len2);
+    PyMem_Free(str1);
+    PyMem_Free(str2);
+    Py_DECREF(u_upper1);
+    Py_DECREF(u_upper2);
+
+    if (result == -1) {
+        Py_RETURN_NONE;
+    } else if (result) {
+        Py_RETURN_TRUE;
+    } else {
+        Py_RETURN_FALSE;
+    }
+}
+
+static PyObject* jellyfish_nysiis(PyObject *self, PyObject *args)
+{
+    PyObject *ustr;
+    Py_UCS4 *str;
+    Py_UCS4 *result;
+    Py_ssize_t len;
+    PyObject *ret;
+
+    if (!PyArg_ParseTuple(args, "U", &ustr)) {
+        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+        return NULL;
+    }
+    str = PyUnicode_AsUCS4Copy(ustr);
+    len = PyUnicode_GET_LENGTH(ustr);
+    if (str == NULL) {
+        return NULL;
+    }
+
+    result = nysiis(str, len);
+    PyMem_Free(str);
+    if (!result) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    ret = unicode_from_ucs4(result);
+    free(result);
+
+    return ret;
+}
+
+
+static PyObject* jellyfish_porter_stem(PyObject *self, PyObject *args)
+{
+    PyObject *ustr, *ret;
+    Py_UCS4 *str;
+    Py_ssize_t len;
+    struct stemmer *z;
+    int end;
+
+    if (!PyArg_ParseTuple(args, "U", &ustr)) {
+        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+        return NULL;
+    }
+    len = PyUnicode_GET_LENGTH(ustr);
+    str = PyUnicode_AsUCS4Copy(ustr);
+    if (str == NULL) {
+        return NULL;
+    }
+
+    z = create_stemmer();
+    if (!z) {
+        PyMem_Free(str);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    end = stem(z, str, (int)len - 1);
+    free_stemmer(z);
+
+    ret = PyUnicode_FromKindAndData(PyUnicode_4BYTE_KIND, str, end + 1);
+    PyMem_Free(str);
+
+    return ret;
+}
+
+
+/* Batch scoring.
+ *
+ * The *_batch functions take either two equal length sequences of str
+ * (scored pairwise) or a str and a sequence (the str is scored against
+ * every element).  The strings are copied to UCS4 once, the GIL is
+ * released while scoring, the work is optionally split over threads, and
+ * the scores come back as a flat 'i' (int32) or 'd' (float64) memoryview
+ * that numpy and array.array can consume without boxing every element.
+ */
+enum {
+    BATCH_LEVENSHTEIN,
+    BATCH_DAMERAU_LEVENSHTEIN,
+    BATCH_HAMMING,
+    BATCH_JARO,
+    BATCH_JARO_WINKLER
+};
+
+struct pair_batch {
+    int metric;
+    struct jellyfish_query *query;
+    Py_UCS4 **strs1, **strs2;
+    int *lens1, *lens2;
+    Py_ssize_t count;
+    int broadcast;
+    void *out;
+    int failed[JFISH_MAX_THREADS];  /* per thread, combined after the join */
+};
+
+static void pair_batch_worker(void *ctx, int index, int nthreads)
+{
+    struct pair_batch *batch = ctx;
+    Py_ssize_t i, j, chunk, lo, hi;
+    int result = 0;
+    double score = 0;
+
+    chunk = (batch->count + nthreads - 1) / nthreads;
+    lo = MIN(batch->count, index * chunk);
+    hi = MIN(batch->count, lo + chunk);
+
+    for (i = lo; i < hi; i++) {
+        j = batch->broadcast ? 0 : i;
+        if (batch->query) {
+            if (batch->metric == BATCH_LEVENSHTEIN) {
+                result = jellyfish_query_levenshtein(batch->query, batch->strs2[i], batch->lens2[i]);
+            } else if (batch->metric == BATCH_JARO) {
+                score = jellyfish_query_jaro(batch->query, batch->strs2[i], batch->lens2[i]);
+            } else {
+                score = jellyfish_query_jaro_winkler(batch->query, batch->strs2[i], batch->lens2[i], 0);
+            }
+        } else switch (batch->metric) {
+        case BATCH_LEVENSHTEIN:
+            result = levenshtein_distance(batch->strs1[j], batch->lens1[j],
+                                          batch->strs2[i], batch->lens2[i]);
+            break;
+        case BATCH_DAMERAU_LEVENSHTEIN:
+            result = damerau_levenshtein_distance(batch->strs1[j], batch->strs2[i],
+                                                  batch->lens1[j], batch->lens2[i]);
+            break;
+        case BATCH_HAMMING:
+            result = hamming_distance(batch->strs1[j], batch->lens1[j],
+                                      batch->strs2[i], batch->lens2[i]);
+            break;
+        case BATCH_JARO:
+            score = jaro_similarity(batch->strs1[j], batch->lens1[j],
+                                    batch->strs2[i], batch->lens2[i]);
+            break;
+        default:
+            score = jaro_winkler_similarity(batch->strs1[j], batch->lens1[j],
+                                            batch->strs2[i], batch->lens2[i], 0);
+            break;
+        }
+
+        if (batch->metric == BATCH_JARO || batch->metric == BATCH_JARO_WINKLER) {
+            if (score < -1) {
+                batch->failed[index] = 1;
+            }
+            ((double*)batch->out)[i] = score;
+        } else {
+            if (result == -1) {
+                batch->failed[index] = 1;
+            }
+            ((int*)batch->out)[i] = result;
+        }
+    }
+}
+
+static PyObject* pair_batch(PyObject *args, PyObject *kw, int metric)
+{
+    PyObject *a, *b, *out = NULL, *view, *ret = NULL;
+    struct pair_batch batch;
+    Py_ssize_t count1, count2;
+    int threads = 1, t;
+    int is_double = metric == BATCH_JARO || metric == BATCH_JARO_WINKLER;
+    static char *keywords[] = {"s1", "s2", "threads", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "OO|i", keywords, &a, &b, &threads)) {
+        return NULL;
+    }
+
+    memset(&batch, 0, sizeof(batch));
+    batch.metric = metric;
+    batch.broadcast = PyUnicode_Check(a);
+    if (batch.broadcast) {
+        a = PyTuple_Pack(1, a);
+        if (!a) {
+            return NULL;
+        }
+    } else {
+        Py_INCREF(a);
+    }
+    count1 = ucs4_sequence(a, &batch.strs1, &batch.lens1);
+    Py_DECREF(a);
+    if (count1 < 0) {
+        return NULL;
+    }
+    count2 = ucs4_sequence(b, &batch.strs2, &batch.lens2);
+    if (count2 < 0) {
+        goto cleanup;
+    }
+    if (!batch.broadcast && count1 != count2) {
+        PyErr_SetString(PyExc_ValueError, "sequences must have the same length");
+        goto cleanup;
+    }
+    batch.count = count2;
+
+    /* one query against many: precompile it for the metrics that can use it */
+    if (batch.broadcast && (metric == BATCH_LEVENSHTEIN || metric == BATCH_JARO ||
+                            metric == BATCH_JARO_WINKLER)) {
+        batch.query = jellyfish_query_create(batch.strs1[0], batch.lens1[0]);
+        if (!batch.query) {
+            PyErr_NoMemory();
+            goto cleanup;
+        }
+    }
+
+    out = PyBytes_FromStringAndSize(NULL, count2 * (is_double ? sizeof(double) : sizeof(int)));
+    if (!out) {
+        goto cleanup;
+    }
+    batch.out = PyBytes_AS_STRING(out);
+
+    threads = (int)MIN(MIN(count2, threads), JFISH_MAX_THREADS);
+    if (threads < 1) {
+        threads = 1;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    jfish_parallel_run(pair_batch_worker, &batch, threads);
+    Py_END_ALLOW_THREADS
+    for (t = 0; t < threads; t++) {
+        if (batch.failed[t]) {
+            PyErr_NoMemory();
+            goto cleanup;
+        }
+    }
+
+    view = PyMemoryView_FromObject(out);
+    if (view) {
+        ret = PyObject_CallMethod(view, "cast", "s", is_double ? "d" : "i");
+        Py_DECREF(view);
+    }
+
+ cleanup:
+    Py_XDECREF(out);
+    jellyfish_query_free(batch.query);
+    free_ucs4_sequence(batch.strs1, batch.lens1, count1);
+    free_ucs4_sequence(batch.strs2, batch.lens2, count2 < 0 ? 0 : count2);
+    return ret;
+}
+
+static PyObject* jellyfish_levenshtein_distance_batch(PyObject *self, PyObject *args, PyObject *kw)
+{
+    return pair_batch(args, kw, BATCH_LEVENSHTEIN);
+}
+
+static PyObject* jellyfish_damerau_levenshtein_distance_batch(PyObject *self, PyObject *args, PyObject *kw)
+{
+    return pair_batch(args, kw, BATCH_DAMERAU_LEVENSHTEIN);
+}
+
+static PyObject* jellyfish_hamming_distance_batch(PyObject *self, PyObject *args, PyObject *kw)
+{
+    return pair_batch(args, kw, BATCH_HAMMING);
+}
+
+static PyObject* jellyfish_jaro_similarity_batch(PyObject *self, PyObject *args, PyObject *kw)
+{
+    return pair_batch(args, kw, BATCH_JARO);
+}
+
+static PyObject* jellyfish_jaro_winkler_similarity_batch(PyObject *self, PyObject *args, PyObject *kw)
+{
+    return pair_batch(args, kw, BATCH_JARO_WINKLER);
+}
+
+/* Turn an iterable of key names (None for all of them) into
+ * JFISH_PHONETIC_* flags, or -1 with an exception set. */
+static int phonetic_flags(PyObject *keys)
+{
+    PyObject *seq, *item;
+    const char *name;
+    Py_ssize_t i;
+    int flags = 0;
+
+    if (!keys || keys == Py_None) {
+        return JFISH_PHONETIC_ALL;
+    }
+    seq = PySequence_Fast(keys, "keys must be a sequence of str");
+    if (!seq) {
+        return -1;
+    }
+    for (i = 0; i < PySequence_Fast_GET_SIZE(seq); i++) {
+        item = PySequence_Fast_GET_ITEM(seq, i);
+        name = PyUnicode_Check(item) ? PyUnicode_AsUTF8(item) : NULL;
+        if (!name) {
+            Py_DECREF(seq);
+            PyErr_SetString(PyExc_TypeError, "keys must be a sequence of str");
+            return -1;
+        }
+        if (!strcmp(name, "soundex")) {
+            flags |= JFISH_PHONETIC_SOUNDEX;
+        } else if (!strcmp(name, "metaphone")) {
+            flags |= JFISH_PHONETIC_METAPHONE;
+        } else if (!strcmp(name, "nysiis")) {
+            flags |= JFISH_PHONETIC_NYSIIS;
+        } else if (!strcmp(name, "match_rating_codex")) {
+            flags |= JFISH_PHONETIC_MATCH_RATING;
+        } else {
+            Py_DECREF(seq);
+            PyErr_Format(PyExc_ValueError, "unknown key '%s'", name);
+            return -1;
+        }
+    }
+    Py_DECREF(seq);
+    return flags;
+}
+
+/* phonetic_keys() matches the separate functions exactly when the string
+ * is covered by the native NFKD table and str.upper() maps it one to one
+ * (ß, ŉ, ǰ and U+1E96..U+1E9A expand). */
+static int phonetic_native(const Py_UCS4 *str, Py_ssize_t len)
+{
+    Py_UCS4 decomposed[3];
+    Py_ssize_t i;
+
+    for (i = 0; i < len; i++) {
+        if (str[i] < 0x80) {
+            continue;
+        }
+        if (!jfish_nfkd_latin(str[i], decomposed) || str[i] == 0xDF || str[i] == 0x149 ||
+            str[i] == 0x1F0 || (str[i] >= 0x1E96 && str[i] <= 0x1E9A)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* The separate functions, in JFISH_PHONETIC_* bit order. */
+static PyObject* (*const phonetic_fns[4])(PyObject*, PyObject*) = {
+    jellyfish_soundex, jellyfish_metaphone, jellyfish_nysiis, jellyfish_match_rating_codex
+};
+
+/* Key k of ustr computed by its separate function. */
+static PyObject* phonetic_fallback_key(PyObject *self, PyObject *ustr, int k)
+{
+    PyObject *args, *ret;
+
+    args = PyTuple_Pack(1, ustr);
+    if (!args) {
+        return NULL;
+    }
+    ret = phonetic_fns[k](self, args);
+    Py_DECREF(args);
+    return ret;
+}
+
+/* (soundex, metaphone, nysiis, match_rating_codex) with None for the keys
+ * that were not requested, computed by the separate functions. */
+static PyObject* phonetic_fallback(PyObject *self, PyObject *ustr, int flags)
+{
+    PyObject *ret, *item;
+    int k;
+
+    ret = PyTuple_New(4);
+    if (!ret) {
+        return NULL;
+    }
+    for (k = 0; k < 4; k++) {
+        if (flags & (1 << k)) {
+            item = phonetic_fallback_key(self, ustr, k);
+            if (!item) {
+                Py_DECREF(ret);
+                return NULL;
+            }
+        } else {
+            item = Py_None;
+            Py_INCREF(item);
+        }
+        PyTuple_SET_ITEM(ret, k, item);
+    }
+    return ret;
+}
+
+/* Key k of keys as a str, or None if it was not requested. */
+static PyObject* phonetic_key(const struct jfish_phonetic_keys *keys, int k)
+{
+    if (!(keys->flags & (1 << k))) {
+        Py_RETURN_NONE;
+    }
+    switch (k) {
+    case 0:
+        return PyUnicode_FromString(keys->soundex);
+    case 1:
+        return PyUnicode_FromString(keys->metaphone);
+    case 2:
+        return unicode_from_ucs4(keys->nysiis);
+    default:
+        return unicode_from_ucs4(keys->match_rating_codex);
+    }
+}
+
+static PyObject* phonetic_tuple(const struct jfish_phonetic_keys *keys)
+{
+    PyObject *ret, *item;
+    int k;
+
+    ret = PyTuple_New(4);
+    if (!ret) {
+        return NULL;
+    }
+    for (k = 0; k < 4; k++) {
+        item = phonetic_key(keys, k);
+        if (!item) {
+            Py_DECREF(ret);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(ret, k, item);
+    }
+    return ret;
+}
+
+static PyObject* jellyfish_phonetic_keys(PyObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *ustr, *keys = NULL;
+    struct jfish_phonetic_keys out;
+    Py_UCS4 *str;
+    Py_ssize_t len;
+    int flags, result;
+    static char *keywords[] = {"string", "keys", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "U|O", keywords, &ustr, &keys)) {
+        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+        return NULL;
+    }
+    flags = phonetic_flags(keys);
+    if (flags < 0) {
+        return NULL;
+    }
+    len = PyUnicode_GET_LENGTH(ustr);
+    str = PyUnicode_AsUCS4Copy(ustr);
+    if (str == NULL) {
+        return NULL;
+    }
+    if (!phonetic_native(str, len)) {
+        PyMem_Free(str);
+        return phonetic_fallback(self, ustr, flags);
+    }
+
+    result = phonetic_keys(str, len, flags, &out);
+    PyMem_Free(str);
+    if (result < 0) {
+        return PyErr_NoMemory();
+    }
+    if (out.truncated) {
+        return phonetic_fallback(self, ustr, flags);
+    }
+    return phonetic_tuple(&out);
+}
+
+/* Strings per phonetic_keys_batch() call: a block is copied into one
+ * reused buffer and its keys stay in cache while they become objects. */
+#define PHONETIC_BLOCK 256
+
+/* phonetic_keys() over a sequence, a block at a time with the GIL
+ * released.  key is the index of the only key to return per string, or -1
+ * for the tuple of flags. */
+static PyObject* phonetic_batch(PyObject *self, PyObject *strings, int flags, int key)
+{
+    PyObject *seq, *ret, *item;
+    struct jfish_phonetic_keys *out;
+    Py_UCS4 *strs[PHONETIC_BLOCK];
+    int lens[PHONETIC_BLOCK];
+    Py_UCS4 *pool = NULL, *grown;
+    size_t pool_size = 0, total;
+    Py_ssize_t i, lo, n, count;
+    int result;
+
+    seq = PySequence_Fast(strings, "strings must be a sequence of str");
+    if (!seq) {
+        return NULL;
+    }
+    count = PySequence_Fast_GET_SIZE(seq);
+    out = safe_malloc(PHONETIC_BLOCK, sizeof(struct jfish_phonetic_keys));
+    ret = out ? PyList_New(count) : PyErr_NoMemory();
+
+    for (lo = 0; ret && lo < count; lo += n) {
+        n = MIN(count - lo, PHONETIC_BLOCK);
+        for (total = 0, i = 0; i < n; i++) {
+            item = PySequence_Fast_GET_ITEM(seq, lo + i);
+            if (!PyUnicode_Check(item)) {
+                PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+                Py_CLEAR(ret);
+                goto cleanup;
+            }
+            lens[i] = (int)PyUnicode_GET_LENGTH(item);
+            total += lens[i];
+        }
+        if (total >= pool_size) {
+            grown = PyMem_Realloc(pool, (total + 1) * sizeof(Py_UCS4));
+            if (!grown) {
+                Py_CLEAR(ret);
+                PyErr_NoMemory();
+                goto cleanup;
+            }
+            pool = grown;
+            pool_size = total + 1;
+        }
+        for (total = 0, i = 0; i < n; i++) {
+            strs[i] = pool + total;
+            PyUnicode_AsUCS4(PySequence_Fast_GET_ITEM(seq, lo + i), strs[i], lens[i], 0);
+            total += lens[i];
+        }
+
+        Py_BEGIN_ALLOW_THREADS
+        result = phonetic_keys_batch((const Py_UCS4* const*)strs, lens, (int)n, flags, out);
+        Py_END_ALLOW_THREADS
+        if (result < 0) {
+            Py_CLEAR(ret);
+            PyErr_NoMemory();
+            goto cleanup;
+        }
+
+        for (i = 0; i < n; i++) {
+            if (out[i].truncated || !phonetic_native(strs[i], lens[i])) {
+                item = PySequence_Fast_GET_ITEM(seq, lo + i);
+                item = key < 0 ? phonetic_fallback(self, item, flags)
+                               : phonetic_fallback_key(self, item, key);
+            } else {
+                item = key < 0 ? phonetic_tuple(&out[i]) : phonetic_key(&out[i], key);
+            }
+            if (!item) {
+                Py_CLEAR(ret);
+                goto cleanup;
+            }
+            PyList_SET_ITEM(ret, lo + i, item);
+        }
+    }
+
+ cleanup:
+    PyMem_Free(pool);
+    free(out);
+    Py_DECREF(seq);
+    return ret;
+}
+
+static PyObject* jellyfish_phonetic_keys_batch(PyObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *strings, *keys = NULL;
+    int flags;
+    static char *keywords[] = {"strings", "keys", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|O", keywords, &strings, &keys)) {
+        return NULL;
+    }
+    flags = phonetic_flags(keys);
+    if (flags < 0) {
+        return NULL;
+    }
+    return phonetic_batch(self, strings, flags, -1);
+}
+
+static PyObject* jellyfish_soundex_batch(PyObject *self, PyObject *strings)
+{
+    return phonetic_batch(self, strings, JFISH_PHONETIC_SOUNDEX, 0);
+}
+
+static PyObject* jellyfish_metaphone_batch(PyObject *self, PyObject *strings)
+{
+    return phonetic_batch(self, strings, JFISH_PHONETIC_METAPHONE, 1);
+}
+
+static PyObject* jellyfish_nysiis_batch(PyObject *self, PyObject *strings)
+{
+    return phonetic_batch(self, strings, JFISH_PHONETIC_NYSIIS, 2);
+}
+
+static PyObject* jellyfish_match_rating_codex_batch(PyObject *self, PyObject *strings)
+{
+    return phonetic_batch(self, strings, JFISH_PHONETIC_MATCH_RATING, 3);
+}
+
+static const struct {
+    const char *name;
+    int bit;
+} feature_names[] = {
+    {"levenshtein", JFISH_FEATURE_LEVENSHTEIN},
+    {"damerau_levenshtein", JFISH_FEATURE_DAMERAU_LEVENSHTEIN},
+    {"jaro", JFISH_FEATURE_JARO},
+    {"jaro_winkler", JFISH_FEATURE_JARO_WINKLER},
+    {"hamming", JFISH_FEATURE_HAMMING},
+    {"match_rating", JFISH_FEATURE_MATCH_RATING},
+    {"soundex", JFISH_FEATURE_SOUNDEX},
+    {"metaphone", JFISH_FEATURE_METAPHONE},
+    {"nysiis", JFISH_FEATURE_NYSIIS},
+    {NULL, 0}
+};
+
+/* Turn an iterable of feature names (None for all of them) into
+ * JFISH_FEATURE_* bits, or -1 with an exception set. */
+static int feature_mask(PyObject *features)
+{
+    PyObject *seq, *item;
+    const char *name;
+    Py_ssize_t i;
+    int k, mask = 0;
+
+    if (!features || features == Py_None) {
+        return JFISH_FEATURE_ALL;
+    }
+    seq = PySequence_Fast(features, "features must be a sequence of str");
+    if (!seq) {
+        return -1;
+    }
+    for (i = 0; i < PySequence_Fast_GET_SIZE(seq); i++) {
+        item = PySequence_Fast_GET_ITEM(seq, i);
+        name = PyUnicode_Check(item) ? PyUnicode_AsUTF8(item) : NULL;
+        if (!name) {
+            Py_DECREF(seq);
+            PyErr_SetString(PyExc_TypeError, "features must be a sequence of str");
+            return -1;
+        }
+        for (k = 0; feature_names[k].name && strcmp(name, feature_names[k].name); k++);
+        if (!feature_names[k].name) {
+            Py_DECREF(seq);
+            PyErr_Format(PyExc_ValueError, "unknown feature '%s'", name);
+            return -1;
+        }
+        mask |= feature_names[k].bit;
+    }
+    Py_DECREF(seq);
+    return mask;
+}
+
+/* phonetic_native() for both strings of a pair, when mask asks for
+ * soundex or metaphone. */
+static int features_native(const Py_UCS4 *s1, Py_ssize_t len1, const Py_UCS4 *s2, Py_ssize_t len2,
+                           int mask)
+{
+    return !(mask & (JFISH_FEATURE_SOUNDEX | JFISH_FEATURE_METAPHONE)) ||
+        (phonetic_native(s1, len1) && phonetic_native(s2, len2));
+}
+
+/* Overwrite the soundex and metaphone entries of a pair's feature row with
+ * keys computed through normalize(), as soundex() and metaphone() do, for
+ * strings outside the native NFKD table.  Returns 0, or -1 with an
+ * exception set. */
+static int features_fallback(PyObject *self, PyObject *u1, PyObject *u2, int mask, double *row)
+{
+    PyObject *ustrs[2] = {u1, u2}, *owner;
+    const char *normalized;
+    char buf[NORMALIZE_BUF];
+    char codes[2][5];
+    char *metaphones[2] = {NULL, NULL};
+    int k, n, ret = -1;
+
+    for (k = 0; k < 2; k++) {
+        normalized = normalize(self, ustrs[k], buf, &owner);
+        if (!normalized) {
+            goto cleanup;
+        }
+        soundex_into(normalized, codes[k]);
+        if (mask & JFISH_FEATURE_METAPHONE) {
+            metaphones[k] = metaphone(normalized);
+        }
+        Py_XDECREF(owner);
+        if ((mask & JFISH_FEATURE_METAPHONE) && !metaphones[k]) {
+            PyErr_NoMemory();
+            goto cleanup;
+        }
+    }
+
+    /* features are written in bit order */
+    n = jellyfish_feature_count(mask & (JFISH_FEATURE_SOUNDEX - 1));
+    if (mask & JFISH_FEATURE_SOUNDEX) {
+        row[n++] = !strcmp(codes[0], codes[1]);
+    }
+    if (mask & JFISH_FEATURE_METAPHONE) {
+        row[n++] = !strcmp(metaphones[0], metaphones[1]);
+    }
+    ret = 0;
+
+ cleanup:
+    free(metaphones[0]);
+    free(metaphones[1]);
+    return ret;
+}
+
+static PyObject* jellyfish_features(PyObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *u1, *u2, *features = NULL, *ret, *value;
+    double out[32];
+    Py_UCS4 *s1, *s2;
+    Py_ssize_t len1, len2;
+    int mask, i, n, native;
+    static char *keywords[] = {"s1", "s2", "features", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "UU|O", keywords, &u1, &u2, &features)) {
+        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+        return NULL;
+    }
+    mask = feature_mask(features);
+    if (mask < 0) {
+        return NULL;
+    }
+    len1 = PyUnicode_GET_LENGTH(u1);
+    len2 = PyUnicode_GET_LENGTH(u2);
+    s1 = PyUnicode_AsUCS4Copy(u1);
+    if (!s1) {
+        return NULL;
+    }
+    s2 = PyUnicode_AsUCS4Copy(u2);
+    if (!s2) {
+        PyMem_Free(s1);
+        return NULL;
+    }
+
+    n = jellyfish_pair_features(s1, len1, s2, len2, mask, out);
+    native = features_native(s1, len1, s2, len2, mask);
+    PyMem_Free(s1);
+    PyMem_Free(s2);
+    if (n < 0) {
+        return PyErr_NoMemory();
+    }
+    if (!native && features_fallback(self, u1, u2, mask, out) < 0) {
+        return NULL;
+    }
+
+    ret = PyTuple_New(n);
+    for (i = 0; ret && i < n; i++) {
+        value = PyFloat_FromDouble(out[i]);
+        if (!value) {
+            Py_CLEAR(ret);
+            break;
+        }
+        PyTuple_SET_ITEM(ret, i, value);
+    }
+    return ret;
+}
+
+static PyObject* jellyfish_features_batch(PyObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *a, *b, *features = NULL, *out = NULL, *view, *shape, *ret = NULL;
+    PyObject *seq1 = NULL, *seq2 = NULL;
+    Py_UCS4 **strs1 = NULL, **strs2 = NULL;
+    int *lens1 = NULL, *lens2 = NULL;
+    Py_ssize_t i, count1, count2 = -1;
+    int threads = 1, mask, width, result;
+    static char *keywords[] = {"s1", "s2", "features", "threads", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "OO|Oi", keywords, &a, &b, &features, &threads)) {
+        return NULL;
+    }
+    mask = feature_mask(features);
+    if (mask < 0) {
+        return NULL;
+    }
+    width = jellyfish_feature_count(mask);
+
+    /* kept for features_fallback(), which needs the str objects */
+    seq1 = PySequence_Fast(a, "sequence of str expected");
+    seq2 = seq1 ? PySequence_Fast(b, "sequence of str expected") : NULL;
+    if (!seq2) {
+        Py_XDECREF(seq1);
+        return NULL;
+    }
+    count1 = ucs4_sequence(seq1, &strs1, &lens1);
+    if (count1 < 0) {
+        goto cleanup;
+    }
+    count2 = ucs4_sequence(seq2, &strs2, &lens2);
+    if (count2 < 0) {
+        goto cleanup;
+    }
+    if (count1 != count2) {
+        PyErr_SetString(PyExc_ValueError, "sequences must have the same length");
+        goto cleanup;
+    }
+
+    out = PyBytes_FromStringAndSize(NULL, count1 * width * sizeof(double));
+    if (!out) {
+        goto cleanup;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    result = jellyfish_pair_features_batch((const Py_UCS4* const*)strs1, lens1,
+                                           (const Py_UCS4* const*)strs2, lens2,
+                                           (int)count1, mask, (double*)PyBytes_AS_STRING(out),
+                                           threads);
+    Py_END_ALLOW_THREADS
+    if (result < 0) {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+    for (i = 0; i < count1; i++) {
+        if (features_native(strs1[i], lens1[i], strs2[i], lens2[i], mask)) {
+            continue;
+        }
+        if (features_fallback(self, PySequence_Fast_GET_ITEM(seq1, i),
+                              PySequence_Fast_GET_ITEM(seq2, i), mask,
+                              (double*)PyBytes_AS_STRING(out) + i * width) < 0) {
+            goto cleanup;
+        }
+    }
+
+    /* memoryview.cast() refuses zeros in the shape, so empty results stay flat */
+    view = PyMemoryView_FromObject(out);
+    if (view && (!count1 || !width)) {
+        ret = PyObject_CallMethod(view, "cast", "s", "d");
+    } else if (view) {
+        shape = Py_BuildValue("(ni)", count1, width);
+        if (shape) {
+            ret = PyObject_CallMethod(view, "cast", "sO", "d", shape);
+            Py_DECREF(shape);
+        }
+    }
+    Py_XDECREF(view);
+
+ cleanup:
+    Py_XDECREF(seq1);
+    Py_XDECREF(seq2);
+    Py_XDECREF(out);
+    free_ucs4_sequence(strs1, lens1, count1);
+    free_ucs4_sequence(strs2, lens2, count2 < 0 ? 0 : count2);
+    return ret;
+}
+
+static PyObject* jellyfish_minhash_signatures(PyObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *strings, *seq, *item, *ret = NULL;
+    struct minhash *mh;
+    Py_UCS4 *str;
+    int num_perm = 128, shingle = 3;
+    unsigned long long seed = 1;
+    Py_ssize_t i, count;
+    static char *keywords[] = {"strings", "num_perm", "shingle", "seed", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|iiK", keywords,
+                                     &strings, &num_perm, &shingle, &seed)) {
+        return NULL;
+    }
+    if (num_perm < 1 || shingle < 1) {
+        PyErr_SetString(PyExc_ValueError, "num_perm and shingle must be positive");
+        return NULL;
+    }
+    seq = PySequence_Fast(strings, "strings must be a sequence of str");
+    if (!seq) {
+        return NULL;
+    }
+    count = PySequence_Fast_GET_SIZE(seq);
+
+    mh = minhash_create(num_perm, shingle, seed);
+    if (!mh) {
+        Py_DECREF(seq);
+        return PyErr_NoMemory();
+    }
+    ret = PyBytes_FromStringAndSize(NULL, count * num_perm * sizeof(uint32_t));
+    if (!ret) {
+        goto cleanup;
+    }
+
+    for (i = 0; i < count; i++) {
+        item = PySequence_Fast_GET_ITEM(seq, i);
+        if (!PyUnicode_Check(item)) {
+            PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+            Py_CLEAR(ret);
+            goto cleanup;
+        }
+        str = PyUnicode_AsUCS4Copy(item);
+        if (!str) {
+            Py_CLEAR(ret);
+            goto cleanup;
+        }
+        minhash_signature(mh, str, PyUnicode_GET_LENGTH(item),
+                          (uint32_t*)PyBytes_AS_STRING(ret) + i * num_perm);
+        PyMem_Free(str);
+    }
+
+ cleanup:
+    minhash_free(mh);
+    Py_DECREF(seq);
+    return ret;
+}
+
+static PyObject* jellyfish_lsh_candidate_pairs(PyObject *self, PyObject *args, PyObject *kw)
+{
+    Py_buffer sigs;
+    PyObject *ret;
+    int num_perm, bands, result;
+    int *pairs;
+    size_t npairs;
+    Py_ssize_t count;
+    static char *keywords[] = {"signatures", "num_perm", "bands", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "y*ii", keywords, &sigs, &num_perm, &bands)) {
+        return NULL;
+    }
+    if (num_perm < 1 || bands < 1 || bands > num_perm ||
+        sigs.len % (num_perm * sizeof(uint32_t))) {
+        PyBuffer_Release(&sigs);
+        PyErr_SetString(PyExc_ValueError,
+                        "signatures must hold whole num_perm rows and "
+                        "bands must be between 1 and num_perm");
+        return NULL;
+    }
+    count = sigs.len / (num_perm * sizeof(uint32_t));
+
+    Py_BEGIN_ALLOW_THREADS
+    result = lsh_candidate_pairs(sigs.buf, count, num_perm, bands, &pairs, &npairs);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&sigs);
+    if (result < 0) {
+        return PyErr_NoMemory();
+    }
+
+    ret = pairs_to_list(pairs, npairs);
+    free(pairs);
+    return ret;
+}
+
+static PyObject* jellyfish_sorted_neighborhood_pairs(PyObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *strings, *ret;
+    Py_UCS4 **strs;
+    int *lens, *pairs;
+    const char *key_name = "soundex";
+    int key_type, window = 10, threads = 1, result;
+    double min_score = 0.9;
+    Py_ssize_t count;
+    size_t npairs;
+    static char *keywords[] = {"strings", "key", "window", "min_score", "threads", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|sidi", keywords, &strings, &key_name,
+                                     &window, &min_score, &threads)) {
+        return NULL;
+    }
+    if (!strcmp(key_name, "soundex")) {
+        key_type = JFISH_KEY_SOUNDEX;
+    } else if (!strcmp(key_name, "nysiis")) {
+        key_type = JFISH_KEY_NYSIIS;
+    } else {
+        PyErr_Format(PyExc_ValueError, "unknown key '%s'", key_name);
+        return NULL;
+    }
+    count = ucs4_sequence(strings, &strs, &lens);
+    if (count < 0) {
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    result = sorted_neighborhood_pairs((const Py_UCS4* const*)strs, lens, count, key_type,
+                                       window, min_score, threads, &pairs, &npairs);
+    Py_END_ALLOW_THREADS
+    free_ucs4_sequence(strs, lens, count);
+    if (result < 0) {
+        return PyErr_NoMemory();
+    }
+
+    ret = pairs_to_list(pairs, npairs);
+    free(pairs);
+    return ret;
+}
+
+static PyObject* jellyfish_topk_matches(PyObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *pyquery, *candidates, *ret, *item;
+    Py_UCS4 *query;
+    Py_UCS4 **strs;
+    int *lens;
+    struct jfish_match *matches;
+    const char *metric_name = NULL;
+    int metric, k, threads = 1, result, i;
+    Py_ssize_t count, query_len;
+    static char *keywords[] = {"query", "candidates", "k", "metric", "threads", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "UOi|si", keywords, &pyquery, &candidates,
+                                     &k, &metric_name, &threads)) {
+        return NULL;
+    }
+    metric = token_metric(metric_name);
+    if (metric < 0) {
+        return NULL;
+    }
+    if (k < 0) {
+        PyErr_SetString(PyExc_ValueError, "k must not be negative");
+        return NULL;
+    }
+    query_len = PyUnicode_GET_LENGTH(pyquery);
+    query = PyUnicode_AsUCS4Copy(pyquery);
+    if (!query) {
+        return NULL;
+    }
+    count = ucs4_sequence(candidates, &strs, &lens);
+    if (count < 0) {
+        PyMem_Free(query);
+        return NULL;
+    }
+    matches = safe_malloc((size_t)MIN(k, count) + 1, sizeof(struct jfish_match));
+    if (!matches) {
+        free_ucs4_sequence(strs, lens, count);
+        PyMem_Free(query);
+        return PyErr_NoMemory();
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    result = jellyfish_topk_parallel(metric, query, query_len, (const Py_UCS4* const*)strs,
+                                     lens, count, k, matches, threads);
+    Py_END_ALLOW_THREADS
+    free_ucs4_sequence(strs, lens, count);
+    PyMem_Free(query);
+    if (result < 0) {
+        free(matches);
+        return PyErr_NoMemory();
+    }
+
+    ret = PyList_New(result);
+    for (i = 0; ret && i < result; i++) {
+        if (metric == JFISH_TOKEN_LEVENSHTEIN) {
+            item = Py_BuildValue("ii", matches[i].index, (int)matches[i].score);
+        } else {
+            item = Py_BuildValue("id", matches[i].index, matches[i].score);
+        }
+        if (!item) {
+            Py_CLEAR(ret);
+            break;
+        }
+        PyList_SET_ITEM(ret, i, item);
+    }
+    free(matches);
+    return ret;
+}
+
+/* Matches collected by approximate_search() while the GIL is released. */
+struct search_results {
+    size_t count;
+    size_t capacity;
+    size_t *ends;
+    int *distances;
+    int failed;
+};
+
+static int collect_match(void *ctx, size_t end, int distance)
+{
+    struct search_results *results = ctx;
+    size_t capacity;
+    size_t *ends;
+    int *distances;
+
+    if (results->count == results->capacity) {
+        capacity = results->capacity ? 2 * results->capacity : 64;
+        ends = realloc(results->ends, capacity * sizeof(size_t));
+        if (ends) {
+            results->ends = ends;
+        }
+        distances = ends ? realloc(results->distances, capacity * sizeof(int)) : NULL;
+        if (!distances) {
+            results->failed = 1;
+            return 1;
+        }
+        results->distances = distances;
+        results->capacity = capacity;
+    }
+    results->ends[results->count] = end;
+    results->distances[results->count] = distance;
+    results->count++;
+    return 0;
+}
+
+static PyObject* jellyfish_approximate_search(PyObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *upattern, *utext, *ret, *item;
+    Py_UCS4 *pattern, *text;
+    Py_ssize_t pattern_len, text_len;
+    struct search_results results = {0, 0, NULL, NULL, 0};
+    int max_distance, result;
+    size_t i;
+    static char *keywords[] = {"pattern", "text", "max_distance", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "UUi", keywords, &upattern, &utext, &max_distance)) {
+        return NULL;
+    }
+    if (max_distance < 0) {
+        PyErr_SetString(PyExc_ValueError, "max_distance must not be negative");
+        return NULL;
+    }
+    pattern_len = PyUnicode_GET_LENGTH(upattern);
+    text_len = PyUnicode_GET_LENGTH(utext);
+    pattern = PyUnicode_AsUCS4Copy(upattern);
+    if (!pattern) {
+        return NULL;
+    }
+    text = PyUnicode_AsUCS4Copy(utext);
+    if (!text) {
+        PyMem_Free(pattern);
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    result = approximate_search(pattern, pattern_len, text, text_len, max_distance,
+                                collect_match, &results);
+    Py_END_ALLOW_THREADS
+    PyMem_Free(pattern);
+    PyMem_Free(text);
+
+    ret = result < 0 || results.failed ? PyErr_NoMemory() : PyList_New(results.count);
+    for (i = 0; ret && i < results.count; i++) {
+        item = Py_BuildValue("ni", (Py_ssize_t)results.ends[i], results.distances[i]);
+        if (!item) {
+            Py_CLEAR(ret);
+            break;
+        }
+        PyList_SET_ITEM(ret, i, item);
+    }
+    free(results.ends);
+    free(results.distances);
+    return ret;
+}
+
+typedef struct {
+    PyObject_HEAD
+    struct jellyfish_query *query;
+    PyObject *string;
+} QueryObject;
+
+static void Query_dealloc(QueryObject *self)
+{
+    jellyfish_query_free(self->query);
+    Py_XDECREF(self->string);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int Query_init(QueryObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *ustr;
+    Py_UCS4 *str;
+    static char *keywords[] = {"string", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "U", keywords, &ustr)) {
+        return -1;
+    }
+    str = PyUnicode_AsUCS4Copy(ustr);
+    if (str == NULL) {
+        return -1;
+    }
+
+    jellyfish_query_free(self->query);
+    self->query = jellyfish_query_create(str, PyUnicode_GET_LENGTH(ustr));
+    PyMem_Free(str);
+    if (!self->query) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    Py_INCREF(ustr);
+    Py_XSETREF(self->string, ustr);
+    return 0;
+}
+
+/* Parse the candidate string of a Query method into a UCS4 copy. */
+static Py_UCS4* query_candidate(QueryObject *self, PyObject *args, PyObject *kw,
+                                Py_ssize_t *len, int *long_tolerance)
+{
+    PyObject *ustr;
+    Py_UCS4 *str;
+    static char *keywords[] = {"string", NULL};
+    static char *jw_keywords[] = {"string", "long_tolerance", NULL};
+
+    if (long_tolerance) {
+        if (!PyArg_ParseTupleAndKeywords(args, kw, "U|i", jw_keywords, &ustr, long_tolerance)) {
+            return NULL;
+        }
+    } else if (!PyArg_ParseTupleAndKeywords(args, kw, "U", keywords, &ustr)) {
+        return NULL;
+    }
+    if (!self->query) {
+        PyErr_SetString(PyExc_ValueError, "query is not initialized");
+        return NULL;
+    }
+    str = PyUnicode_AsUCS4Copy(ustr);
+    *len = PyUnicode_GET_LENGTH(ustr);
+    return str;
+}
+
+static PyObject* Query_levenshtein_distance(QueryObject *self, PyObject *args, PyObject *kw)
+{
+    Py_UCS4 *str;
+    Py_ssize_t len;
+    int result;
+
+    str = query_candidate(self, args, kw, &len, NULL);
+    if (!str) {
+        return NULL;
+    }
+    result = jellyfish_query_levenshtein(self->query, str, len);
+    PyMem_Free(str);
+    if (result == -1) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    return Py_BuildValue("i", result);
+}
+
+static PyObject* Query_damerau_levenshtein_distance(QueryObject *self, PyObject *args, PyObject *kw)
+{
+    Py_UCS4 *str;
+    Py_ssize_t len;
+    int result;
+
+    str = query_candidate(self, args, kw, &len, NULL);
+    if (!str) {
+        return NULL;
+    }
+    result = jellyfish_query_damerau_levenshtein(self->query, str, len);
+    PyMem_Free(str);
+    if (result == -1) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    return Py_BuildValue("i", result);
+}
+
+static PyObject* Query_hamming_distance(QueryObject *self, PyObject *args, PyObject *kw)
+{
+    Py_UCS4 *str;
+    Py_ssize_t len;
+    unsigned result;
+
+    str = query_candidate(self, args, kw, &len, NULL);
+    if (!str) {
+        return NULL;
+    }
+    result = jellyfish_query_hamming(self->query, str, len);
+    PyMem_Free(str);
+    return Py_BuildValue("I", result);
+}
+
+static PyObject* Query_jaro_similarity(QueryObject *self, PyObject *args, PyObject *kw)
+{
+    Py_UCS4 *str;
+    Py_ssize_t len;
+    double result;
+
+    str = query_candidate(self, args, kw, &len, NULL);
+    if (!str) {
+        return NULL;
+    }
+    result = jellyfish_query_jaro(self->query, str, len);
+    PyMem_Free(str);
+    if (result < -1) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    return Py_BuildValue("d", result);
+}
+
+static PyObject* Query_jaro_winkler_similarity(QueryObject *self, PyObject *args, PyObject *kw)
+{
+    Py_UCS4 *str;
+    Py_ssize_t len;
+    int long_tolerance = 0;
+    double result;
+
+    str = query_candidate(self, args, kw, &len, &long_tolerance);
+    if (!str) {
+        return NULL;
+    }
+    result = jellyfish_query_jaro_winkler(self->query, str, len, long_tolerance);
+    PyMem_Free(str);
+    if (result < -1) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    return Py_BuildValue("d", result);
+}
+
+static PyMethodDef Query_methods[] = {
+    {"levenshtein_distance", (PyCFunction)Query_levenshtein_distance, METH_VARARGS|METH_KEYWORDS,
+     "levenshtein_distance(string)\n\n"
+     "Compute the Levenshtein distance between the query and string."},
+    {"damerau_levenshtein_distance", (PyCFunction)Query_damerau_levenshtein_distance,
+     METH_VARARGS|METH_KEYWORDS,
+     "damerau_levenshtein_distance(string)\n\n"
+     "Compute the Damerau-Levenshtein distance between the query and string."},
+    {"hamming_distance", (PyCFunction)Query_hamming_distance, METH_VARARGS|METH_KEYWORDS,
+     "hamming_distance(string)\n\n"
+     "Compute the Hamming distance between the query and string."},
+    {"jaro_similarity", (PyCFunction)Query_jaro_similarity, METH_VARARGS|METH_KEYWORDS,
+     "jaro_similarity(string)\n\n"
+     "Get a Jaro string distance metric for the query and string."},
+    {"jaro_winkler_similarity", (PyCFunction)Query_jaro_winkler_similarity,
+     METH_VARARGS|METH_KEYWORDS,
+     "jaro_winkler_similarity(string, long_tolerance)\n\n"
+     "Do a Jaro-Winkler string comparison between the query and string."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyObject* Query_get_string(QueryObject *self, void *closure)
+{
+    if (!self->string) {
+        Py_RETURN_NONE;
+    }
+    Py_INCREF(self->string);
+    return self->string;
+}
+
+static PyGetSetDef Query_getset[] = {
+    {"string", (getter)Query_get_string, NULL, "The query string.", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyTypeObject QueryType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "jellyfish.cjellyfish.Query",
+    .tp_basicsize = sizeof(QueryObject),
+    .tp_dealloc = (destructor)Query_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "Query(string)\n\n"
+              "A string preprocessed once for comparison against many\n"
+              "candidates, similar to re.compile.",
+    .tp_methods = Query_methods,
+    .tp_getset = Query_getset,
+    .tp_init = (initproc)Query_init,
+    .tp_new = PyType_GenericNew,
+};
+
+typedef struct {
+    PyObject_HEAD
+    struct qgram_index *index;
+} QGramIndexObject;
+
+static void QGramIndex_dealloc(QGramIndexObject *self)
+{
+    qgram_index_free(self->index);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int QGramIndex_init(QGramIndexObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *strings;
+    Py_UCS4 **strs;
+    int *lens;
+    int q = 2;
+    Py_ssize_t count;
+    static char *keywords[] = {"strings", "q", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|i", keywords, &strings, &q)) {
+        return -1;
+    }
+    if (q < 1) {
+        PyErr_SetString(PyExc_ValueError, "q must be at least 1");
+        return -1;
+    }
+    count = ucs4_sequence(strings, &strs, &lens);
+    if (count < 0) {
+        return -1;
+    }
+
+    qgram_index_free(self->index);
+    self->index = qgram_index_create((const Py_UCS4* const*)strs, lens, count, q);
+    free_ucs4_sequence(strs, lens, count);
+    if (!self->index) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    return 0;
+}
+
+static PyObject* QGramIndex_search(QGramIndexObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *ustr, *ret, *item;
+    Py_UCS4 *str;
+    Py_ssize_t len;
+    int max_distance, found, capacity, i;
+    int *ids, *dists;
+    static char *keywords[] = {"string", "max_distance", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "Ui", keywords, &ustr, &max_distance)) {
+        return NULL;
+    }
+    if (!self->index) {
+        PyErr_SetString(PyExc_ValueError, "index is not initialized");
+        return NULL;
+    }
+    len = PyUnicode_GET_LENGTH(ustr);
+    str = PyUnicode_AsUCS4Copy(ustr);
+    if (str == NULL) {
+        return NULL;
+    }
+
+    /* most searches return a handful of matches; only rerun the search
+     * when they do not fit the initial buffers */
+    capacity = 64;
+    for (;;) {
+        ids = PyMem_Malloc(capacity * sizeof(int));
+        dists = PyMem_Malloc(capacity * sizeof(int));
+        found = -1;
+        if (ids && dists) {
+            found = qgram_index_search(self->index, str, len, max_distance,
+                                       ids, dists, capacity);
+        }
+        if (found < 0) {
+            PyMem_Free(str);
+            PyMem_Free(ids);
+            PyMem_Free(dists);
+            return PyErr_NoMemory();
+        }
+        if (found <= capacity) {
+            break;
+        }
+        PyMem_Free(ids);
+        PyMem_Free(dists);
+        capacity = found;
+    }
+    PyMem_Free(str);
+
+    ret = PyList_New(found);
+    for (i = 0; ret && i < found; i++) {
+        item = Py_BuildValue("(ii)", ids[i], dists[i]);
+        if (!item) {
+            Py_CLEAR(ret);
+            break;
+        }
+        PyList_SET_ITEM(ret, i, item);
+    }
+    PyMem_Free(ids);
+    PyMem_Free(dists);
+    return ret;
+}
+
+static Py_ssize_t QGramIndex_len(QGramIndexObject *self)
+{
+    return self->index ? qgram_index_size(self->index) : 0;
+}
+
+static PyMethodDef QGramIndex_methods[] = {
+    {"search", (PyCFunction)QGramIndex_search, METH_VARARGS|METH_KEYWORDS,
+     "search(string, max_distance)\n\n"
+     "Return (position, distance) pairs for every indexed string within\n"
+     "max_distance Levenshtein edits of string, closest first."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PySequenceMethods QGramIndex_as_sequence = {
+    (lenfunc)QGramIndex_len,
+};
+
+static PyTypeObject QGramIndexType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "jellyfish.cjellyfish.QGramIndex",
+    .tp_basicsize = sizeof(QGramIndexObject),
+    .tp_dealloc = (destructor)QGramIndex_dealloc,
+    .tp_as_sequence = &QGramIndex_as_sequence,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "QGramIndex(strings, q=2)\n\n"
+              "q-gram inverted index over a sequence of strings for\n"
+              "approximate Levenshtein search with count filtering.",
+    .tp_methods = QGramIndex_methods,
+    .tp_init = (initproc)QGramIndex_init,
+    .tp_new = PyType_GenericNew,
+};
+
+typedef struct {
+    PyObject_HEAD
+    struct symspell_index *index;
+} SymSpellIndexObject;
+
+static void SymSpellIndex_dealloc(SymSpellIndexObject *self)
+{
+    symspell_index_free(self->index);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int SymSpellIndex_init(SymSpellIndexObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *strings;
+    Py_UCS4 **strs;
+    int *lens;
+    int max_distance = 2;
+    Py_ssize_t count;
+    static char *keywords[] = {"strings", "max_distance", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|i", keywords, &strings, &max_distance)) {
+        return -1;
+    }
+    if (max_distance < 0) {
+        PyErr_SetString(PyExc_ValueError, "max_distance must not be negative");
+        return -1;
+    }
+    count = ucs4_sequence(strings, &strs, &lens);
+    if (count < 0) {
+        return -1;
+    }
+
+    symspell_index_free(self->index);
+    self->index = symspell_index_create((const Py_UCS4* const*)strs, lens, count, max_distance);
+    free_ucs4_sequence(strs, lens, count);
+    if (!self->index) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    return 0;
+}
+
+static PyObject* SymSpellIndex_search(SymSpellIndexObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *ustr, *ret, *item;
+    Py_UCS4 *str;
+    Py_ssize_t len;
+    int max_distance = -1, found, capacity, i;
+    int *ids, *dists;
+    static char *keywords[] = {"string", "max_distance", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "U|i", keywords, &ustr, &max_distance)) {
+        return NULL;
+    }
+    if (!self->index) {
+        PyErr_SetString(PyExc_ValueError, "index is not initialized");
+        return NULL;
+    }
+    if (max_distance < 0) {
+        max_distance = symspell_index_max_distance(self->index);
+    } else if (max_distance > symspell_index_max_distance(self->index)) {
+        PyErr_SetString(PyExc_ValueError, "max_distance exceeds the index's max_distance");
+        return NULL;
+    }
+    len = PyUnicode_GET_LENGTH(ustr);
+    str = PyUnicode_AsUCS4Copy(ustr);
+    if (str == NULL) {
+        return NULL;
+    }
+
+    /* as in QGramIndex.search: rerun only when the matches overflow */
+    capacity = 64;
+    for (;;) {
+        ids = PyMem_Malloc(capacity * sizeof(int));
+        dists = PyMem_Malloc(capacity * sizeof(int));
+        found = -1;
+        if (ids && dists) {
+            found = symspell_index_search(self->index, str, len, max_distance,
+                                          ids, dists, capacity);
+        }
+        if (found < 0) {
+            PyMem_Free(str);
+            PyMem_Free(ids);
+            PyMem_Free(dists);
+            return PyErr_NoMemory();
+        }
+        if (found <= capacity) {
+            break;
+        }
+        PyMem_Free(ids);
+        PyMem_Free(dists);
+        capacity = found;
+    }
+    PyMem_Free(str);
+
+    ret = PyList_New(found);
+    for (i = 0; ret && i < found; i++) {
+        item = Py_BuildValue("(ii)", ids[i], dists[i]);
+        if (!item) {
+            Py_CLEAR(ret);
+            break;
+        }
+        PyList_SET_ITEM(ret, i, item);
+    }
+    PyMem_Free(ids);
+    PyMem_Free(dists);
+    return ret;
+}
+
+static Py_ssize_t SymSpellIndex_len(SymSpellIndexObject *self)
+{
+    return self->index ? symspell_index_size(self->index) : 0;
+}
+
+static PyMethodDef SymSpellIndex_methods[] = {
+    {"search", (PyCFunction)SymSpellIndex_search, METH_VARARGS|METH_KEYWORDS,
+     "search(string, max_distance=None)\n\n"
+     "Return (position, distance) pairs for every indexed string within\n"
+     "max_distance Damerau-Levenshtein edits of string, closest first.\n"
+     "max_distance defaults to, and may not exceed, the index's."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PySequenceMethods SymSpellIndex_as_sequence = {
+    (lenfunc)SymSpellIndex_len,
+};
+
+static PyTypeObject SymSpellIndexType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "jellyfish.cjellyfish.SymSpellIndex",
+    .tp_basicsize = sizeof(SymSpellIndexObject),
+    .tp_dealloc = (destructor)SymSpellIndex_dealloc,
+    .tp_as_sequence = &SymSpellIndex_as_sequence,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "SymSpellIndex(strings, max_distance=2)\n\n"
+              "Symmetric delete index over a sequence of strings for\n"
+              "Damerau-Levenshtein lookups within max_distance edits.",
+    .tp_methods = SymSpellIndex_methods,
+    .tp_init = (initproc)SymSpellIndex_init,
+    .tp_new = PyType_GenericNew,
+};
+
+typedef struct {
+    PyObject_HEAD
+    struct jellyfish_incremental *inc;
+} IncrementalQueryObject;
+
+static void IncrementalQuery_dealloc(IncrementalQueryObject *self)
+{
+    jellyfish_incremental_free(self->inc);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int IncrementalQuery_init(IncrementalQueryObject *self, PyObject *args, PyObject *kw)
+{
+    PyObject *candidates;
+    Py_UCS4 **strs;
+    int *lens;
+    Py_ssize_t count;
+    static char *keywords[] = {"candidates", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O", keywords, &candidates)) {
+        return -1;
+    }
+    count = ucs4_sequence(candidates, &strs, &lens);
+    if (count < 0) {
+        return -1;
+    }
+
+    jellyfish_incremental_free(self->inc);
+    self->inc = jellyfish_incremental_create((const Py_UCS4* const*)strs, lens, count);
+    free_ucs4_sequence(strs, lens, count);
+    if (!self->inc) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    return 0;
+}
+
+static PyObject* IncrementalQuery_push(IncrementalQueryObject *self, PyObject *args)
+{
+    PyObject *ustr;
+    Py_UCS4 *str;
+    Py_ssize_t len, i;
+    int result = 0;
+
+    if (!PyArg_ParseTuple(args, "U", &ustr)) {
+        PyErr_SetString(PyExc_TypeError, NO_BYTES_ERR_STR);
+        return NULL;
+    }
+    if (!self->inc) {
+        PyErr_SetString(PyExc_ValueError, "query is not initialized");
+        return NULL;
+    }
+    len = PyUnicode_GET_LENGTH(ustr);
+    str = PyUnicode_AsUCS4Copy(ustr);
+    if (str == NULL) {
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 0; i < len && !result; i++) {
+        result = jellyfish_incremental_push(self->inc, str[i]);
+    }
+    Py_END_ALLOW_THREADS
+    PyMem_Free(str);
+    if (result < 0) {
+        return PyErr_NoMemory();
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* IncrementalQuery_pop(IncrementalQueryObject *self, PyObject *args)
+{
+    int n = 1;
+
+    if (!PyArg_ParseTuple(args, "|i", &n)) {
+        return NULL;
+    }
+    if (!self->inc) {
+        PyErr_SetString(PyExc_ValueError, "query is not initialized");
+        return NULL;
+    }
+    jellyfish_incremental_pop(self->inc, n);
+    Py_RETURN_NONE;
+}
+
+static PyObject* IncrementalQuery_distances(IncrementalQueryObject *self, PyObject *unused)
+{
+    PyObject *ret, *item;
+    const int *distances;
+    Py_ssize_t i, count;
+
+    if (!self->inc) {
+        PyErr_SetString(PyExc_ValueError, "query is not initialized");
+        return NULL;
+    }
+    distances = jellyfish_incremental_distances(self->inc);
+    count = jellyfish_incremental_size(self->inc);
+
+    ret = PyList_New(count);
+    for (i = 0; ret && i < count; i++) {
+        item = PyLong_FromLong(distances[i]);
+        if (!item) {
+            Py_CLEAR(ret);
+            break;
+        }
+        PyList_SET_ITEM(ret, i, item);
+    }
+    return ret;
+}
+
+static PyObject* IncrementalQuery_get_query(IncrementalQueryObject *self, void *closure)
+{
+    if (!self->inc) {
+        return PyUnicode_FromString("");
+    }
+    return PyUnicode_FromKindAndData(PyUnicode_4BYTE_KIND,
+                                     jellyfish_incremental_query(self->inc),
+                                     jellyfish_incremental_length(self->inc));
+}
+
+static Py_ssize_t IncrementalQuery_len(IncrementalQueryObject *self)
+{
+    return self->inc ? jellyfish_incremental_size(self->inc) : 0;
+}
+
+static PyMethodDef IncrementalQuery_methods[] = {
+    {"push", (PyCFunction)IncrementalQuery_push, METH_VARARGS,
+     "push(string)\n\n"
+     "Append the characters of string to the query."},
+    {"pop", (PyCFunction)IncrementalQuery_pop, METH_VARARGS,
+     "pop(n=1)\n\n"
+     "Remove the last n characters of the query."},
+    {"distances", (PyCFunction)IncrementalQuery_distances, METH_NOARGS,
+     "distances()\n\n"
+     "Levenshtein distance from the current query to each candidate."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef IncrementalQuery_getset[] = {
+    {"query", (getter)IncrementalQuery_get_query, NULL, "The current query.", NULL},
+    {NULL}
+};
+
+static PySequenceMethods IncrementalQuery_as_sequence = {
+    (lenfunc)IncrementalQuery_len,
+};
+
+static PyTypeObject IncrementalQueryType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "jellyfish.cjellyfish.IncrementalQuery",
+    .tp_basicsize = sizeof(IncrementalQueryObject),
+    .tp_dealloc = (destructor)IncrementalQuery_dealloc,
+    .tp_as_sequence = &IncrementalQuery_as_sequence,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "IncrementalQuery(candidates)\n\n"
+              "Levenshtein distances to a fixed sequence of candidates for a\n"
+              "query edited at the end, one push() or pop() at a time.",
+    .tp_methods = IncrementalQuery_methods,
+    .tp_getset = IncrementalQuery_getset,
+    .tp_init = (initproc)IncrementalQuery_init,
+    .tp_new = PyType_GenericNew,
+};
+
 
 static PyMethodDef jellyfish_methods[] = {
     {"jaro_winkler_similarity", (PyCFunction)jellyfish_jaro_winkler_similarity, METH_VARARGS|METH_KEYWORDS,
      "jaro_winkler_similarity(string1, string2, long_tolerance)\n\n"
      "Do a Jaro-Winkler string comparison between string1 and string2."},
 
+    {"jaro_winkler_similarity_threshold",
+     (PyCFunction)jellyfish_jaro_winkler_similarity_threshold, METH_VARARGS|METH_KEYWORDS,
+     "jaro_winkler_similarity_threshold(string1, string2, min_score, long_tolerance)\n\n"
+     "Jaro-Winkler similarity of string1 and string2, or 0.0 if it is\n"
+     "below min_score.  Pairs that cannot reach min_score are rejected\n"
+     "from length and character counts alone."},
+
     {"jaro_similarity", jellyfish_jaro_similarity, METH_VARARGS,
      "jaro_similarity(string1, string2)\n\n"
      "Get a Jaro string distance metric for string1 and string2."},
@@ -423,6 +2722,161 @@ static PyMethodDef jellyfish_methods[] = {
      "damerau_levenshtein_distance(string1, string2)\n\n"
      "Compute the Damerau-Levenshtein distance between string1 and string2."},
 
+    {"levenshtein_distance_parallel", (PyCFunction)jellyfish_levenshtein_parallel,
+     METH_VARARGS|METH_KEYWORDS,
+     "levenshtein_distance_parallel(s1, s2, threads=1)\n\n"
+     "Levenshtein distance of one long pair, computed in tiles over threads\n"
+     "with memory linear in the string lengths."},
+
+    {"levenshtein_distance_budget", (PyCFunction)jellyfish_levenshtein_budget,
+     METH_VARARGS|METH_KEYWORDS,
+     "levenshtein_distance_budget(s1, s2, max_cells=0, timeout=0.0)\n\n"
+     "Levenshtein distance that gives up after max_cells matrix cells or\n"
+     "timeout seconds (0 for no limit).  Returns (distance, False), or\n"
+     "(lower bound, True) if the budget ran out."},
+
+    {"damerau_levenshtein_distance_budget", (PyCFunction)jellyfish_damerau_levenshtein_budget,
+     METH_VARARGS|METH_KEYWORDS,
+     "damerau_levenshtein_distance_budget(s1, s2, max_cells=0, timeout=0.0)\n\n"
+     "Damerau-Levenshtein distance with the limits of\n"
+     "levenshtein_distance_budget()."},
+
+    {"osa_distance", jellyfish_osa_distance, METH_VARARGS,
+     "osa_distance(string1, string2)\n\n"
+     "Compute the optimal string alignment (restricted Damerau-Levenshtein)\n"
+     "distance between string1 and string2."},
+
+    {"levenshtein_distance_batch", (PyCFunction)jellyfish_levenshtein_distance_batch,
+     METH_VARARGS|METH_KEYWORDS,
+     "levenshtein_distance_batch(s1, s2, threads=1)\n\n"
+     "Levenshtein distances for two equal length sequences of strings, or\n"
+     "one string against a sequence, as an int32 memoryview."},
+
+    {"damerau_levenshtein_distance_batch",
+     (PyCFunction)jellyfish_damerau_levenshtein_distance_batch, METH_VARARGS|METH_KEYWORDS,
+     "damerau_levenshtein_distance_batch(s1, s2, threads=1)\n\n"
+     "Damerau-Levenshtein distances for two equal length sequences of\n"
+     "strings, or one string against a sequence, as an int32 memoryview."},
+
+    {"hamming_distance_batch", (PyCFunction)jellyfish_hamming_distance_batch,
+     METH_VARARGS|METH_KEYWORDS,
+     "hamming_distance_batch(s1, s2, threads=1)\n\n"
+     "Hamming distances for two equal length sequences of strings, or one\n"
+     "string against a sequence, as an int32 memoryview."},
+
+    {"jaro_similarity_batch", (PyCFunction)jellyfish_jaro_similarity_batch,
+     METH_VARARGS|METH_KEYWORDS,
+     "jaro_similarity_batch(s1, s2, threads=1)\n\n"
+     "Jaro similarities for two equal length sequences of strings, or one\n"
+     "string against a sequence, as a float64 memoryview."},
+
+    {"jaro_winkler_similarity_batch", (PyCFunction)jellyfish_jaro_winkler_similarity_batch,
+     METH_VARARGS|METH_KEYWORDS,
+     "jaro_winkler_similarity_batch(s1, s2, threads=1)\n\n"
+     "Jaro-Winkler similarities for two equal length sequences of strings,\n"
+     "or one string against a sequence, as a float64 memoryview."},
+
+    {"lcs_length", jellyfish_lcs_length, METH_VARARGS,
+     "lcs_length(string1, string2)\n\n"
+     "Compute the length of the longest common subsequence of string1 and\n"
+     "string2."},
+
+    {"lcs_similarity", jellyfish_lcs_similarity, METH_VARARGS,
+     "lcs_similarity(string1, string2)\n\n"
+     "Longest common subsequence length normalized to [0, 1] as\n"
+     "2 * lcs / (len(string1) + len(string2))."},
+
+    {"longest_common_substring", jellyfish_longest_common_substring,
+     METH_VARARGS,
+     "longest_common_substring(string1, string2)\n\n"
+     "Find the longest common substring of string1 and string2, returned\n"
+     "as a (length, start1, start2) tuple."},
+
+    {"longest_common_substring_similarity",
+     jellyfish_longest_common_substring_similarity, METH_VARARGS,
+     "longest_common_substring_similarity(string1, string2)\n\n"
+     "Longest common substring length normalized to [0, 1] as\n"
+     "2 * length / (len(string1) + len(string2))."},
+
+    {"token_sort_similarity", (PyCFunction)jellyfish_token_sort_similarity,
+     METH_VARARGS|METH_KEYWORDS,
+     "token_sort_similarity(string1, string2, metric='levenshtein')\n\n"
+     "Compare string1 and string2 after sorting their words, using\n"
+     "normalized 'levenshtein' or 'jaro_winkler' similarity."},
+
+    {"token_set_similarity", (PyCFunction)jellyfish_token_set_similarity,
+     METH_VARARGS|METH_KEYWORDS,
+     "token_set_similarity(string1, string2, metric='levenshtein')\n\n"
+     "Compare the common and differing word sets of string1 and string2,\n"
+     "returning the best of the three pairwise similarities."},
+
+    {"token_alignment_similarity",
+     (PyCFunction)jellyfish_token_alignment_similarity,
+     METH_VARARGS|METH_KEYWORDS,
+     "token_alignment_similarity(string1, string2, metric='levenshtein')\n\n"
+     "Average the best per-word similarity of the string with fewer words\n"
+     "against the words of the other (Monge-Elkan)."},
+
+    {"pair_features", (PyCFunction)jellyfish_features, METH_VARARGS|METH_KEYWORDS,
+     "pair_features(s1, s2, features=None)\n\n"
+     "Return a tuple of floats with the selected features of the pair, in the\n"
+     "order levenshtein, damerau_levenshtein, jaro, jaro_winkler, hamming,\n"
+     "match_rating, soundex, metaphone, nysiis (all of them if features is\n"
+     "None).  match_rating is 1, 0 or -1 when the codices cannot be compared;\n"
+     "the phonetic features are 1 when both strings have the same key."},
+
+    {"pair_features_batch", (PyCFunction)jellyfish_features_batch,
+     METH_VARARGS|METH_KEYWORDS,
+     "pair_features_batch(s1, s2, features=None, threads=1)\n\n"
+     "pair_features() for each pair of two equal length sequences, as a\n"
+     "(len(s1), number of features) float64 memoryview (flat if either is 0)."},
+
+    {"minhash_signatures", (PyCFunction)jellyfish_minhash_signatures,
+     METH_VARARGS|METH_KEYWORDS,
+     "minhash_signatures(strings, num_perm=128, shingle=3, seed=1)\n\n"
+     "Compute MinHash signatures of character shingles for each string,\n"
+     "returned as bytes holding a row-major array of uint32."},
+
+    {"lsh_candidate_pairs", (PyCFunction)jellyfish_lsh_candidate_pairs,
+     METH_VARARGS|METH_KEYWORDS,
+     "lsh_candidate_pairs(signatures, num_perm, bands)\n\n"
+     "Return the (i, j) pairs whose MinHash signatures agree in at least\n"
+     "one LSH band."},
+
+    {"sorted_neighborhood_pairs", (PyCFunction)jellyfish_sorted_neighborhood_pairs,
+     METH_VARARGS|METH_KEYWORDS,
+     "sorted_neighborhood_pairs(strings, key='soundex', window=10, min_score=0.9,\n"
+     "                          threads=1)\n\n"
+     "Sort strings by their 'soundex' or 'nysiis' key and return the (i, j)\n"
+     "pairs within window positions of each other whose Jaro-Winkler\n"
+     "similarity is at least min_score."},
+
+    {"topk", (PyCFunction)jellyfish_topk_matches, METH_VARARGS|METH_KEYWORDS,
+     "topk(query, candidates, k, metric='levenshtein', threads=1)\n\n"
+     "Return the k candidates closest to query as (index, score) pairs, best\n"
+     "first.  metric is 'levenshtein' (score is the distance) or\n"
+     "'jaro_winkler' (score is the similarity); ties go to the lower index."},
+
+    {"approximate_search", (PyCFunction)jellyfish_approximate_search,
+     METH_VARARGS|METH_KEYWORDS,
+     "approximate_search(pattern, text, max_distance)\n\n"
+     "Find pattern in text allowing up to max_distance edits.  Returns an\n"
+     "(end, distance) pair for every position where a substring of text\n"
+     "ending there (text[start:end] for some start) is within max_distance\n"
+     "of pattern, with the smallest such distance, counting end 0 (the\n"
+     "empty substring) when len(pattern) <= max_distance."},
+
+    {"phonetic_keys", (PyCFunction)jellyfish_phonetic_keys, METH_VARARGS|METH_KEYWORDS,
+     "phonetic_keys(string, keys=None)\n\n"
+     "Return (soundex, metaphone, nysiis, match_rating_codex) for string,\n"
+     "normalizing and upper casing it once.  keys selects which of them to\n"
+     "compute by name; the others are None."},
+
+    {"phonetic_keys_batch", (PyCFunction)jellyfish_phonetic_keys_batch,
+     METH_VARARGS|METH_KEYWORDS,
+     "phonetic_keys_batch(strings, keys=None)\n\n"
+     "phonetic_keys() for each string in a sequence, as a list of tuples."},
+
     {"soundex", jellyfish_soundex, METH_VARARGS,
      "soundex(string)\n\n"
      "Calculate the soundex code for a given name."},
@@ -431,6 +2885,14 @@ static PyMethodDef jellyfish_methods[] = {
      "metaphone(string)\n\n"
      "Calculate the metaphone representation of a given string."},
 
+    {"soundex_batch", jellyfish_soundex_batch, METH_O,
+     "soundex_batch(strings)\n\n"
+     "Calculate the soundex code for every string in a sequence."},
+
+    {"metaphone_batch", jellyfish_metaphone_batch, METH_O,
+     "metaphone_batch(strings)\n\n"
+     "Calculate the metaphone representation of every string in a sequence."},
+
     {"match_rating_codex", jellyfish_match_rating_codex, METH_VARARGS,
      "match_rating_codex(string)\n\n"
      "Calculate the Match Rating Approach representation of a given string."},
@@ -440,11 +2902,25 @@ static PyMethodDef jellyfish_methods[] = {
      "Compute the Match Rating Approach similarity between string1 and"
      "string2."},
 
+    {"match_rating_codex_batch", jellyfish_match_rating_codex_batch, METH_O,
+     "match_rating_codex_batch(strings)\n\n"
+     "Calculate the Match Rating Approach codex of every string in a\n"
+     "sequence."},
+
     {"nysiis", jellyfish_nysiis, METH_VARARGS,
      "nysiis(string)\n\n"
      "Compute the NYSIIS (New York State Identification and Intelligence\n"
      "System) code for a string."},
 
+    {"nysiis_batch", jellyfish_nysiis_batch, METH_O,
+     "nysiis_batch(strings)\n\n"
+     "Compute the NYSIIS code of every string in a sequence."},
+
+    {"porter_stem", jellyfish_porter_stem, METH_VARARGS,
+     "porter_stem(string)\n\n"
+     "Return the result of running the Porter stemming algorithm on\n"
+     "a single string."},
+
     {NULL, NULL, 0, NULL}
 };
 
@@ -480,5 +2956,29 @@ PyObject* PyInit_cjellyfish(void)
         PyObject_GetAttrString(unicodedata, "normalize");
     Py_DECREF(unicodedata);
 
+    if (PyType_Ready(&QueryType) < 0) {
+        INITERROR;
+    }
+    Py_INCREF(&QueryType);
+    PyModule_AddObject(module, "Query", (PyObject*)&QueryType);
+
+    if (PyType_Ready(&QGramIndexType) < 0) {
+        INITERROR;
+    }
+    Py_INCREF(&QGramIndexType);
+    PyModule_AddObject(module, "QGramIndex", (PyObject*)&QGramIndexType);
+
+    if (PyType_Ready(&SymSpellIndexType) < 0) {
+        INITERROR;
+    }
+    Py_INCREF(&SymSpellIndexType);
+    PyModule_AddObject(module, "SymSpellIndex", (PyObject*)&SymSpellIndexType);
+
+    if (PyType_Ready(&IncrementalQueryType) < 0) {
+        INITERROR;
+    }
+    Py_INCREF(&IncrementalQueryType);
+    PyModule_AddObject(module, "IncrementalQuery", (PyObject*)&IncrementalQueryType);
+
     return module;
 }
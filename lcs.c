@@ -0,0 +1,310 @@
+#include "jellyfish.h"
+#include <string.h>
+#include <stdlib.h>
+
+/*
+  Longest common subsequence length, bit-parallel.
+
+  This is the Allison-Dix recurrence in the form given by Hyyro ("Bit-parallel
+  LCS-length computation revisited", 2004): V starts as all ones over the
+  pattern and every text character c updates it as
+
+      U = V & peq[c]
+      V = (V + U) | (V - U)
+
+  The LCS length is the number of zero bits left in V.  Patterns longer than
+  64 characters are split into blocks and the addition carries across them.
+*/
+int lcs_length(const JFISH_UNICODE *s1, int len1, const JFISH_UNICODE *s2, int len2)
+{
+    struct jfish_peq peq;
+    const JFISH_UNICODE *tmp_s;
+    const uint64_t *match;
+    uint64_t *v;
+    uint64_t u, sum, carry, last_mask;
+    int tmp_len, i, result;
+    size_t w;
+
+    /* use the shorter string as the pattern so there are fewer blocks */
+    if (len1 > len2) {
+        tmp_s = s1; s1 = s2; s2 = tmp_s;
+        tmp_len = len1; len1 = len2; len2 = tmp_len;
+    }
+    if (!len1) {
+        return 0;
+    }
+
+    if (!jfish_peq_init(&peq, s1, len1)) {
+        return -1;
+    }
+    v = safe_malloc(peq.words, sizeof(uint64_t));
+    if (!v) {
+        jfish_peq_free(&peq);
+        return -1;
+    }
+    memset(v, 0xff, peq.words * sizeof(uint64_t));
+
+    for (i = 0; i < len2; i++) {
+        match = jfish_peq_get(&peq, s2[i]);
+        carry = 0;
+        for (w = 0; w < peq.words; w++) {
+            u = v[w] & match[w];
+            sum = v[w] + u;
+            sum += carry;
+            carry = (sum < u) || (carry && sum == u);
+            v[w] = sum | (v[w] - u);
+        }
+    }
+
+    result = 0;
+    last_mask = (len1 % 64) ? ((uint64_t)1 << (len1 % 64)) - 1 : ~(uint64_t)0;
+    for (w = 0; w < peq.words; w++) {
+        u = ~v[w];
+        if (w == peq.words - 1) {
+            u &= last_mask;
+        }
+        result += jfish_popcount64(u);
+    }
+
+    free(v);
+    jfish_peq_free(&peq);
+    return result;
+}
+
+
+double lcs_similarity(const JFISH_UNICODE *s1, int len1, const JFISH_UNICODE *s2, int len2)
+{
+    int lcs;
+
+    // same convention as jaro: blank strings are not similar to anything
+    if (!len1 || !len2) return 0;
+
+    lcs = lcs_length(s1, len1, s2, len2);
+    if (lcs < 0) {
+        return -100;
+    }
+    return 2.0 * lcs / ((double) len1 + len2);
+}
+
+
+/*
+  Longest common substring via a suffix automaton over str1.
+
+  The automaton has at most 2n states and 3n transitions.  Transitions are
+  kept in per-state linked lists (needed when cloning a state) and indexed by
+  an open-addressing table on (state, character) so lookups stay O(1) for
+  arbitrary code points.  str2 is then streamed through the automaton,
+  tracking the longest match ending at each position.
+*/
+
+struct sam_edge {
+    int from;
+    int to;
+    int next;
+    JFISH_UNICODE c;
+};
+
+struct suffix_automaton {
+    int *length;
+    int *link;
+    int *first_end;
+    int *head;
+    struct sam_edge *edges;
+    int *table;
+    size_t table_mask;
+    int states;
+    int nedges;
+};
+
+
+static size_t sam_hash(const struct suffix_automaton *sam, int state, JFISH_UNICODE c)
+{
+    uint64_t key = ((uint64_t)state << 32) ^ (uint64_t)c;
+    key *= 0x9E3779B97F4A7C15ull;
+    return (size_t)(key >> 17) & sam->table_mask;
+}
+
+
+static int sam_find(const struct suffix_automaton *sam, int state, JFISH_UNICODE c)
+{
+    size_t i = sam_hash(sam, state, c);
+    int e;
+
+    while ((e = sam->table[i]) >= 0) {
+        if (sam->edges[e].from == state && sam->edges[e].c == c) {
+            return e;
+        }
+        i = (i + 1) & sam->table_mask;
+    }
+    return -1;
+}
+
+
+static void sam_add_edge(struct suffix_automaton *sam, int from, JFISH_UNICODE c, int to)
+{
+    size_t i = sam_hash(sam, from, c);
+    int e = sam->nedges++;
+
+    sam->edges[e].from = from;
+    sam->edges[e].to = to;
+    sam->edges[e].c = c;
+    sam->edges[e].next = sam->head[from];
+    sam->head[from] = e;
+
+    while (sam->table[i] >= 0) {
+        i = (i + 1) & sam->table_mask;
+    }
+    sam->table[i] = e;
+}
+
+
+static void sam_free(struct suffix_automaton *sam)
+{
+    free(sam->length);
+    free(sam->link);
+    free(sam->first_end);
+    free(sam->head);
+    free(sam->edges);
+    free(sam->table);
+}
+
+
+static int sam_build(struct suffix_automaton *sam, const JFISH_UNICODE *str, int len)
+{
+    size_t max_states = 2 * (size_t)len + 1;
+    size_t max_edges = 3 * (size_t)len + 1;
+    size_t table_size = 8;
+    int i, cur, p, q, clone, last, e;
+
+    while (table_size < max_edges * 2) {
+        table_size *= 2;
+    }
+
+    memset(sam, 0, sizeof(*sam));
+    sam->length = safe_malloc(max_states, sizeof(int));
+    sam->link = safe_malloc(max_states, sizeof(int));
+    sam->first_end = safe_malloc(max_states, sizeof(int));
+    sam->head = safe_malloc(max_states, sizeof(int));
+    sam->edges = safe_malloc(max_edges, sizeof(struct sam_edge));
+    sam->table = safe_malloc(table_size, sizeof(int));
+    if (!sam->length || !sam->link || !sam->first_end || !sam->head ||
+        !sam->edges || !sam->table) {
+        sam_free(sam);
+        return 0;
+    }
+    memset(sam->table, 0xff, table_size * sizeof(int));
+    sam->table_mask = table_size - 1;
+
+    sam->length[0] = 0;
+    sam->link[0] = -1;
+    sam->first_end[0] = -1;
+    sam->head[0] = -1;
+    sam->states = 1;
+    last = 0;
+
+    for (i = 0; i < len; i++) {
+        cur = sam->states++;
+        sam->length[cur] = sam->length[last] + 1;
+        sam->first_end[cur] = i;
+        sam->head[cur] = -1;
+
+        for (p = last; p != -1 && sam_find(sam, p, str[i]) < 0; p = sam->link[p]) {
+            sam_add_edge(sam, p, str[i], cur);
+        }
+
+        if (p == -1) {
+            sam->link[cur] = 0;
+        } else {
+            q = sam->edges[sam_find(sam, p, str[i])].to;
+            if (sam->length[p] + 1 == sam->length[q]) {
+                sam->link[cur] = q;
+            } else {
+                clone = sam->states++;
+                sam->length[clone] = sam->length[p] + 1;
+                sam->link[clone] = sam->link[q];
+                sam->first_end[clone] = sam->first_end[q];
+                sam->head[clone] = -1;
+                for (e = sam->head[q]; e >= 0; e = sam->edges[e].next) {
+                    sam_add_edge(sam, clone, sam->edges[e].c, sam->edges[e].to);
+                }
+
+                for (; p != -1; p = sam->link[p]) {
+                    e = sam_find(sam, p, str[i]);
+                    if (e < 0 || sam->edges[e].to != q) {
+                        break;
+                    }
+                    sam->edges[e].to = clone;
+                }
+                sam->link[q] = clone;
+                sam->link[cur] = clone;
+            }
+        }
+        last = cur;
+    }
+
+    return 1;
+}
+
+
+int longest_common_substring(const JFISH_UNICODE *s1, int len1, const JFISH_UNICODE *s2, int len2,
+                             int *start1, int *start2)
+{
+    struct suffix_automaton sam;
+    int i, e, state, length;
+    int best = 0, best_end1 = -1, best_end2 = -1;
+
+    if (start1) *start1 = 0;
+    if (start2) *start2 = 0;
+    if (!len1 || !len2) {
+        return 0;
+    }
+
+    if (!sam_build(&sam, s1, len1)) {
+        return -1;
+    }
+
+    state = 0;
+    length = 0;
+    for (i = 0; i < len2; i++) {
+        while (state && (e = sam_find(&sam, state, s2[i])) < 0) {
+            state = sam.link[state];
+            length = sam.length[state];
+        }
+        e = sam_find(&sam, state, s2[i]);
+        if (e >= 0) {
+            state = sam.edges[e].to;
+            length++;
+        } else {
+            length = 0;
+        }
+
+        if (length > best) {
+            best = length;
+            best_end1 = sam.first_end[state];
+            best_end2 = i;
+        }
+    }
+
+    if (best) {
+        if (start1) *start1 = best_end1 - best + 1;
+        if (start2) *start2 = best_end2 - best + 1;
+    }
+
+    sam_free(&sam);
+    return best;
+}
+
+
+double longest_common_substring_similarity(const JFISH_UNICODE *s1, int len1,
+                                           const JFISH_UNICODE *s2, int len2)
+{
+    int lcs;
+
+    if (!len1 || !len2) return 0;
+
+    lcs = longest_common_substring(s1, len1, s2, len2, NULL, NULL);
+    if (lcs < 0) {
+        return -100;
+    }
+    return 2.0 * lcs / ((double) len1 + len2);
+}
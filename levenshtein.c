@@ -3,45 +3,331 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+/*
+  Stack-only kernels for short strings, one per size class N (8, 16, 32).
+
+  s2 is copied into a zero-padded buffer of exactly N characters and every
+  row is computed across all N columns: a cell only depends on the cells to
+  its left and above, so the padding columns never affect column s2_len,
+  and the constant trip count lets the compiler fully unroll the inner loop
+  into branchless code.  Only a single rolling row is kept.
+
+  Building with JFISH_NO_SMALL_KERNELS leaves out these kernels and the
+  ones in jaro.c and damerau_levenshtein.c, so benchmarks/small_kernels.py
+  can time them against the generic path at the same lengths.
+*/
+#define LEVENSHTEIN_SMALL(N)                                                    \
+static int levenshtein_distance_##N(const JFISH_UNICODE *s1, int s1_len,        \
+                                    const JFISH_UNICODE *s2, int s2_len)        \
+{                                                                               \
+    JFISH_UNICODE padded[N];                                                    \
+    unsigned row[N + 1];                                                        \
+    unsigned diag, up, cur;                                                     \
+    int i, j;                                                                   \
+                                                                                \
+    memset(padded, 0, sizeof(padded));                                          \
+    memcpy(padded, s2, s2_len * sizeof(JFISH_UNICODE));                         \
+    for (j = 0; j <= N; j++) {                                                  \
+        row[j] = j;                                                             \
+    }                                                                           \
+                                                                                \
+    for (i = 1; i <= s1_len; i++) {                                             \
+        diag = row[0];                                                          \
+        row[0] = i;                                                             \
+        for (j = 1; j <= N; j++) {                                              \
+            up = row[j];                                                        \
+            cur = diag + (s1[i - 1] != padded[j - 1]);                          \
+            cur = MIN(cur, up + 1);                                             \
+            cur = MIN(cur, row[j - 1] + 1);                                     \
+            diag = up;                                                          \
+            row[j] = cur;                                                       \
+        }                                                                       \
+    }                                                                           \
+    return row[s2_len];                                                         \
+}
+
+#ifndef JFISH_NO_SMALL_KERNELS
+LEVENSHTEIN_SMALL(8)
+LEVENSHTEIN_SMALL(16)
+LEVENSHTEIN_SMALL(32)
+#endif
+
+
+/*
+  Full-matrix kernels, one per cell type.  No cell exceeds the length of the
+  longer string, so levenshtein_distance() picks the narrowest type that
+  holds it: 8-bit cells for strings shorter than 255 characters, 16-bit
+  below 65535, which keeps the matrix of typical inputs in cache.  The
+  matrix is filled row by row so the cells are read sequentially.
+*/
+#define LEVENSHTEIN_MATRIX(NAME, CELL)                                          \
+static int NAME(const JFISH_UNICODE *s1, int s1_len,                            \
+                const JFISH_UNICODE *s2, int s2_len)                            \
+{                                                                               \
+    size_t rows = s1_len + 1;                                                   \
+    size_t cols = s2_len + 1;                                                   \
+    size_t i, j;                                                                \
+                                                                                \
+    unsigned result;                                                            \
+    unsigned d1, d2, d3;                                                        \
+    CELL *dist;                                                                 \
+                                                                                \
+    dist = safe_matrix_malloc(rows, cols, sizeof(CELL));                        \
+    if (!dist) {                                                                \
+        return -1;                                                              \
+    }                                                                           \
+                                                                                \
+    for (i = 0; i < rows; i++) {                                                \
+        dist[i * cols] = i;                                                     \
+    }                                                                           \
+                                                                                \
+    for (j = 0; j < cols; j++) {                                                \
+        dist[j] = j;                                                            \
+    }                                                                           \
+                                                                                \
+    for (i = 1; i < rows; i++) {                                                \
+        for (j = 1; j < cols; j++) {                                            \
+            if (s1[i - 1] == s2[j - 1]) {                                       \
+                dist[(i * cols) + j] = dist[((i - 1) * cols) + (j - 1)];        \
+            } else {                                                            \
+                d1 = dist[((i - 1) * cols) + j] + 1;                            \
+                d2 = dist[(i * cols) + (j - 1)] + 1;                            \
+                d3 = dist[((i - 1) * cols) + (j - 1)] + 1;                      \
+                                                                                \
+                dist[(i * cols) + j] = MIN(d1, MIN(d2, d3));                    \
+            }                                                                   \
+        }                                                                       \
+    }                                                                           \
+                                                                                \
+    result = dist[(cols * rows) - 1];                                           \
+                                                                                \
+    free(dist);                                                                 \
+                                                                                \
+    return result;                                                              \
+}
+
+LEVENSHTEIN_MATRIX(levenshtein_matrix_u8, uint8_t)
+LEVENSHTEIN_MATRIX(levenshtein_matrix_u16, uint16_t)
+LEVENSHTEIN_MATRIX(levenshtein_matrix_u32, unsigned)
+
+
+/*
+  Ukkonen's doubling search: the band |i - j| <= k holds the answer once
+  the distance is at most k, so try k = 1, 2, 4, ... (starting at the
+  length difference) with levenshtein_distance_bounded(), which also gives
+  up early on rows that are wholly out of the band's reach.  This finds a
+  distance d in O(n * d).  Once the band would cover a quarter of the
+  shorter string the full matrix is cheaper, and LEVENSHTEIN_FAR is
+  returned instead.
+*/
+#define LEVENSHTEIN_FAR (-2)
+
+static int levenshtein_distance_doubling(const JFISH_UNICODE *s1, int s1_len,
+                                         const JFISH_UNICODE *s2, int s2_len)
+{
+    int k = abs(s1_len - s2_len), result;
+
+    if (k < 1) {
+        k = 1;
+    }
+    for (; 4 * k < MIN(s1_len, s2_len); k *= 2) {
+        result = levenshtein_distance_bounded(s1, s1_len, s2, s2_len, k);
+        if (result <= k) {
+            return result;
+        }
+    }
+    return LEVENSHTEIN_FAR;
+}
+
+
 int levenshtein_distance(const JFISH_UNICODE *s1, int s1_len, const JFISH_UNICODE *s2, int s2_len)
 {
-    size_t rows = s1_len + 1;
-    size_t cols = s2_len + 1;
-    size_t i, j;
-
-    unsigned result;
-    unsigned d1, d2, d3;
-    unsigned *dist = safe_matrix_malloc(rows, cols, sizeof(unsigned));
-    if (!dist) {
-        return -1;
+    int result;
+
+#ifndef JFISH_NO_SMALL_KERNELS
+    if (s1_len <= 8 && s2_len <= 8) {
+        return levenshtein_distance_8(s1, s1_len, s2, s2_len);
+    }
+    if (s1_len <= 16 && s2_len <= 16) {
+        return levenshtein_distance_16(s1, s1_len, s2, s2_len);
+    }
+    if (s1_len <= 32 && s2_len <= 32) {
+        return levenshtein_distance_32(s1, s1_len, s2, s2_len);
+    }
+#endif
+
+    /* near-duplicates: strip what the strings share at either end, then
+     * look for the distance in bands of doubling width */
+    while (s1_len && s2_len && *s1 == *s2) {
+        s1++;
+        s2++;
+        s1_len--;
+        s2_len--;
+    }
+    while (s1_len && s2_len && s1[s1_len - 1] == s2[s2_len - 1]) {
+        s1_len--;
+        s2_len--;
+    }
+    if (!s1_len || !s2_len) {
+        return s1_len + s2_len;
+    }
+    result = levenshtein_distance_doubling(s1, s1_len, s2, s2_len);
+    if (result != LEVENSHTEIN_FAR) {
+        return result;
     }
 
-    for (i = 0; i < rows; i++) {
-        dist[i * cols] = i;
+    if (s1_len < UINT8_MAX && s2_len < UINT8_MAX) {
+        return levenshtein_matrix_u8(s1, s1_len, s2, s2_len);
+    }
+    if (s1_len < UINT16_MAX && s2_len < UINT16_MAX) {
+        return levenshtein_matrix_u16(s1, s1_len, s2, s2_len);
+    }
+    return levenshtein_matrix_u32(s1, s1_len, s2, s2_len);
+}
+
+
+/*
+  Levenshtein distance if it is at most max_distance, otherwise
+  max_distance + 1.
+
+  Only the diagonal band |i - j| <= max_distance of the matrix can hold
+  values within the bound (Ukkonen), so each row computes that band using
+  two rolling rows, and stops as soon as a whole band row exceeds the bound.
+  Returns -1 on failed malloc.
+*/
+int levenshtein_distance_bounded(const JFISH_UNICODE *s1, int s1_len,
+                                 const JFISH_UNICODE *s2, int s2_len, int max_distance)
+{
+    unsigned limit, row_min, d1, d2, d3;
+    unsigned *prev, *cur, *tmp;
+    int i, j, lo, hi;
+
+    if (max_distance < 0) {
+        return 0 == s1_len && 0 == s2_len ? 0 : max_distance + 1;
     }
+    if (abs(s1_len - s2_len) > max_distance) {
+        return max_distance + 1;
+    }
+    limit = max_distance + 1;
 
+    prev = safe_malloc(2 * ((size_t)s2_len + 1), sizeof(unsigned));
+    if (!prev) {
+        return -1;
+    }
+    cur = prev + s2_len + 1;
 
-    for (j = 0; j < cols; j++) {
-        dist[j] = j;
+    for (j = 0; j <= s2_len; j++) {
+        prev[j] = j <= max_distance ? (unsigned)j : limit;
     }
 
-    for (j = 1; j < cols; j++) {
-        for (i = 1; i < rows; i++) {
-            if (s1[i - 1] == s2[j - 1]) {
-                dist[(i * cols) + j] = dist[((i - 1) * cols) + (j - 1)];
-            } else {
-                d1 = dist[((i - 1) * cols) + j] + 1;
-                d2 = dist[(i * cols) + (j - 1)] + 1;
-                d3 = dist[((i - 1) * cols) + (j - 1)] + 1;
+    for (i = 1; i <= s1_len; i++) {
+        lo = i - max_distance > 1 ? i - max_distance : 1;
+        hi = i + max_distance < s2_len ? i + max_distance : s2_len;
 
-                dist[(i * cols) + j] = MIN(d1, MIN(d2, d3));
-            }
+        cur[lo - 1] = (lo == 1 && i <= max_distance) ? (unsigned)i : limit;
+        row_min = cur[lo - 1];
+        for (j = lo; j <= hi; j++) {
+            d1 = prev[j - 1] + (s1[i - 1] != s2[j - 1]);
+            d2 = prev[j] + 1;
+            d3 = cur[j - 1] + 1;
+            d1 = MIN(d1, MIN(d2, d3));
+            cur[j] = MIN(d1, limit);
+            row_min = MIN(row_min, cur[j]);
         }
+        if (hi < s2_len) {
+            cur[hi + 1] = limit;
+        }
+
+        if (row_min >= limit) {
+            free(prev < cur ? prev : cur);
+            return limit;
+        }
+        tmp = prev; prev = cur; cur = tmp;
+    }
+
+    d1 = prev[s2_len];
+    free(prev < cur ? prev : cur);
+    return d1;
+}
+
+
+/*
+  levenshtein_distance() that stops when budget runs out.
+
+  Common affixes are stripped first, then the matrix is filled a row at a
+  time over two rolling rows, asking the budget before each row.  If it
+  runs out, returns JFISH_BUDGET_EXCEEDED and sets *lower_bound from the
+  last finished row i: every alignment crosses it at some column j, and
+  what is left of the strings then differs in length by
+  |(s1_len - i) - (s2_len - j)|, so the distance is at least the smallest
+  row[j] plus that difference.  Returns -1 on failed malloc.
+*/
+int levenshtein_distance_budget(const JFISH_UNICODE *s1, int s1_len,
+                                const JFISH_UNICODE *s2, int s2_len,
+                                const struct jfish_budget *budget, int *lower_bound)
+{
+    const JFISH_UNICODE *tmp_str;
+    unsigned *prev, *cur, *tmp;
+    unsigned d1, d2, d3, bound;
+    uint64_t cells = 0;
+    int i, j, rest;
+
+    if (jfish_budget_unlimited(budget, s1_len, s2_len)) {
+        return levenshtein_distance(s1, s1_len, s2, s2_len);
+    }
+
+    while (s1_len && s2_len && *s1 == *s2) {
+        s1++;
+        s2++;
+        s1_len--;
+        s2_len--;
+    }
+    while (s1_len && s2_len && s1[s1_len - 1] == s2[s2_len - 1]) {
+        s1_len--;
+        s2_len--;
+    }
+    /* keep the rows as short as possible */
+    if (s2_len > s1_len) {
+        tmp_str = s1; s1 = s2; s2 = tmp_str;
+        i = s1_len; s1_len = s2_len; s2_len = i;
+    }
+    if (!s2_len) {
+        return s1_len;
     }
 
-    result = dist[(cols * rows) - 1];
+    prev = safe_malloc(2 * ((size_t)s2_len + 1), sizeof(unsigned));
+    if (!prev) {
+        return -1;
+    }
+    cur = prev + s2_len + 1;
+    for (j = 0; j <= s2_len; j++) {
+        prev[j] = j;
+    }
+
+    for (i = 1; i <= s1_len; i++) {
+        if (jfish_budget_exceeded(budget, cells, s2_len, i - 1)) {
+            bound = (unsigned)-1;
+            for (j = 0; j <= s2_len; j++) {
+                rest = (s1_len - (i - 1)) - (s2_len - j);
+                bound = MIN(bound, prev[j] + abs(rest));
+            }
+            *lower_bound = bound;
+            free(prev < cur ? prev : cur);
+            return JFISH_BUDGET_EXCEEDED;
+        }
 
-    free(dist);
+        cur[0] = i;
+        for (j = 1; j <= s2_len; j++) {
+            d1 = prev[j - 1] + (s1[i - 1] != s2[j - 1]);
+            d2 = prev[j] + 1;
+            d3 = cur[j - 1] + 1;
+            cur[j] = MIN(d1, MIN(d2, d3));
+        }
+        cells += s2_len;
+        tmp = prev; prev = cur; cur = tmp;
+    }
 
-    return result;
+    d1 = prev[s2_len];
+    free(prev < cur ? prev : cur);
+    return d1;
 }
@@ -7,193 +7,219 @@
 #define ISVOWEL(a) ((a) == 'a' || (a) == 'e' || (a) == 'i' || \
                     (a) == 'o' || (a) == 'u')
 
-char* metaphone(const char *str)
-{
-    const char *s;
-    char c, next, nextnext, temp = '\0';
+/*
+  Metaphone as a single forward scan with one character of lookbehind and
+  two of lookahead.  Characters are folded to lower case with FOLD (ASCII
+  only, bytes >= 0x80 pass through as they do for tolower() in the C and
+  UTF-8 locales), and letters whose code never depends on their neighbours
+  are looked up in simple_code[]; only the context-dependent letters go
+  through the switch.
+*/
 
-    // Worst case (a string of all x's) will result in a
-    // metaphone twice as large as the original string
-    char *result = calloc(strlen(str) * 2 + 1, sizeof(char));
-    char *r;
+#define FOLD(c) ((c) >= 'A' && (c) <= 'Z' ? (c) + ('a' - 'A') : (c))
 
-    if (!result) {
-        return NULL;
-    }
+/* code for letters that always map to the same output, 0 otherwise */
+static const char simple_code[26] = {
+    0, 0, 0, 0, 0, 'F', 0, 0, 0, 'J', 0, 'L', 'M',
+    'N', 0, 0, 'K', 'R', 0, 0, 0, 'F', 0, 0, 0, 'S'
+};
+
+#define EMIT(ch) do {                           \
+        if (n + 1 < out_size) {                 \
+            out[n] = (ch);                      \
+        }                                       \
+        n++;                                    \
+    } while (0)
+
+
+/*
+  Write the metaphone code of str into out, which holds out_size bytes, and
+  return the length of the full code.  Like snprintf(), at most
+  out_size - 1 characters are written, always followed by a NUL (unless
+  out_size is 0), so a return value >= out_size means the code was cut
+  short.  The code is never longer than twice the input.
+*/
+size_t metaphone_into(const char *str, char *out, size_t out_size)
+{
+    const unsigned char *s = (const unsigned char *)str;
+    const unsigned char *start;
+    int c, next, nextnext;
+    size_t n = 0;
 
-    c = tolower(*str);
+    c = FOLD(s[0]);
     if (c) {
-        next = tolower(*(str + 1));
+        next = FOLD(s[1]);
 
         if ((c == 'k' && next == 'n') ||
             (c == 'g' && next == 'n') ||
             (c == 'p' && next == 'n') ||
             (c == 'w' && next == 'r') ||
             (c == 'a' && next == 'e')) {
-            str++;
+            s++;
         }
     }
 
-
-    next = tolower(*str);
-    for (s = str, r = result; next; s++) {
+    start = s;
+    next = FOLD(s[0]);
+    for (; next; s++) {
         c = next;
-        next = tolower(*(s + 1));
-        nextnext = tolower(*(s + 2));
+        next = FOLD(s[1]);
+        nextnext = next ? FOLD(s[2]) : '\0';
 
         if (c == next && c != 'c') {
             continue;
         }
 
+        if (c >= 'a' && c <= 'z' && simple_code[c - 'a']) {
+            EMIT(simple_code[c - 'a']);
+            continue;
+        }
+
         switch(c) {
         case 'a':
         case 'e':
         case 'i':
         case 'o':
         case 'u':
-            if (s == str || *(s - 1) == ' ') {
-                *r++ = toupper(c);
+            if (s == start || s[-1] == ' ') {
+                EMIT(c - ('a' - 'A'));
             }
             break;
         case 'b':
-            if (!(s > str && tolower(*(s - 1)) == 'm') || next) {
-                *r++ = 'B';
+            if (!(s > start && FOLD(s[-1]) == 'm') || next) {
+                EMIT('B');
             }
             break;
         case 'c':
             if ((next == 'i' && nextnext == 'a') || next == 'h') {
-                *r++ = 'X';
-                next = tolower(*(++s + 1));
+                EMIT('X');
+                s++;
+                next = FOLD(s[1]);
             } else if (next == 'i' || next == 'e' || next == 'y') {
-                *r++ = 'S';
-                next = tolower(*(++s + 1));
+                EMIT('S');
+                s++;
+                next = FOLD(s[1]);
             } else {
-                *r++ = 'K';
+                EMIT('K');
             }
             break;
         case 'd':
             if (next == 'g' && (nextnext == 'e' || nextnext == 'y' ||
                                 nextnext == 'i')) {
-                *r++ = 'J';
+                EMIT('J');
                 s += 2;
-                next = tolower(*(s + 1));
+                next = FOLD(s[1]);
             } else {
-                *r++ = 'T';
+                EMIT('T');
             }
             break;
-        case 'f':
-            *r++ = 'F';
-            break;
         case 'g':
             if (next == 'i' || next == 'e' || next == 'y') {
-                *r++ = 'J';
-            } else if(next == 'h' && !(ISVOWEL(nextnext))) {
+                EMIT('J');
+            } else if (next == 'h' && !(ISVOWEL(nextnext))) {
                 s++;
-                next = tolower(*(s + 1));
-            } else if(next == 'n' && !nextnext) {
+                next = FOLD(s[1]);
+            } else if (next == 'n' && !nextnext) {
                 s++;
-                next = tolower(*(s + 1));
+                next = FOLD(s[1]);
             } else {
-                *r++ = 'K';
+                EMIT('K');
             }
             break;
         case 'h':
-            if (s == str || ISVOWEL(next) || (temp = tolower(*(s - 1)) &&
-                                              ISVOWEL(temp))) {
-                *r++ = 'H';
+            if (s == start || ISVOWEL(next)) {
+                EMIT('H');
             }
             break;
-        case 'j':
-            *r++ = 'J';
-            break;
         case 'k':
-            if (s == str || tolower(*(s - 1)) != 'c') {
-                *r++ = 'K';
+            if (s == start || FOLD(s[-1]) != 'c') {
+                EMIT('K');
             }
             break;
-        case 'l':
-            *r++ = 'L';
-            break;
-        case 'm':
-            *r++ = 'M';
-            break;
-        case 'n':
-            *r++ = 'N';
-            break;
         case 'p':
             if (next == 'h') {
-                *r++ = 'F';
-                next = tolower(*(++s + 1));
+                EMIT('F');
+                s++;
+                next = FOLD(s[1]);
             } else {
-                *r++ = 'P';
+                EMIT('P');
             }
             break;
-        case 'q':
-            *r++ = 'K';
-            break;
-        case 'r':
-            *r++ = 'R';
-            break;
         case 's':
             if (next == 'h') {
-                *r++ = 'X';
-                next = tolower(*(++s + 1));
+                EMIT('X');
+                s++;
+                next = FOLD(s[1]);
             } else if (next == 'i' && (nextnext == 'o' || nextnext == 'a')) {
-                *r++ = 'X';
+                EMIT('X');
                 s += 2;
-                next = tolower(*(s + 1));
+                next = FOLD(s[1]);
             } else {
-                *r++ = 'S';
+                EMIT('S');
             }
             break;
         case 't':
             if (next == 'i' && (nextnext == 'a' || nextnext == 'o')) {
-                *r++ = 'X';
-            } else if(next == 'h') {
-                *r++ = '0';
-                next = tolower(*(++s + 1));
-            } else if(next != 'c' || nextnext != 'h') {
-                *r++ = 'T';
+                EMIT('X');
+            } else if (next == 'h') {
+                EMIT('0');
+                s++;
+                next = FOLD(s[1]);
+            } else if (next != 'c' || nextnext != 'h') {
+                EMIT('T');
             }
             break;
-        case 'v':
-            *r++ = 'F';
-            break;
         case 'w':
-            if (s == str && next == 'h') {
-                next = tolower(*(++s + 1));
-                *r++ = 'W';
+            if (s == start && next == 'h') {
+                s++;
+                next = FOLD(s[1]);
+                EMIT('W');
             } else if (ISVOWEL(next)) {
-                *r++ = 'W';
+                EMIT('W');
             }
             break;
         case 'x':
-            if (s == str) {
+            if (s == start) {
                 if (next == 'h' || (next == 'i' && (nextnext == 'o' || nextnext == 'a'))) {
-                    *r++ = 'X';
+                    EMIT('X');
                 } else {
-                    *r++ = 'S';
+                    EMIT('S');
                 }
             } else {
-                *r++ = 'K';
-                *r++ = 'S';
+                EMIT('K');
+                EMIT('S');
             }
             break;
         case 'y':
             if (ISVOWEL(next)) {
-                *r++ = 'Y';
+                EMIT('Y');
             }
             break;
-        case 'z':
-            *r++ = 'S';
-            break;
         case ' ':
-            if (r != result && *r != ' ') {
-                *r++ = ' ';
+            if (n) {
+                EMIT(' ');
             }
             break;
         }
     }
 
+    if (out_size) {
+        out[MIN(n, out_size - 1)] = '\0';
+    }
+    return n;
+}
+
+
+char* metaphone(const char *str)
+{
+    // Worst case (a string of all x's) will result in a
+    // metaphone twice as large as the original string
+    size_t size = strlen(str) * 2 + 1;
+    char *result = malloc(size);
+
+    if (!result) {
+        return NULL;
+    }
+    metaphone_into(str, result, size);
     return result;
 }
@@ -0,0 +1,268 @@
+#include "jellyfish.h"
+#include <string.h>
+#include <stdlib.h>
+
+/*
+  MinHash signatures over character shingles and LSH banding.
+
+  Each shingle (run of `shingle` consecutive characters) is hashed once to
+  64 bits; the num_perm permutations are then derived from that single hash
+  as ((a_i * h + b_i) mod 2^64) >> 32 with random odd a_i, so the per-shingle
+  inner loop is a multiply, add, shift and min over flat arrays, which
+  compilers vectorize.  Signatures are uint32_t and a collection of them is
+  a flat row-major count * num_perm array, suitable for writing to disk and
+  mmap'ing back.
+
+  Candidate pairs are produced by splitting signatures into bands of
+  num_perm / bands rows: strings whose rows agree in any band share a bucket.
+  Candidates should be verified with jaro_winkler_similarity().
+*/
+
+struct minhash {
+    int num_perm;
+    int shingle;
+    uint64_t *a;
+    uint64_t *b;
+};
+
+
+static uint64_t splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+
+struct minhash* minhash_create(int num_perm, int shingle, uint64_t seed)
+{
+    struct minhash *mh;
+    int i;
+
+    if (num_perm < 1 || shingle < 1) {
+        return NULL;
+    }
+
+    mh = calloc(1, sizeof(struct minhash));
+    if (!mh) {
+        return NULL;
+    }
+    mh->num_perm = num_perm;
+    mh->shingle = shingle;
+    mh->a = safe_malloc(num_perm, sizeof(uint64_t));
+    mh->b = safe_malloc(num_perm, sizeof(uint64_t));
+    if (!mh->a || !mh->b) {
+        minhash_free(mh);
+        return NULL;
+    }
+
+    for (i = 0; i < num_perm; i++) {
+        mh->a[i] = splitmix64(&seed) | 1;
+        mh->b[i] = splitmix64(&seed);
+    }
+    return mh;
+}
+
+
+void minhash_free(struct minhash *mh)
+{
+    if (!mh) {
+        return;
+    }
+    free(mh->a);
+    free(mh->b);
+    free(mh);
+}
+
+
+static uint64_t shingle_hash(const JFISH_UNICODE *s, int n)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        h ^= (uint64_t)s[i];
+        h *= 0x100000001b3ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    return h ^ (h >> 33);
+}
+
+
+/*
+  Write the num_perm signature values for str into sig.  Strings shorter
+  than the shingle size are treated as a single shingle; the empty string
+  gets an all-ones signature.
+*/
+void minhash_signature(const struct minhash *mh, const JFISH_UNICODE *str, int len, uint32_t *sig)
+{
+    const uint64_t *a = mh->a, *b = mh->b;
+    int i, p, n = mh->num_perm;
+    int shingles, width;
+    uint64_t h;
+    uint32_t v;
+
+    for (p = 0; p < n; p++) {
+        sig[p] = UINT32_MAX;
+    }
+    if (!len) {
+        return;
+    }
+
+    width = len < mh->shingle ? len : mh->shingle;
+    shingles = len - width + 1;
+    for (i = 0; i < shingles; i++) {
+        h = shingle_hash(str + i, width);
+        for (p = 0; p < n; p++) {
+            v = (uint32_t)((a[p] * h + b[p]) >> 32);
+            sig[p] = v < sig[p] ? v : sig[p];
+        }
+    }
+}
+
+
+void minhash_signatures(const struct minhash *mh, const JFISH_UNICODE *const *strs, const int *lens,
+                        int count, uint32_t *out)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        minhash_signature(mh, strs[i], lens[i], out + (size_t)i * mh->num_perm);
+    }
+}
+
+
+/* Fraction of agreeing signature positions, an estimate of Jaccard similarity. */
+double minhash_similarity(const uint32_t *sig1, const uint32_t *sig2, int num_perm)
+{
+    int i, same = 0;
+
+    if (num_perm < 1) return 0;
+
+    for (i = 0; i < num_perm; i++) {
+        same += sig1[i] == sig2[i];
+    }
+    return (double)same / num_perm;
+}
+
+
+struct lsh_bucket {
+    uint64_t key;
+    int id;
+};
+
+
+static int lsh_bucket_cmp(const void *a, const void *b)
+{
+    const struct lsh_bucket *x = a, *y = b;
+
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return x->id - y->id;
+}
+
+
+static int lsh_pair_cmp(const void *a, const void *b)
+{
+    const int *x = a, *y = b;
+
+    if (x[0] != y[0]) {
+        return x[0] - y[0];
+    }
+    return x[1] - y[1];
+}
+
+
+/*
+  Emit the distinct candidate pairs (i, j), i < j, whose signatures collide
+  in at least one band.  On success *pairs points to a malloc'd array of
+  2 * *npairs ints (caller frees) and 0 is returned; -1 on allocation
+  failure.  Rows left over when num_perm is not divisible by bands are
+  ignored.
+*/
+int lsh_candidate_pairs(const uint32_t *sigs, int count, int num_perm, int bands,
+                        int **pairs, size_t *npairs)
+{
+    struct lsh_bucket *buckets = NULL;
+    int *out = NULL, *grown;
+    size_t n = 0, cap = 0, i, j, k, start;
+    int band, rows, r, ret = -1;
+    uint64_t key;
+
+    *pairs = NULL;
+    *npairs = 0;
+    if (bands < 1 || bands > num_perm) {
+        return -1;
+    }
+    rows = num_perm / bands;
+
+    buckets = safe_malloc((size_t)count + 1, sizeof(struct lsh_bucket));
+    if (!buckets) {
+        return -1;
+    }
+
+    for (band = 0; band < bands; band++) {
+        for (i = 0; i < (size_t)count; i++) {
+            const uint32_t *row = sigs + i * num_perm + (size_t)band * rows;
+            key = 0x9E3779B97F4A7C15ull * (band + 1);
+            for (r = 0; r < rows; r++) {
+                key ^= row[r];
+                key *= 0x100000001b3ull;
+                key ^= key >> 31;
+            }
+            buckets[i].key = key;
+            buckets[i].id = (int)i;
+        }
+        qsort(buckets, count, sizeof(struct lsh_bucket), lsh_bucket_cmp);
+
+        for (start = 0; start < (size_t)count; start = k) {
+            for (k = start + 1; k < (size_t)count && buckets[k].key == buckets[start].key; k++);
+            for (i = start; i < k; i++) {
+                for (j = i + 1; j < k; j++) {
+                    /* the band key is a hash, confirm the rows really agree */
+                    if (memcmp(sigs + (size_t)buckets[i].id * num_perm + (size_t)band * rows,
+                               sigs + (size_t)buckets[j].id * num_perm + (size_t)band * rows,
+                               rows * sizeof(uint32_t))) {
+                        continue;
+                    }
+                    if (n == cap) {
+                        cap = cap ? cap * 2 : 64;
+                        grown = realloc(out, cap * 2 * sizeof(int));
+                        if (!grown) {
+                            goto cleanup;
+                        }
+                        out = grown;
+                    }
+                    out[2 * n] = buckets[i].id;
+                    out[2 * n + 1] = buckets[j].id;
+                    n++;
+                }
+            }
+        }
+    }
+
+    /* the same pair can collide in several bands */
+    if (n) {
+        qsort(out, n, 2 * sizeof(int), lsh_pair_cmp);
+    }
+    for (i = 0, k = 0; i < n; i++) {
+        if (!k || out[2 * i] != out[2 * (k - 1)] || out[2 * i + 1] != out[2 * (k - 1) + 1]) {
+            out[2 * k] = out[2 * i];
+            out[2 * k + 1] = out[2 * i + 1];
+            k++;
+        }
+    }
+
+    *pairs = out;
+    *npairs = k;
+    out = NULL;
+    ret = 0;
+
+ cleanup:
+    free(out);
+    free(buckets);
+    return ret;
+}
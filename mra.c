@@ -95,6 +95,12 @@ JFISH_UNICODE* match_rating_codex(const JFISH_UNICODE *str, size_t len) {
     return codex;
 }
 
+/* Write the NUL terminated codex of the uppercase str into codex and return
+ * its length. */
+size_t match_rating_codex_into(const JFISH_UNICODE *str, size_t len, JFISH_UNICODE codex[7]) {
+    return compute_match_rating_codex(str, len, codex);
+}
+
 static size_t compute_match_rating_codex(const JFISH_UNICODE *str, size_t len, JFISH_UNICODE codex[7]) {
     /* str is already in uppercase when this function is called */
     size_t i, j;
@@ -0,0 +1,283 @@
+#include "jellyfish.h"
+
+/*
+  Compact NFKD table for the Latin blocks.
+
+  Generated with Python's unicodedata (Unicode 14.0.0) for U+00A0..U+024F
+  (Latin-1 Supplement, Latin Extended-A/B) and U+1E00..U+1EFF (Latin
+  Extended Additional):
+
+      for c in range(lo, hi):
+          d = unicodedata.normalize("NFKD", chr(c))
+          row = [ord(x) for x in d] + [0] * (3 - len(d))
+
+  Every decomposition in these ranges is at most 3 code points, fits in 16
+  bits and starts with a non-combining character, so concatenating the
+  per-character decompositions of a string made only of ASCII and these
+  characters gives exactly its NFKD form (no canonical reordering can
+  cross a character boundary).
+*/
+
+static const uint16_t nfkd_latin1_ext[432][3] = {
+    {0x0020, 0x0000, 0x0000}, {0x00A1, 0x0000, 0x0000}, {0x00A2, 0x0000, 0x0000},
+    {0x00A3, 0x0000, 0x0000}, {0x00A4, 0x0000, 0x0000}, {0x00A5, 0x0000, 0x0000},
+    {0x00A6, 0x0000, 0x0000}, {0x00A7, 0x0000, 0x0000}, {0x0020, 0x0308, 0x0000},
+    {0x00A9, 0x0000, 0x0000}, {0x0061, 0x0000, 0x0000}, {0x00AB, 0x0000, 0x0000},
+    {0x00AC, 0x0000, 0x0000}, {0x00AD, 0x0000, 0x0000}, {0x00AE, 0x0000, 0x0000},
+    {0x0020, 0x0304, 0x0000}, {0x00B0, 0x0000, 0x0000}, {0x00B1, 0x0000, 0x0000},
+    {0x0032, 0x0000, 0x0000}, {0x0033, 0x0000, 0x0000}, {0x0020, 0x0301, 0x0000},
+    {0x03BC, 0x0000, 0x0000}, {0x00B6, 0x0000, 0x0000}, {0x00B7, 0x0000, 0x0000},
+    {0x0020, 0x0327, 0x0000}, {0x0031, 0x0000, 0x0000}, {0x006F, 0x0000, 0x0000},
+    {0x00BB, 0x0000, 0x0000}, {0x0031, 0x2044, 0x0034}, {0x0031, 0x2044, 0x0032},
+    {0x0033, 0x2044, 0x0034}, {0x00BF, 0x0000, 0x0000}, {0x0041, 0x0300, 0x0000},
+    {0x0041, 0x0301, 0x0000}, {0x0041, 0x0302, 0x0000}, {0x0041, 0x0303, 0x0000},
+    {0x0041, 0x0308, 0x0000}, {0x0041, 0x030A, 0x0000}, {0x00C6, 0x0000, 0x0000},
+    {0x0043, 0x0327, 0x0000}, {0x0045, 0x0300, 0x0000}, {0x0045, 0x0301, 0x0000},
+    {0x0045, 0x0302, 0x0000}, {0x0045, 0x0308, 0x0000}, {0x0049, 0x0300, 0x0000},
+    {0x0049, 0x0301, 0x0000}, {0x0049, 0x0302, 0x0000}, {0x0049, 0x0308, 0x0000},
+    {0x00D0, 0x0000, 0x0000}, {0x004E, 0x0303, 0x0000}, {0x004F, 0x0300, 0x0000},
+    {0x004F, 0x0301, 0x0000}, {0x004F, 0x0302, 0x0000}, {0x004F, 0x0303, 0x0000},
+    {0x004F, 0x0308, 0x0000}, {0x00D7, 0x0000, 0x0000}, {0x00D8, 0x0000, 0x0000},
+    {0x0055, 0x0300, 0x0000}, {0x0055, 0x0301, 0x0000}, {0x0055, 0x0302, 0x0000},
+    {0x0055, 0x0308, 0x0000}, {0x0059, 0x0301, 0x0000}, {0x00DE, 0x0000, 0x0000},
+    {0x00DF, 0x0000, 0x0000}, {0x0061, 0x0300, 0x0000}, {0x0061, 0x0301, 0x0000},
+    {0x0061, 0x0302, 0x0000}, {0x0061, 0x0303, 0x0000}, {0x0061, 0x0308, 0x0000},
+    {0x0061, 0x030A, 0x0000}, {0x00E6, 0x0000, 0x0000}, {0x0063, 0x0327, 0x0000},
+    {0x0065, 0x0300, 0x0000}, {0x0065, 0x0301, 0x0000}, {0x0065, 0x0302, 0x0000},
+    {0x0065, 0x0308, 0x0000}, {0x0069, 0x0300, 0x0000}, {0x0069, 0x0301, 0x0000},
+    {0x0069, 0x0302, 0x0000}, {0x0069, 0x0308, 0x0000}, {0x00F0, 0x0000, 0x0000},
+    {0x006E, 0x0303, 0x0000}, {0x006F, 0x0300, 0x0000}, {0x006F, 0x0301, 0x0000},
+    {0x006F, 0x0302, 0x0000}, {0x006F, 0x0303, 0x0000}, {0x006F, 0x0308, 0x0000},
+    {0x00F7, 0x0000, 0x0000}, {0x00F8, 0x0000, 0x0000}, {0x0075, 0x0300, 0x0000},
+    {0x0075, 0x0301, 0x0000}, {0x0075, 0x0302, 0x0000}, {0x0075, 0x0308, 0x0000},
+    {0x0079, 0x0301, 0x0000}, {0x00FE, 0x0000, 0x0000}, {0x0079, 0x0308, 0x0000},
+    {0x0041, 0x0304, 0x0000}, {0x0061, 0x0304, 0x0000}, {0x0041, 0x0306, 0x0000},
+    {0x0061, 0x0306, 0x0000}, {0x0041, 0x0328, 0x0000}, {0x0061, 0x0328, 0x0000},
+    {0x0043, 0x0301, 0x0000}, {0x0063, 0x0301, 0x0000}, {0x0043, 0x0302, 0x0000},
+    {0x0063, 0x0302, 0x0000}, {0x0043, 0x0307, 0x0000}, {0x0063, 0x0307, 0x0000},
+    {0x0043, 0x030C, 0x0000}, {0x0063, 0x030C, 0x0000}, {0x0044, 0x030C, 0x0000},
+    {0x0064, 0x030C, 0x0000}, {0x0110, 0x0000, 0x0000}, {0x0111, 0x0000, 0x0000},
+    {0x0045, 0x0304, 0x0000}, {0x0065, 0x0304, 0x0000}, {0x0045, 0x0306, 0x0000},
+    {0x0065, 0x0306, 0x0000}, {0x0045, 0x0307, 0x0000}, {0x0065, 0x0307, 0x0000},
+    {0x0045, 0x0328, 0x0000}, {0x0065, 0x0328, 0x0000}, {0x0045, 0x030C, 0x0000},
+    {0x0065, 0x030C, 0x0000}, {0x0047, 0x0302, 0x0000}, {0x0067, 0x0302, 0x0000},
+    {0x0047, 0x0306, 0x0000}, {0x0067, 0x0306, 0x0000}, {0x0047, 0x0307, 0x0000},
+    {0x0067, 0x0307, 0x0000}, {0x0047, 0x0327, 0x0000}, {0x0067, 0x0327, 0x0000},
+    {0x0048, 0x0302, 0x0000}, {0x0068, 0x0302, 0x0000}, {0x0126, 0x0000, 0x0000},
+    {0x0127, 0x0000, 0x0000}, {0x0049, 0x0303, 0x0000}, {0x0069, 0x0303, 0x0000},
+    {0x0049, 0x0304, 0x0000}, {0x0069, 0x0304, 0x0000}, {0x0049, 0x0306, 0x0000},
+    {0x0069, 0x0306, 0x0000}, {0x0049, 0x0328, 0x0000}, {0x0069, 0x0328, 0x0000},
+    {0x0049, 0x0307, 0x0000}, {0x0131, 0x0000, 0x0000}, {0x0049, 0x004A, 0x0000},
+    {0x0069, 0x006A, 0x0000}, {0x004A, 0x0302, 0x0000}, {0x006A, 0x0302, 0x0000},
+    {0x004B, 0x0327, 0x0000}, {0x006B, 0x0327, 0x0000}, {0x0138, 0x0000, 0x0000},
+    {0x004C, 0x0301, 0x0000}, {0x006C, 0x0301, 0x0000}, {0x004C, 0x0327, 0x0000},
+    {0x006C, 0x0327, 0x0000}, {0x004C, 0x030C, 0x0000}, {0x006C, 0x030C, 0x0000},
+    {0x004C, 0x00B7, 0x0000}, {0x006C, 0x00B7, 0x0000}, {0x0141, 0x0000, 0x0000},
+    {0x0142, 0x0000, 0x0000}, {0x004E, 0x0301, 0x0000}, {0x006E, 0x0301, 0x0000},
+    {0x004E, 0x0327, 0x0000}, {0x006E, 0x0327, 0x0000}, {0x004E, 0x030C, 0x0000},
+    {0x006E, 0x030C, 0x0000}, {0x02BC, 0x006E, 0x0000}, {0x014A, 0x0000, 0x0000},
+    {0x014B, 0x0000, 0x0000}, {0x004F, 0x0304, 0x0000}, {0x006F, 0x0304, 0x0000},
+    {0x004F, 0x0306, 0x0000}, {0x006F, 0x0306, 0x0000}, {0x004F, 0x030B, 0x0000},
+    {0x006F, 0x030B, 0x0000}, {0x0152, 0x0000, 0x0000}, {0x0153, 0x0000, 0x0000},
+    {0x0052, 0x0301, 0x0000}, {0x0072, 0x0301, 0x0000}, {0x0052, 0x0327, 0x0000},
+    {0x0072, 0x0327, 0x0000}, {0x0052, 0x030C, 0x0000}, {0x0072, 0x030C, 0x0000},
+    {0x0053, 0x0301, 0x0000}, {0x0073, 0x0301, 0x0000}, {0x0053, 0x0302, 0x0000},
+    {0x0073, 0x0302, 0x0000}, {0x0053, 0x0327, 0x0000}, {0x0073, 0x0327, 0x0000},
+    {0x0053, 0x030C, 0x0000}, {0x0073, 0x030C, 0x0000}, {0x0054, 0x0327, 0x0000},
+    {0x0074, 0x0327, 0x0000}, {0x0054, 0x030C, 0x0000}, {0x0074, 0x030C, 0x0000},
+    {0x0166, 0x0000, 0x0000}, {0x0167, 0x0000, 0x0000}, {0x0055, 0x0303, 0x0000},
+    {0x0075, 0x0303, 0x0000}, {0x0055, 0x0304, 0x0000}, {0x0075, 0x0304, 0x0000},
+    {0x0055, 0x0306, 0x0000}, {0x0075, 0x0306, 0x0000}, {0x0055, 0x030A, 0x0000},
+    {0x0075, 0x030A, 0x0000}, {0x0055, 0x030B, 0x0000}, {0x0075, 0x030B, 0x0000},
+    {0x0055, 0x0328, 0x0000}, {0x0075, 0x0328, 0x0000}, {0x0057, 0x0302, 0x0000},
+    {0x0077, 0x0302, 0x0000}, {0x0059, 0x0302, 0x0000}, {0x0079, 0x0302, 0x0000},
+    {0x0059, 0x0308, 0x0000}, {0x005A, 0x0301, 0x0000}, {0x007A, 0x0301, 0x0000},
+    {0x005A, 0x0307, 0x0000}, {0x007A, 0x0307, 0x0000}, {0x005A, 0x030C, 0x0000},
+    {0x007A, 0x030C, 0x0000}, {0x0073, 0x0000, 0x0000}, {0x0180, 0x0000, 0x0000},
+    {0x0181, 0x0000, 0x0000}, {0x0182, 0x0000, 0x0000}, {0x0183, 0x0000, 0x0000},
+    {0x0184, 0x0000, 0x0000}, {0x0185, 0x0000, 0x0000}, {0x0186, 0x0000, 0x0000},
+    {0x0187, 0x0000, 0x0000}, {0x0188, 0x0000, 0x0000}, {0x0189, 0x0000, 0x0000},
+    {0x018A, 0x0000, 0x0000}, {0x018B, 0x0000, 0x0000}, {0x018C, 0x0000, 0x0000},
+    {0x018D, 0x0000, 0x0000}, {0x018E, 0x0000, 0x0000}, {0x018F, 0x0000, 0x0000},
+    {0x0190, 0x0000, 0x0000}, {0x0191, 0x0000, 0x0000}, {0x0192, 0x0000, 0x0000},
+    {0x0193, 0x0000, 0x0000}, {0x0194, 0x0000, 0x0000}, {0x0195, 0x0000, 0x0000},
+    {0x0196, 0x0000, 0x0000}, {0x0197, 0x0000, 0x0000}, {0x0198, 0x0000, 0x0000},
+    {0x0199, 0x0000, 0x0000}, {0x019A, 0x0000, 0x0000}, {0x019B, 0x0000, 0x0000},
+    {0x019C, 0x0000, 0x0000}, {0x019D, 0x0000, 0x0000}, {0x019E, 0x0000, 0x0000},
+    {0x019F, 0x0000, 0x0000}, {0x004F, 0x031B, 0x0000}, {0x006F, 0x031B, 0x0000},
+    {0x01A2, 0x0000, 0x0000}, {0x01A3, 0x0000, 0x0000}, {0x01A4, 0x0000, 0x0000},
+    {0x01A5, 0x0000, 0x0000}, {0x01A6, 0x0000, 0x0000}, {0x01A7, 0x0000, 0x0000},
+    {0x01A8, 0x0000, 0x0000}, {0x01A9, 0x0000, 0x0000}, {0x01AA, 0x0000, 0x0000},
+    {0x01AB, 0x0000, 0x0000}, {0x01AC, 0x0000, 0x0000}, {0x01AD, 0x0000, 0x0000},
+    {0x01AE, 0x0000, 0x0000}, {0x0055, 0x031B, 0x0000}, {0x0075, 0x031B, 0x0000},
+    {0x01B1, 0x0000, 0x0000}, {0x01B2, 0x0000, 0x0000}, {0x01B3, 0x0000, 0x0000},
+    {0x01B4, 0x0000, 0x0000}, {0x01B5, 0x0000, 0x0000}, {0x01B6, 0x0000, 0x0000},
+    {0x01B7, 0x0000, 0x0000}, {0x01B8, 0x0000, 0x0000}, {0x01B9, 0x0000, 0x0000},
+    {0x01BA, 0x0000, 0x0000}, {0x01BB, 0x0000, 0x0000}, {0x01BC, 0x0000, 0x0000},
+    {0x01BD, 0x0000, 0x0000}, {0x01BE, 0x0000, 0x0000}, {0x01BF, 0x0000, 0x0000},
+    {0x01C0, 0x0000, 0x0000}, {0x01C1, 0x0000, 0x0000}, {0x01C2, 0x0000, 0x0000},
+    {0x01C3, 0x0000, 0x0000}, {0x0044, 0x005A, 0x030C}, {0x0044, 0x007A, 0x030C},
+    {0x0064, 0x007A, 0x030C}, {0x004C, 0x004A, 0x0000}, {0x004C, 0x006A, 0x0000},
+    {0x006C, 0x006A, 0x0000}, {0x004E, 0x004A, 0x0000}, {0x004E, 0x006A, 0x0000},
+    {0x006E, 0x006A, 0x0000}, {0x0041, 0x030C, 0x0000}, {0x0061, 0x030C, 0x0000},
+    {0x0049, 0x030C, 0x0000}, {0x0069, 0x030C, 0x0000}, {0x004F, 0x030C, 0x0000},
+    {0x006F, 0x030C, 0x0000}, {0x0055, 0x030C, 0x0000}, {0x0075, 0x030C, 0x0000},
+    {0x0055, 0x0308, 0x0304}, {0x0075, 0x0308, 0x0304}, {0x0055, 0x0308, 0x0301},
+    {0x0075, 0x0308, 0x0301}, {0x0055, 0x0308, 0x030C}, {0x0075, 0x0308, 0x030C},
+    {0x0055, 0x0308, 0x0300}, {0x0075, 0x0308, 0x0300}, {0x01DD, 0x0000, 0x0000},
+    {0x0041, 0x0308, 0x0304}, {0x0061, 0x0308, 0x0304}, {0x0041, 0x0307, 0x0304},
+    {0x0061, 0x0307, 0x0304}, {0x00C6, 0x0304, 0x0000}, {0x00E6, 0x0304, 0x0000},
+    {0x01E4, 0x0000, 0x0000}, {0x01E5, 0x0000, 0x0000}, {0x0047, 0x030C, 0x0000},
+    {0x0067, 0x030C, 0x0000}, {0x004B, 0x030C, 0x0000}, {0x006B, 0x030C, 0x0000},
+    {0x004F, 0x0328, 0x0000}, {0x006F, 0x0328, 0x0000}, {0x004F, 0x0328, 0x0304},
+    {0x006F, 0x0328, 0x0304}, {0x01B7, 0x030C, 0x0000}, {0x0292, 0x030C, 0x0000},
+    {0x006A, 0x030C, 0x0000}, {0x0044, 0x005A, 0x0000}, {0x0044, 0x007A, 0x0000},
+    {0x0064, 0x007A, 0x0000}, {0x0047, 0x0301, 0x0000}, {0x0067, 0x0301, 0x0000},
+    {0x01F6, 0x0000, 0x0000}, {0x01F7, 0x0000, 0x0000}, {0x004E, 0x0300, 0x0000},
+    {0x006E, 0x0300, 0x0000}, {0x0041, 0x030A, 0x0301}, {0x0061, 0x030A, 0x0301},
+    {0x00C6, 0x0301, 0x0000}, {0x00E6, 0x0301, 0x0000}, {0x00D8, 0x0301, 0x0000},
+    {0x00F8, 0x0301, 0x0000}, {0x0041, 0x030F, 0x0000}, {0x0061, 0x030F, 0x0000},
+    {0x0041, 0x0311, 0x0000}, {0x0061, 0x0311, 0x0000}, {0x0045, 0x030F, 0x0000},
+    {0x0065, 0x030F, 0x0000}, {0x0045, 0x0311, 0x0000}, {0x0065, 0x0311, 0x0000},
+    {0x0049, 0x030F, 0x0000}, {0x0069, 0x030F, 0x0000}, {0x0049, 0x0311, 0x0000},
+    {0x0069, 0x0311, 0x0000}, {0x004F, 0x030F, 0x0000}, {0x006F, 0x030F, 0x0000},
+    {0x004F, 0x0311, 0x0000}, {0x006F, 0x0311, 0x0000}, {0x0052, 0x030F, 0x0000},
+    {0x0072, 0x030F, 0x0000}, {0x0052, 0x0311, 0x0000}, {0x0072, 0x0311, 0x0000},
+    {0x0055, 0x030F, 0x0000}, {0x0075, 0x030F, 0x0000}, {0x0055, 0x0311, 0x0000},
+    {0x0075, 0x0311, 0x0000}, {0x0053, 0x0326, 0x0000}, {0x0073, 0x0326, 0x0000},
+    {0x0054, 0x0326, 0x0000}, {0x0074, 0x0326, 0x0000}, {0x021C, 0x0000, 0x0000},
+    {0x021D, 0x0000, 0x0000}, {0x0048, 0x030C, 0x0000}, {0x0068, 0x030C, 0x0000},
+    {0x0220, 0x0000, 0x0000}, {0x0221, 0x0000, 0x0000}, {0x0222, 0x0000, 0x0000},
+    {0x0223, 0x0000, 0x0000}, {0x0224, 0x0000, 0x0000}, {0x0225, 0x0000, 0x0000},
+    {0x0041, 0x0307, 0x0000}, {0x0061, 0x0307, 0x0000}, {0x0045, 0x0327, 0x0000},
+    {0x0065, 0x0327, 0x0000}, {0x004F, 0x0308, 0x0304}, {0x006F, 0x0308, 0x0304},
+    {0x004F, 0x0303, 0x0304}, {0x006F, 0x0303, 0x0304}, {0x004F, 0x0307, 0x0000},
+    {0x006F, 0x0307, 0x0000}, {0x004F, 0x0307, 0x0304}, {0x006F, 0x0307, 0x0304},
+    {0x0059, 0x0304, 0x0000}, {0x0079, 0x0304, 0x0000}, {0x0234, 0x0000, 0x0000},
+    {0x0235, 0x0000, 0x0000}, {0x0236, 0x0000, 0x0000}, {0x0237, 0x0000, 0x0000},
+    {0x0238, 0x0000, 0x0000}, {0x0239, 0x0000, 0x0000}, {0x023A, 0x0000, 0x0000},
+    {0x023B, 0x0000, 0x0000}, {0x023C, 0x0000, 0x0000}, {0x023D, 0x0000, 0x0000},
+    {0x023E, 0x0000, 0x0000}, {0x023F, 0x0000, 0x0000}, {0x0240, 0x0000, 0x0000},
+    {0x0241, 0x0000, 0x0000}, {0x0242, 0x0000, 0x0000}, {0x0243, 0x0000, 0x0000},
+    {0x0244, 0x0000, 0x0000}, {0x0245, 0x0000, 0x0000}, {0x0246, 0x0000, 0x0000},
+    {0x0247, 0x0000, 0x0000}, {0x0248, 0x0000, 0x0000}, {0x0249, 0x0000, 0x0000},
+    {0x024A, 0x0000, 0x0000}, {0x024B, 0x0000, 0x0000}, {0x024C, 0x0000, 0x0000},
+    {0x024D, 0x0000, 0x0000}, {0x024E, 0x0000, 0x0000}, {0x024F, 0x0000, 0x0000},
+};
+
+static const uint16_t nfkd_latin_ext_additional[256][3] = {
+    {0x0041, 0x0325, 0x0000}, {0x0061, 0x0325, 0x0000}, {0x0042, 0x0307, 0x0000},
+    {0x0062, 0x0307, 0x0000}, {0x0042, 0x0323, 0x0000}, {0x0062, 0x0323, 0x0000},
+    {0x0042, 0x0331, 0x0000}, {0x0062, 0x0331, 0x0000}, {0x0043, 0x0327, 0x0301},
+    {0x0063, 0x0327, 0x0301}, {0x0044, 0x0307, 0x0000}, {0x0064, 0x0307, 0x0000},
+    {0x0044, 0x0323, 0x0000}, {0x0064, 0x0323, 0x0000}, {0x0044, 0x0331, 0x0000},
+    {0x0064, 0x0331, 0x0000}, {0x0044, 0x0327, 0x0000}, {0x0064, 0x0327, 0x0000},
+    {0x0044, 0x032D, 0x0000}, {0x0064, 0x032D, 0x0000}, {0x0045, 0x0304, 0x0300},
+    {0x0065, 0x0304, 0x0300}, {0x0045, 0x0304, 0x0301}, {0x0065, 0x0304, 0x0301},
+    {0x0045, 0x032D, 0x0000}, {0x0065, 0x032D, 0x0000}, {0x0045, 0x0330, 0x0000},
+    {0x0065, 0x0330, 0x0000}, {0x0045, 0x0327, 0x0306}, {0x0065, 0x0327, 0x0306},
+    {0x0046, 0x0307, 0x0000}, {0x0066, 0x0307, 0x0000}, {0x0047, 0x0304, 0x0000},
+    {0x0067, 0x0304, 0x0000}, {0x0048, 0x0307, 0x0000}, {0x0068, 0x0307, 0x0000},
+    {0x0048, 0x0323, 0x0000}, {0x0068, 0x0323, 0x0000}, {0x0048, 0x0308, 0x0000},
+    {0x0068, 0x0308, 0x0000}, {0x0048, 0x0327, 0x0000}, {0x0068, 0x0327, 0x0000},
+    {0x0048, 0x032E, 0x0000}, {0x0068, 0x032E, 0x0000}, {0x0049, 0x0330, 0x0000},
+    {0x0069, 0x0330, 0x0000}, {0x0049, 0x0308, 0x0301}, {0x0069, 0x0308, 0x0301},
+    {0x004B, 0x0301, 0x0000}, {0x006B, 0x0301, 0x0000}, {0x004B, 0x0323, 0x0000},
+    {0x006B, 0x0323, 0x0000}, {0x004B, 0x0331, 0x0000}, {0x006B, 0x0331, 0x0000},
+    {0x004C, 0x0323, 0x0000}, {0x006C, 0x0323, 0x0000}, {0x004C, 0x0323, 0x0304},
+    {0x006C, 0x0323, 0x0304}, {0x004C, 0x0331, 0x0000}, {0x006C, 0x0331, 0x0000},
+    {0x004C, 0x032D, 0x0000}, {0x006C, 0x032D, 0x0000}, {0x004D, 0x0301, 0x0000},
+    {0x006D, 0x0301, 0x0000}, {0x004D, 0x0307, 0x0000}, {0x006D, 0x0307, 0x0000},
+    {0x004D, 0x0323, 0x0000}, {0x006D, 0x0323, 0x0000}, {0x004E, 0x0307, 0x0000},
+    {0x006E, 0x0307, 0x0000}, {0x004E, 0x0323, 0x0000}, {0x006E, 0x0323, 0x0000},
+    {0x004E, 0x0331, 0x0000}, {0x006E, 0x0331, 0x0000}, {0x004E, 0x032D, 0x0000},
+    {0x006E, 0x032D, 0x0000}, {0x004F, 0x0303, 0x0301}, {0x006F, 0x0303, 0x0301},
+    {0x004F, 0x0303, 0x0308}, {0x006F, 0x0303, 0x0308}, {0x004F, 0x0304, 0x0300},
+    {0x006F, 0x0304, 0x0300}, {0x004F, 0x0304, 0x0301}, {0x006F, 0x0304, 0x0301},
+    {0x0050, 0x0301, 0x0000}, {0x0070, 0x0301, 0x0000}, {0x0050, 0x0307, 0x0000},
+    {0x0070, 0x0307, 0x0000}, {0x0052, 0x0307, 0x0000}, {0x0072, 0x0307, 0x0000},
+    {0x0052, 0x0323, 0x0000}, {0x0072, 0x0323, 0x0000}, {0x0052, 0x0323, 0x0304},
+    {0x0072, 0x0323, 0x0304}, {0x0052, 0x0331, 0x0000}, {0x0072, 0x0331, 0x0000},
+    {0x0053, 0x0307, 0x0000}, {0x0073, 0x0307, 0x0000}, {0x0053, 0x0323, 0x0000},
+    {0x0073, 0x0323, 0x0000}, {0x0053, 0x0301, 0x0307}, {0x0073, 0x0301, 0x0307},
+    {0x0053, 0x030C, 0x0307}, {0x0073, 0x030C, 0x0307}, {0x0053, 0x0323, 0x0307},
+    {0x0073, 0x0323, 0x0307}, {0x0054, 0x0307, 0x0000}, {0x0074, 0x0307, 0x0000},
+    {0x0054, 0x0323, 0x0000}, {0x0074, 0x0323, 0x0000}, {0x0054, 0x0331, 0x0000},
+    {0x0074, 0x0331, 0x0000}, {0x0054, 0x032D, 0x0000}, {0x0074, 0x032D, 0x0000},
+    {0x0055, 0x0324, 0x0000}, {0x0075, 0x0324, 0x0000}, {0x0055, 0x0330, 0x0000},
+    {0x0075, 0x0330, 0x0000}, {0x0055, 0x032D, 0x0000}, {0x0075, 0x032D, 0x0000},
+    {0x0055, 0x0303, 0x0301}, {0x0075, 0x0303, 0x0301}, {0x0055, 0x0304, 0x0308},
+    {0x0075, 0x0304, 0x0308}, {0x0056, 0x0303, 0x0000}, {0x0076, 0x0303, 0x0000},
+    {0x0056, 0x0323, 0x0000}, {0x0076, 0x0323, 0x0000}, {0x0057, 0x0300, 0x0000},
+    {0x0077, 0x0300, 0x0000}, {0x0057, 0x0301, 0x0000}, {0x0077, 0x0301, 0x0000},
+    {0x0057, 0x0308, 0x0000}, {0x0077, 0x0308, 0x0000}, {0x0057, 0x0307, 0x0000},
+    {0x0077, 0x0307, 0x0000}, {0x0057, 0x0323, 0x0000}, {0x0077, 0x0323, 0x0000},
+    {0x0058, 0x0307, 0x0000}, {0x0078, 0x0307, 0x0000}, {0x0058, 0x0308, 0x0000},
+    {0x0078, 0x0308, 0x0000}, {0x0059, 0x0307, 0x0000}, {0x0079, 0x0307, 0x0000},
+    {0x005A, 0x0302, 0x0000}, {0x007A, 0x0302, 0x0000}, {0x005A, 0x0323, 0x0000},
+    {0x007A, 0x0323, 0x0000}, {0x005A, 0x0331, 0x0000}, {0x007A, 0x0331, 0x0000},
+    {0x0068, 0x0331, 0x0000}, {0x0074, 0x0308, 0x0000}, {0x0077, 0x030A, 0x0000},
+    {0x0079, 0x030A, 0x0000}, {0x0061, 0x02BE, 0x0000}, {0x0073, 0x0307, 0x0000},
+    {0x1E9C, 0x0000, 0x0000}, {0x1E9D, 0x0000, 0x0000}, {0x1E9E, 0x0000, 0x0000},
+    {0x1E9F, 0x0000, 0x0000}, {0x0041, 0x0323, 0x0000}, {0x0061, 0x0323, 0x0000},
+    {0x0041, 0x0309, 0x0000}, {0x0061, 0x0309, 0x0000}, {0x0041, 0x0302, 0x0301},
+    {0x0061, 0x0302, 0x0301}, {0x0041, 0x0302, 0x0300}, {0x0061, 0x0302, 0x0300},
+    {0x0041, 0x0302, 0x0309}, {0x0061, 0x0302, 0x0309}, {0x0041, 0x0302, 0x0303},
+    {0x0061, 0x0302, 0x0303}, {0x0041, 0x0323, 0x0302}, {0x0061, 0x0323, 0x0302},
+    {0x0041, 0x0306, 0x0301}, {0x0061, 0x0306, 0x0301}, {0x0041, 0x0306, 0x0300},
+    {0x0061, 0x0306, 0x0300}, {0x0041, 0x0306, 0x0309}, {0x0061, 0x0306, 0x0309},
+    {0x0041, 0x0306, 0x0303}, {0x0061, 0x0306, 0x0303}, {0x0041, 0x0323, 0x0306},
+    {0x0061, 0x0323, 0x0306}, {0x0045, 0x0323, 0x0000}, {0x0065, 0x0323, 0x0000},
+    {0x0045, 0x0309, 0x0000}, {0x0065, 0x0309, 0x0000}, {0x0045, 0x0303, 0x0000},
+    {0x0065, 0x0303, 0x0000}, {0x0045, 0x0302, 0x0301}, {0x0065, 0x0302, 0x0301},
+    {0x0045, 0x0302, 0x0300}, {0x0065, 0x0302, 0x0300}, {0x0045, 0x0302, 0x0309},
+    {0x0065, 0x0302, 0x0309}, {0x0045, 0x0302, 0x0303}, {0x0065, 0x0302, 0x0303},
+    {0x0045, 0x0323, 0x0302}, {0x0065, 0x0323, 0x0302}, {0x0049, 0x0309, 0x0000},
+    {0x0069, 0x0309, 0x0000}, {0x0049, 0x0323, 0x0000}, {0x0069, 0x0323, 0x0000},
+    {0x004F, 0x0323, 0x0000}, {0x006F, 0x0323, 0x0000}, {0x004F, 0x0309, 0x0000},
+    {0x006F, 0x0309, 0x0000}, {0x004F, 0x0302, 0x0301}, {0x006F, 0x0302, 0x0301},
+    {0x004F, 0x0302, 0x0300}, {0x006F, 0x0302, 0x0300}, {0x004F, 0x0302, 0x0309},
+    {0x006F, 0x0302, 0x0309}, {0x004F, 0x0302, 0x0303}, {0x006F, 0x0302, 0x0303},
+    {0x004F, 0x0323, 0x0302}, {0x006F, 0x0323, 0x0302}, {0x004F, 0x031B, 0x0301},
+    {0x006F, 0x031B, 0x0301}, {0x004F, 0x031B, 0x0300}, {0x006F, 0x031B, 0x0300},
+    {0x004F, 0x031B, 0x0309}, {0x006F, 0x031B, 0x0309}, {0x004F, 0x031B, 0x0303},
+    {0x006F, 0x031B, 0x0303}, {0x004F, 0x031B, 0x0323}, {0x006F, 0x031B, 0x0323},
+    {0x0055, 0x0323, 0x0000}, {0x0075, 0x0323, 0x0000}, {0x0055, 0x0309, 0x0000},
+    {0x0075, 0x0309, 0x0000}, {0x0055, 0x031B, 0x0301}, {0x0075, 0x031B, 0x0301},
+    {0x0055, 0x031B, 0x0300}, {0x0075, 0x031B, 0x0300}, {0x0055, 0x031B, 0x0309},
+    {0x0075, 0x031B, 0x0309}, {0x0055, 0x031B, 0x0303}, {0x0075, 0x031B, 0x0303},
+    {0x0055, 0x031B, 0x0323}, {0x0075, 0x031B, 0x0323}, {0x0059, 0x0300, 0x0000},
+    {0x0079, 0x0300, 0x0000}, {0x0059, 0x0323, 0x0000}, {0x0079, 0x0323, 0x0000},
+    {0x0059, 0x0309, 0x0000}, {0x0079, 0x0309, 0x0000}, {0x0059, 0x0303, 0x0000},
+    {0x0079, 0x0303, 0x0000}, {0x1EFA, 0x0000, 0x0000}, {0x1EFB, 0x0000, 0x0000},
+    {0x1EFC, 0x0000, 0x0000}, {0x1EFD, 0x0000, 0x0000}, {0x1EFE, 0x0000, 0x0000},
+    {0x1EFF, 0x0000, 0x0000},
+};
+
+
+/*
+  Write the NFKD decomposition of c to out and return its length (1-3), or
+  return 0 if c is outside the ASCII and Latin ranges covered here, in which
+  case the caller has to fall back to a full normalizer.
+*/
+int jfish_nfkd_latin(JFISH_UNICODE c, JFISH_UNICODE out[3])
+{
+    const uint16_t *row;
+    int n;
+
+    if (c < 0x80) {
+        out[0] = c;
+        return 1;
+    } else if (c >= 0x00A0 && c < 0x0250) {
+        row = nfkd_latin1_ext[c - 0x00A0];
+    } else if (c >= 0x1E00 && c < 0x1F00) {
+        row = nfkd_latin_ext_additional[c - 0x1E00];
+    } else {
+        return 0;
+    }
+
+    for (n = 0; n < 3 && row[n]; n++) {
+        out[n] = row[n];
+    }
+    return n;
+}
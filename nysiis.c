@@ -1,85 +1,148 @@
 #include "jellyfish.h"
 #include <stdlib.h>
-#include <ctype.h>
 #include <string.h>
 
 #define ISVOWEL(a) ((a) == 'A' || (a) == 'E' || (a) == 'I' || (a) == 'O' || (a) == 'U')
 
-JFISH_UNICODE *nysiis(const JFISH_UNICODE *str, int len) {
-    JFISH_UNICODE c1, c2, c3;
-    JFISH_UNICODE *copy = NULL;
-    JFISH_UNICODE *code = NULL;
-    JFISH_UNICODE *p, *cp;
+/*
+  NYSIIS without copying the input.
 
-    copy = safe_malloc((len+1), sizeof(JFISH_UNICODE));
-    if (!copy) {
-        return NULL;
-    }
-    memcpy(copy, str, (len+1) * sizeof(JFISH_UNICODE));
+  Steps 1 and 2 only ever rewrite the first three and the last two
+  characters, so the rewritten characters are kept in a small window and
+  all others are read (and upper cased) straight from str by nysiis_at().
+  Step 2 ends the name with a space, which stops the scan, so it just
+  shortens the input by one.  Steps 6, 7 and 9 only look at the last two
+  characters of the code, which are kept in locals, so characters that do
+  not fit in out are counted but never stored.
 
-    if (!*copy) {
-        free(copy);
-        return calloc(1, sizeof(JFISH_UNICODE));
-    }
+  Upper casing is ASCII only, which is what toupper() does with these
+  values in the C and UTF-8 locales.
+*/
 
-    code = calloc(len + 1, sizeof(JFISH_UNICODE));
-    if (!code) {
-        free(copy);
-        return NULL;
+#define UPPER(c) ((c) >= 'a' && (c) <= 'z' ? (c) - ('a' - 'A') : (c))
+
+struct nysiis_input {
+    const JFISH_UNICODE *str;
+    size_t len;
+    JFISH_UNICODE head[3];   /* characters 0..2 after step 1 */
+    size_t tail;             /* character rewritten by step 2, 0 if none */
+    JFISH_UNICODE tail_char;
+};
+
+
+static JFISH_UNICODE nysiis_at(const struct nysiis_input *in, size_t i)
+{
+    if (i >= in->len) {
+        return 0;
+    }
+    if (i < 3) {
+        return in->head[i];
     }
+    if (i == in->tail) {
+        return in->tail_char;
+    }
+    return UPPER(in->str[i]);
+}
+
 
-    // Convert to upper case first
-    cp = p = copy;
-    while(*p) {
-        *(cp++) = toupper(*(p++));
+static void nysiis_set(struct nysiis_input *in, size_t i, JFISH_UNICODE c)
+{
+    if (i < 3) {
+        in->head[i] = c;
+    } else {
+        in->tail = i;
+        in->tail_char = c;
     }
+}
+
+
+/* append c to the code unconditionally */
+#define COMMIT(ch) do {                         \
+        if (n < limit) {                        \
+            out[n] = (ch);                      \
+        }                                       \
+        prev = last;                            \
+        last = (ch);                            \
+        n++;                                    \
+    } while (0)
+
+/* append c unless it repeats the last character (step 6) */
+#define PROPOSE(ch) do {                        \
+        JFISH_UNICODE ch_ = (ch);               \
+        if (ch_ != last) {                      \
+            COMMIT(ch_);                        \
+        }                                       \
+    } while (0)
+
+
+/*
+  Write the NYSIIS code of str into out, which holds out_cap characters,
+  and return the length of the code.  When max_code_len is non-zero the
+  code is cut to that many characters (6 in the original definition of
+  NYSIIS), otherwise it is never longer than the input.  Like
+  metaphone_into(), at most out_cap - 1 characters are written, always
+  followed by a 0, so a return value >= out_cap means out was too small.
+  str does not need to be NUL terminated, but the code stops at an
+  embedded NUL as nysiis() always has.
+*/
+size_t nysiis_into(const JFISH_UNICODE *str, int len, JFISH_UNICODE *out,
+                   size_t out_cap, size_t max_code_len)
+{
+    struct nysiis_input in;
+    JFISH_UNICODE c1, c2, c3, last = 0, prev = 0;
+    size_t limit = out_cap ? out_cap - 1 : 0;
+    size_t end, i, p, n = 0;
 
-    // Step 1
-    if (len >= 3 && copy[0] == 'M' && copy[1] == 'A' && copy[2] == 'C') {
-        copy[1] = 'C';
-    } else if (len >= 2 && copy[0] == 'K' && copy[1] == 'N') {
-        copy[0] = 'N';
-    } else if (len >= 1 && copy[0] == 'K') {
-        copy[0] = 'C';
-    } else if (len >= 2 && copy[0] == 'P' && (copy[1] == 'H' || copy[1] == 'F')) {
-        copy[0] = 'F';
-        copy[1] = 'F';
-    } else if (len >= 3 && copy[0] == 'S' && copy[1] == 'C' && copy[2] == 'H') {
-        copy[1] = 'S';
-        copy[2] = 'S';
+    for (end = 0; end < (size_t)len && str[end]; end++);
+
+    in.str = str;
+    in.len = end;
+    in.tail = 0;
+    in.tail_char = 0;
+    for (i = 0; i < 3; i++) {
+        in.head[i] = i < end ? UPPER(str[i]) : 0;
     }
 
-    // Step 2
-    if (len > 1) {
-        c1 = copy[len - 1];
-        if (c1 == 'E') {
-            c2 = copy[len - 2];
-            if (c2 == 'E' || c2 == 'I') {
-                copy[len - 1] = ' ';
-                copy[len - 2] = 'Y';
-            }
-        } else if (c1 == 'T') {
-            c2 = copy[len - 2];
-            if (c2 == 'D' || c2 == 'R' || c2 == 'N') {
-                copy[len - 1] = ' ';
-                copy[len - 2] = 'D';
+    if (end) {
+        // Step 1
+        if (end >= 3 && in.head[0] == 'M' && in.head[1] == 'A' && in.head[2] == 'C') {
+            in.head[1] = 'C';
+        } else if (end >= 2 && in.head[0] == 'K' && in.head[1] == 'N') {
+            in.head[0] = 'N';
+        } else if (in.head[0] == 'K') {
+            in.head[0] = 'C';
+        } else if (end >= 2 && in.head[0] == 'P' && (in.head[1] == 'H' || in.head[1] == 'F')) {
+            in.head[0] = 'F';
+            in.head[1] = 'F';
+        } else if (end >= 3 && in.head[0] == 'S' && in.head[1] == 'C' && in.head[2] == 'H') {
+            in.head[1] = 'S';
+            in.head[2] = 'S';
+        }
+
+        // Step 2 (only reaches the end of the name if there is no NUL in it)
+        if (end > 1 && end == (size_t)len) {
+            c1 = nysiis_at(&in, end - 1);
+            c2 = nysiis_at(&in, end - 2);
+            c3 = 0;
+            if (c1 == 'E' && (c2 == 'E' || c2 == 'I')) {
+                c3 = 'Y';
+            } else if (c1 == 'T' && (c2 == 'D' || c2 == 'R' || c2 == 'N')) {
+                c3 = 'D';
+            } else if (c1 == 'D' && (c2 == 'R' || c2 == 'N')) {
+                c3 = 'D';
             }
-        } else if (c1 == 'D') {
-            c2 = copy[len - 2];
-            if (c2 == 'R' || c2 == 'N') {
-                copy[len - 1] = ' ';
-                copy[len - 2] = 'D';
+            if (c3) {
+                nysiis_set(&in, end - 2, c3);
+                in.len = end - 1;
             }
         }
-    }
-
-    cp = code;
-    p = copy;
 
-    // Step 3
-    *(cp++) = *(p++);
+        // Step 3
+        COMMIT(in.head[0]);
+    }
 
-    while ((c1 = *p)) {
+    for (p = 1; p < in.len; p++) {
+        c1 = nysiis_at(&in, p);
         if (c1 == ' ') {
             break;
         }
@@ -87,107 +150,123 @@ JFISH_UNICODE *nysiis(const JFISH_UNICODE *str, int len) {
         // Step 5
         switch(c1) {
         case 'E':
-            if ((*(p + 1)) == 'V') {
-                *cp = 'A';
-                *(++cp) = 'F';
+            if (nysiis_at(&in, p + 1) == 'V') {
+                COMMIT('A');
+                PROPOSE('F');
                 ++p;
                 break;
             }
+            /* fall through */
         case 'A':
         case 'I':
         case 'O':
         case 'U':
-            *cp = 'A';
+            PROPOSE('A');
             break;
         case 'Q':
-            *cp = 'G';
+            PROPOSE('G');
             break;
         case 'Z':
-            *cp = 'S';
+            PROPOSE('S');
             break;
         case 'M':
-            *cp = 'N';
+            PROPOSE('N');
             break;
         case 'K':
-            if ((*(p + 1)) == 'N') {
-                *cp = 'N';
-            } else {
-                *cp = 'C';
-            }
+            PROPOSE(nysiis_at(&in, p + 1) == 'N' ? 'N' : 'C');
             break;
         case 'S':
-            if ((*(p + 1)) == 'C' && (*(p + 2)) == 'H') {
-                *(cp++) = 'S';
-                *(cp++) = 'S';
-                *cp = 'S';
+            if (nysiis_at(&in, p + 1) == 'C' && nysiis_at(&in, p + 2) == 'H') {
+                // SSS, the last of which always repeats
+                COMMIT('S');
+                COMMIT('S');
                 p += 2;
             } else {
-                *cp = 'S';
+                PROPOSE('S');
             }
             break;
         case 'P':
-            if ((*(p + 1)) == 'H') {
-                *cp = 'F';
-                *(++cp) = 'F';
+            if (nysiis_at(&in, p + 1) == 'H') {
+                // FF, the second of which always repeats
+                COMMIT('F');
                 p++;
             } else {
-                *cp = 'P';
+                PROPOSE('P');
             }
             break;
         case 'H':
-            c2 = (*(p + 1));
-            c3 = (*(p - 1));
+            c2 = nysiis_at(&in, p + 1);
+            c3 = nysiis_at(&in, p - 1);
             if (!ISVOWEL(c2) || !ISVOWEL(c3)) {
-                if ISVOWEL(c3) {
-                    *cp = 'A';
-                } else {
-                    *cp = c3;
-                }
+                PROPOSE(ISVOWEL(c3) ? 'A' : c3);
             } else {
-                *cp = 'H';
+                PROPOSE('H');
             }
             break;
         case 'W':
-            c2 = (*(p - 1));
-            if (ISVOWEL(c2)) {
-                *cp = c2;
-            } else {
-                *cp = 'W';
-            }
+            c2 = nysiis_at(&in, p - 1);
+            PROPOSE(ISVOWEL(c2) ? c2 : 'W');
             break;
         default:
-            *cp = (c1);
-        }
-
-        // Step 6
-        if (*cp != *(cp - 1)) {
-            cp++;
+            PROPOSE(c1);
         }
-
-        p++;
     }
 
-    *cp = '\0';
-
     // Step 7
-    // (cp-1 != code) checks are to make sure we don't remove the last char from code
-    c1 = *(cp - 1);
-    if (c1 == 'S' && (cp-1) != code) {
-        *(--cp) = '\0';
-    } else if (c1 == 'Y') {
-        if (*(cp - 2) == 'A') {
-            *(--cp) = '\0';
-            *(--cp) = 'Y';
+    // (n > 1 checks are to make sure we don't remove the last char from code)
+    if (last == 'S' && n > 1) {
+        n--;
+        last = prev;
+    } else if (last == 'Y' && prev == 'A' && n > 1) {
+        n--;
+        if (n - 1 < limit) {
+            out[n - 1] = 'Y';
         }
+        last = 'Y';
     }
 
     // There is no step 8!
 
     // Step 9
-    if (*(cp - 1) == 'A' && (cp-1) != code) {
-        *(cp - 1) = '\0';
+    if (last == 'A' && n > 1) {
+        n--;
+    }
+
+    if (max_code_len && n > max_code_len) {
+        n = max_code_len;
+    }
+    if (out_cap) {
+        out[MIN(n, limit)] = 0;
     }
+    return n;
+}
+
+
+JFISH_UNICODE *nysiis(const JFISH_UNICODE *str, int len)
+{
+    JFISH_UNICODE *code = safe_malloc((size_t)len + 1, sizeof(JFISH_UNICODE));
 
-    free(copy);
+    if (!code) {
+        return NULL;
+    }
+    nysiis_into(str, len, code, (size_t)len + 1, 0);
     return code;
 }
+
+
+/*
+  nysiis_into() for count strings, the code of strs[i] going to
+  out + i * out_cap.  Returns how many of the codes did not fit.
+*/
+int nysiis_batch(const JFISH_UNICODE *const *strs, const int *lens, int count,
+                 JFISH_UNICODE *out, size_t out_cap, size_t max_code_len)
+{
+    int i, truncated = 0;
+
+    for (i = 0; i < count; i++) {
+        if (nysiis_into(strs[i], lens[i], out + (size_t)i * out_cap, out_cap, max_code_len) >= out_cap) {
+            truncated++;
+        }
+    }
+    return truncated;
+}
@@ -0,0 +1,103 @@
+#include "jellyfish.h"
+
+/*
+  Minimal fork/join helper for the batch drivers.
+
+  jfish_parallel_run() calls fn(ctx, i, nthreads) for i in [0, nthreads) on
+  separate threads and waits for all of them; the worker decides which slice
+  of the input belongs to index i.  nthreads is capped at JFISH_MAX_THREADS,
+  so callers keeping per-thread state must clamp to it first.  Builds
+  defining JFISH_NO_THREADS (or platforms without pthreads or Win32
+  threads) run the workers one after another on the calling thread, which
+  gives the same results.
+*/
+
+#if defined(_WIN32)
+#include <windows.h>
+#define JFISH_WIN32_THREADS 1
+#elif !defined(JFISH_NO_THREADS)
+#include <pthread.h>
+#define JFISH_PTHREADS 1
+#endif
+
+struct parallel_job {
+    jfish_worker_fn fn;
+    void *ctx;
+    int index;
+    int nthreads;
+};
+
+#if defined(JFISH_WIN32_THREADS)
+static DWORD WINAPI parallel_trampoline(LPVOID arg)
+{
+    struct parallel_job *job = arg;
+    job->fn(job->ctx, job->index, job->nthreads);
+    return 0;
+}
+#elif defined(JFISH_PTHREADS)
+static void* parallel_trampoline(void *arg)
+{
+    struct parallel_job *job = arg;
+    job->fn(job->ctx, job->index, job->nthreads);
+    return NULL;
+}
+#endif
+
+
+void jfish_parallel_run(jfish_worker_fn fn, void *ctx, int nthreads)
+{
+    struct parallel_job jobs[JFISH_MAX_THREADS];
+    int i;
+#if defined(JFISH_WIN32_THREADS)
+    HANDLE threads[JFISH_MAX_THREADS];
+#elif defined(JFISH_PTHREADS)
+    pthread_t threads[JFISH_MAX_THREADS];
+    int started[JFISH_MAX_THREADS];
+#endif
+
+    if (nthreads < 1) {
+        nthreads = 1;
+    } else if (nthreads > JFISH_MAX_THREADS) {
+        nthreads = JFISH_MAX_THREADS;
+    }
+
+    for (i = 0; i < nthreads; i++) {
+        jobs[i].fn = fn;
+        jobs[i].ctx = ctx;
+        jobs[i].index = i;
+        jobs[i].nthreads = nthreads;
+    }
+
+    /* index 0 always runs on the calling thread; if a thread cannot be
+     * started its share runs here too */
+#if defined(JFISH_WIN32_THREADS)
+    for (i = 1; i < nthreads; i++) {
+        threads[i] = CreateThread(NULL, 0, parallel_trampoline, &jobs[i], 0, NULL);
+    }
+    fn(ctx, 0, nthreads);
+    for (i = 1; i < nthreads; i++) {
+        if (threads[i]) {
+            WaitForSingleObject(threads[i], INFINITE);
+            CloseHandle(threads[i]);
+        } else {
+            fn(ctx, i, nthreads);
+        }
+    }
+#elif defined(JFISH_PTHREADS)
+    for (i = 1; i < nthreads; i++) {
+        started[i] = !pthread_create(&threads[i], NULL, parallel_trampoline, &jobs[i]);
+    }
+    fn(ctx, 0, nthreads);
+    for (i = 1; i < nthreads; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            fn(ctx, i, nthreads);
+        }
+    }
+#else
+    for (i = 0; i < nthreads; i++) {
+        fn(ctx, i, nthreads);
+    }
+#endif
+}
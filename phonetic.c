@@ -0,0 +1,190 @@
+#include "jellyfish.h"
+#include <string.h>
+#include <stdlib.h>
+
+/*
+  All phonetic keys of a string in one pass.
+
+  The separate encoders each prepare their own input: soundex and metaphone
+  want the NFKD form as UTF-8 and match_rating_codex wants the string in
+  upper case; nysiis reads the string as it is.  phonetic_keys() builds
+  each of those once, in stack buffers for strings of up to PHONETIC_STACK
+  characters, and writes the requested keys into a fixed-size struct.
+
+  Decomposition uses the Latin table in nfkd.c; characters outside it are
+  passed through unchanged.  Upper casing is the simple per-character
+  mapping.  Keys longer than JFISH_PHONETIC_KEY_MAX - 1 characters are cut
+  short and flagged in out->truncated.
+*/
+
+#define PHONETIC_STACK 64
+
+
+/* Write the NFKD form of str as UTF-8 into out, which must hold
+ * 12 * len + 1 bytes. */
+static void phonetic_normalize(const JFISH_UNICODE *str, int len, char *out)
+{
+    JFISH_UNICODE decomposed[3];
+    int i, k, n;
+
+    for (i = 0; i < len; i++) {
+        n = jfish_nfkd_latin(str[i], decomposed);
+        if (!n) {
+            decomposed[0] = str[i];
+            n = 1;
+        }
+        for (k = 0; k < n; k++) {
+            out += jfish_utf8_encode(decomposed[k], out);
+        }
+    }
+    *out = '\0';
+}
+
+
+/*
+  Compute the keys selected by flags (JFISH_PHONETIC_* bits) for str into
+  out.  Keys that were not requested are left empty.  Returns 0, or -1 on
+  allocation failure.
+*/
+int phonetic_keys(const JFISH_UNICODE *str, int len, int flags, struct jfish_phonetic_keys *out)
+{
+    JFISH_UNICODE wide_stack[PHONETIC_STACK + 1];
+    char utf8_stack[12 * PHONETIC_STACK + 1];
+    JFISH_UNICODE *wide = wide_stack;
+    char *utf8 = utf8_stack;
+    int i, ret = -1;
+
+    out->flags = flags;
+    out->truncated = 0;
+    out->soundex[0] = '\0';
+    out->metaphone[0] = '\0';
+    out->nysiis[0] = 0;
+    out->match_rating_codex[0] = 0;
+
+    if (len > PHONETIC_STACK) {
+        wide = safe_malloc((size_t)len + 1, sizeof(JFISH_UNICODE));
+        utf8 = safe_malloc(12 * (size_t)len + 1, 1);
+        if (!wide || !utf8) {
+            goto cleanup;
+        }
+    }
+
+    if (flags & (JFISH_PHONETIC_SOUNDEX | JFISH_PHONETIC_METAPHONE)) {
+        phonetic_normalize(str, len, utf8);
+        if (flags & JFISH_PHONETIC_SOUNDEX) {
+            soundex_into(utf8, out->soundex);
+        }
+        if (flags & JFISH_PHONETIC_METAPHONE) {
+            if (metaphone_into(utf8, out->metaphone, JFISH_PHONETIC_KEY_MAX) >= JFISH_PHONETIC_KEY_MAX) {
+                out->truncated |= JFISH_PHONETIC_METAPHONE;
+            }
+        }
+    }
+
+    if (flags & JFISH_PHONETIC_NYSIIS) {
+        if (nysiis_into(str, len, out->nysiis, JFISH_PHONETIC_KEY_MAX, 0) >= JFISH_PHONETIC_KEY_MAX) {
+            out->truncated |= JFISH_PHONETIC_NYSIIS;
+        }
+    }
+
+    if (flags & JFISH_PHONETIC_MATCH_RATING) {
+        for (i = 0; i < len; i++) {
+            wide[i] = TOUPPER(str[i]);
+        }
+        match_rating_codex_into(wide, len, out->match_rating_codex);
+    }
+    ret = 0;
+
+ cleanup:
+    if (wide != wide_stack) {
+        free(wide);
+    }
+    if (utf8 != utf8_stack) {
+        free(utf8);
+    }
+    return ret;
+}
+
+
+/* The full metaphone code of str in a new buffer, or NULL on failed
+ * malloc. */
+static char* phonetic_full_metaphone(const JFISH_UNICODE *str, int len)
+{
+    char *utf8, *code;
+    size_t size;
+
+    utf8 = safe_malloc(12 * (size_t)len + 1, 1);
+    if (!utf8) {
+        return NULL;
+    }
+    phonetic_normalize(str, len, utf8);
+    size = metaphone_into(utf8, NULL, 0) + 1;
+    code = malloc(size);
+    if (code) {
+        metaphone_into(utf8, code, size);
+    }
+    free(utf8);
+    return code;
+}
+
+
+/* The full nysiis code of str in a new buffer, or NULL on failed malloc. */
+static JFISH_UNICODE* phonetic_full_nysiis(const JFISH_UNICODE *str, int len)
+{
+    JFISH_UNICODE *code;
+    size_t size = nysiis_into(str, len, NULL, 0, 0) + 1;
+
+    code = safe_malloc(size, sizeof(JFISH_UNICODE));
+    if (code) {
+        nysiis_into(str, len, code, size, 0);
+    }
+    return code;
+}
+
+
+/*
+  Whether s1 and s2 have the same metaphone or nysiis code (flag is
+  JFISH_PHONETIC_METAPHONE or JFISH_PHONETIC_NYSIIS), compared at full
+  length, for when phonetic_keys() flagged either key as truncated.
+  Returns 1 or 0, or -1 on allocation failure.
+*/
+int phonetic_key_equal(const JFISH_UNICODE *s1, int len1, const JFISH_UNICODE *s2, int len2,
+                       int flag)
+{
+    void *code1, *code2;
+    const JFISH_UNICODE *w1, *w2;
+    int ret = -1;
+
+    if (flag == JFISH_PHONETIC_METAPHONE) {
+        code1 = phonetic_full_metaphone(s1, len1);
+        code2 = code1 ? phonetic_full_metaphone(s2, len2) : NULL;
+        if (code2) {
+            ret = !strcmp(code1, code2);
+        }
+    } else {
+        code1 = phonetic_full_nysiis(s1, len1);
+        code2 = code1 ? phonetic_full_nysiis(s2, len2) : NULL;
+        if (code2) {
+            for (w1 = code1, w2 = code2; *w1 && *w1 == *w2; w1++, w2++);
+            ret = *w1 == *w2;
+        }
+    }
+    free(code1);
+    free(code2);
+    return ret;
+}
+
+
+/* phonetic_keys() for count strings, writing out[0 .. count). */
+int phonetic_keys_batch(const JFISH_UNICODE *const *strs, const int *lens, int count,
+                        int flags, struct jfish_phonetic_keys *out)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (phonetic_keys(strs[i], lens[i], flags, &out[i]) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
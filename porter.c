@@ -0,0 +1,392 @@
+#include "jellyfish.h"
+#include <stdlib.h>
+
+/*
+  The Porter stemming algorithm, following Martin Porter's reference ANSI C
+  implementation (including its two departures from the published paper,
+  -bli -> -ble and -logi -> -log, and leaving words of up to two letters
+  alone).
+
+  stem() works in place on b[0..k] and returns the new end offset, so it
+  never allocates; struct stemmer only carries the buffer and the two
+  offsets between the steps.  The suffix lists of steps 2 to 4 are tables:
+  each rule names the character the step dispatches on, the suffix and
+  what replaces it, and the first rule whose suffix matches decides the
+  step, as the switch statements of the reference implementation do.
+
+  Input is expected in lower case; characters outside a-z are consonants.
+*/
+
+struct stemmer {
+    JFISH_UNICODE *b;   /* buffer for the word being stemmed */
+    int k;              /* offset of the end of the word */
+    int j;              /* a general offset into the word */
+};
+
+struct porter_rule {
+    JFISH_UNICODE key;          /* b[k - 1] (steps 2 and 4) or b[k] (step 3) */
+    char after_st;              /* step 4 only: the stem must end in s or t */
+    int length;
+    const char *suffix;
+    int replacement_length;
+    const char *replacement;
+};
+
+#define RULE(key, suffix, replacement) \
+    {key, 0, sizeof(suffix) - 1, suffix, sizeof(replacement) - 1, replacement}
+
+static const struct porter_rule step2_rules[] = {
+    RULE('a', "ational", "ate"),
+    RULE('a', "tional", "tion"),
+    RULE('c', "enci", "ence"),
+    RULE('c', "anci", "ance"),
+    RULE('e', "izer", "ize"),
+    RULE('l', "bli", "ble"),        /* the paper has abli -> able */
+    RULE('l', "alli", "al"),
+    RULE('l', "entli", "ent"),
+    RULE('l', "eli", "e"),
+    RULE('l', "ousli", "ous"),
+    RULE('o', "ization", "ize"),
+    RULE('o', "ation", "ate"),
+    RULE('o', "ator", "ate"),
+    RULE('s', "alism", "al"),
+    RULE('s', "iveness", "ive"),
+    RULE('s', "fulness", "ful"),
+    RULE('s', "ousness", "ous"),
+    RULE('t', "aliti", "al"),
+    RULE('t', "iviti", "ive"),
+    RULE('t', "biliti", "ble"),
+    RULE('g', "logi", "log"),       /* not in the paper */
+    {0, 0, 0, NULL, 0, NULL}
+};
+
+static const struct porter_rule step3_rules[] = {
+    RULE('e', "icate", "ic"),
+    RULE('e', "ative", ""),
+    RULE('e', "alize", "al"),
+    RULE('i', "iciti", "ic"),
+    RULE('l', "ical", "ic"),
+    RULE('l', "ful", ""),
+    RULE('s', "ness", ""),
+    {0, 0, 0, NULL, 0, NULL}
+};
+
+static const struct porter_rule step4_rules[] = {
+    RULE('a', "al", ""),
+    RULE('c', "ance", ""),
+    RULE('c', "ence", ""),
+    RULE('e', "er", ""),
+    RULE('i', "ic", ""),
+    RULE('l', "able", ""),
+    RULE('l', "ible", ""),
+    RULE('n', "ant", ""),
+    RULE('n', "ement", ""),
+    RULE('n', "ment", ""),
+    RULE('n', "ent", ""),
+    {'o', 1, 3, "ion", 0, ""},
+    RULE('o', "ou", ""),            /* takes care of -ous */
+    RULE('s', "ism", ""),
+    RULE('t', "ate", ""),
+    RULE('t', "iti", ""),
+    RULE('u', "ous", ""),
+    RULE('v', "ive", ""),
+    RULE('z', "ize", ""),
+    {0, 0, 0, NULL, 0, NULL}
+};
+
+
+/* cons(z, i) is TRUE <=> b[i] is a consonant. */
+static int cons(const struct stemmer *z, int i)
+{
+    switch (z->b[i]) {
+    case 'a': case 'e': case 'i': case 'o': case 'u':
+        return 0;
+    case 'y':
+        return i == 0 ? 1 : !cons(z, i - 1);
+    default:
+        return 1;
+    }
+}
+
+
+/*
+  m(z) measures the number of consonant sequences between 0 and j.  If c is
+  a consonant sequence and v a vowel sequence, and <..> indicates arbitrary
+  presence,
+
+     <c><v>       gives 0
+     <c>vc<v>     gives 1
+     <c>vcvc<v>   gives 2
+     <c>vcvcvc<v> gives 3
+     ....
+*/
+static int m(const struct stemmer *z)
+{
+    int n = 0, i = 0, j = z->j;
+
+    for (;;) {
+        if (i > j) return n;
+        if (!cons(z, i)) break;
+        i++;
+    }
+    i++;
+    for (;;) {
+        for (;;) {
+            if (i > j) return n;
+            if (cons(z, i)) break;
+            i++;
+        }
+        i++;
+        n++;
+        for (;;) {
+            if (i > j) return n;
+            if (!cons(z, i)) break;
+            i++;
+        }
+        i++;
+    }
+}
+
+
+/* vowelinstem(z) is TRUE <=> 0,...j contains a vowel */
+static int vowelinstem(const struct stemmer *z)
+{
+    int i;
+
+    for (i = 0; i <= z->j; i++) {
+        if (!cons(z, i)) return 1;
+    }
+    return 0;
+}
+
+
+/* doublec(z, j) is TRUE <=> j,(j-1) contain a double consonant. */
+static int doublec(const struct stemmer *z, int j)
+{
+    if (j < 1) return 0;
+    if (z->b[j] != z->b[j - 1]) return 0;
+    return cons(z, j);
+}
+
+
+/*
+  cvc(z, i) is TRUE <=> i-2,i-1,i has the form consonant - vowel - consonant
+  and also if the second c is not w,x or y.  This is used when trying to
+  restore an e at the end of a short word, e.g.
+
+     cav(e), lov(e), hop(e), crim(e), but
+     snow, box, tray.
+*/
+static int cvc(const struct stemmer *z, int i)
+{
+    JFISH_UNICODE ch;
+
+    if (i < 2 || !cons(z, i) || cons(z, i - 1) || !cons(z, i - 2)) return 0;
+    ch = z->b[i];
+    if (ch == 'w' || ch == 'x' || ch == 'y') return 0;
+    return 1;
+}
+
+
+/* ends(z, s) is TRUE <=> 0,...k ends with the string s; j is set to just
+ * before the suffix. */
+static int ends(struct stemmer *z, const char *s, int length)
+{
+    const JFISH_UNICODE *b = z->b + z->k - length + 1;
+    int i;
+
+    if (length > z->k + 1) return 0;
+    for (i = length - 1; i >= 0; i--) {
+        if (b[i] != (unsigned char)s[i]) return 0;
+    }
+    z->j = z->k - length;
+    return 1;
+}
+
+
+/* setto(z, s) sets (j+1),...k to the characters in the string s, readjusting
+ * k. */
+static void setto(struct stemmer *z, const char *s, int length)
+{
+    int i;
+
+    for (i = 0; i < length; i++) {
+        z->b[z->j + 1 + i] = (unsigned char)s[i];
+    }
+    z->k = z->j + length;
+}
+
+
+/* r(z, s) is used further down. */
+static void r(struct stemmer *z, const char *s, int length)
+{
+    if (m(z) > 0) setto(z, s, length);
+}
+
+
+/* The first rule for key whose suffix ends the word, with j set before it. */
+static const struct porter_rule* match_rule(struct stemmer *z, const struct porter_rule *rule,
+                                            JFISH_UNICODE key)
+{
+    for (; rule->suffix; rule++) {
+        if (rule->key != key || !ends(z, rule->suffix, rule->length)) {
+            continue;
+        }
+        if (rule->after_st && (z->j < 0 || (z->b[z->j] != 's' && z->b[z->j] != 't'))) {
+            continue;
+        }
+        return rule;
+    }
+    return NULL;
+}
+
+
+/*
+  step1ab(z) gets rid of plurals and -ed or -ing. e.g.
+
+      caresses  ->  caress
+      ponies    ->  poni
+      ties      ->  ti
+      caress    ->  caress
+      cats      ->  cat
+
+      feed      ->  feed
+      agreed    ->  agree
+      disabled  ->  disable
+
+      matting   ->  mat
+      mating    ->  mate
+      meeting   ->  meet
+      milling   ->  mill
+      messing   ->  mess
+
+      meetings  ->  meet
+*/
+static void step1ab(struct stemmer *z)
+{
+    JFISH_UNICODE *b = z->b;
+    JFISH_UNICODE ch;
+
+    if (b[z->k] == 's') {
+        if (ends(z, "sses", 4)) z->k -= 2;
+        else if (ends(z, "ies", 3)) setto(z, "i", 1);
+        else if (b[z->k - 1] != 's') z->k--;
+    }
+    if (ends(z, "eed", 3)) {
+        if (m(z) > 0) z->k--;
+    } else if ((ends(z, "ed", 2) || ends(z, "ing", 3)) && vowelinstem(z)) {
+        z->k = z->j;
+        if (ends(z, "at", 2)) setto(z, "ate", 3);
+        else if (ends(z, "bl", 2)) setto(z, "ble", 3);
+        else if (ends(z, "iz", 2)) setto(z, "ize", 3);
+        else if (doublec(z, z->k)) {
+            z->k--;
+            ch = b[z->k];
+            if (ch == 'l' || ch == 's' || ch == 'z') z->k++;
+        }
+        else if (m(z) == 1 && cvc(z, z->k)) setto(z, "e", 1);
+    }
+}
+
+
+/* step1c(z) turns terminal y to i when there is another vowel in the stem. */
+static void step1c(struct stemmer *z)
+{
+    if (ends(z, "y", 1) && vowelinstem(z)) z->b[z->k] = 'i';
+}
+
+
+/* step2(z) maps double suffices to single ones, so -ization ( = -ize plus
+ * -ation) maps to -ize etc.  Note that the string before the suffix must
+ * give m(z) > 0. */
+static void step2(struct stemmer *z)
+{
+    const struct porter_rule *rule = match_rule(z, step2_rules, z->b[z->k - 1]);
+
+    if (rule) r(z, rule->replacement, rule->replacement_length);
+}
+
+
+/* step3(z) deals with -ic-, -full, -ness etc. similar strategy to step2. */
+static void step3(struct stemmer *z)
+{
+    const struct porter_rule *rule = match_rule(z, step3_rules, z->b[z->k]);
+
+    if (rule) r(z, rule->replacement, rule->replacement_length);
+}
+
+
+/* step4(z) takes off -ant, -ence etc., in context <c>vcvc<v>. */
+static void step4(struct stemmer *z)
+{
+    if (match_rule(z, step4_rules, z->b[z->k - 1]) && m(z) > 1) z->k = z->j;
+}
+
+
+/* step5(z) removes a final -e if m(z) > 1, and changes -ll to -l if
+ * m(z) > 1. */
+static void step5(struct stemmer *z)
+{
+    int a;
+
+    z->j = z->k;
+    if (z->b[z->k] == 'e') {
+        a = m(z);
+        if (a > 1 || (a == 1 && !cvc(z, z->k - 1))) z->k--;
+    }
+    if (z->b[z->k] == 'l' && doublec(z, z->k) && m(z) > 1) z->k--;
+}
+
+
+struct stemmer* create_stemmer(void)
+{
+    return malloc(sizeof(struct stemmer));
+}
+
+
+void free_stemmer(struct stemmer *z)
+{
+    free(z);
+}
+
+
+/*
+  In stem(z, b, k), b is a buffer holding a word to be stemmed.  The letters
+  are in b[0], b[1] ... ending at b[k].  The stemmer adjusts the characters
+  b[0] ... b[k] and returns the new end-point of the string, k'.  Stemming
+  never increases word length, so 0 <= k' <= k.
+*/
+int stem(struct stemmer *z, JFISH_UNICODE *b, int k)
+{
+    if (k <= 1) return k;   /* the paper stems these too */
+
+    z->b = b;
+    z->k = k;
+
+    step1ab(z);
+    if (z->k > 0) {
+        step1c(z);
+        step2(z);
+        step3(z);
+        step4(z);
+        step5(z);
+    }
+    return z->k;
+}
+
+
+/*
+  Stem the count tokens of str (as found by jfish_tokenize()) in place,
+  shortening each token's len to its stem.  The characters a stem no
+  longer covers are left as they were, so token starts stay valid.
+*/
+void stem_tokens(struct stemmer *z, JFISH_UNICODE *str, struct jfish_token *tokens, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (tokens[i].len > 0) {
+            tokens[i].len = stem(z, str + tokens[i].start, tokens[i].len - 1) + 1;
+        }
+    }
+}
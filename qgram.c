@@ -0,0 +1,412 @@
+#include "jellyfish.h"
+#include <string.h>
+#include <stdlib.h>
+
+/*
+  q-gram inverted index with count filtering.
+
+  Every string in the collection is cut into its len - q + 1 overlapping
+  q-grams, each packed into a 64-bit hash.  Postings are stored CSR style:
+  a sorted array of distinct gram hashes, an offset table and a flat array
+  of (string id, occurrences) entries, so a gram lookup is a binary search
+  followed by a contiguous scan.
+
+  Searching uses the q-gram lemma: if edit_distance(s, t) <= k then s and t
+  share at least max(|s|, |t|) - q + 1 - k * q q-grams (counted as a
+  multiset).  The postings of the query grams are scanned into a counter
+  table (ScanCount) and only ids reaching that threshold, and within k of
+  the query length, are verified with levenshtein_distance().  Lengths for
+  which the lemma gives no bound are handled by scanning the ids of that
+  length directly, so results are exact.
+*/
+
+struct qgram_posting {
+    uint32_t id;
+    uint32_t count;
+};
+
+struct qgram_index {
+    int q;
+    int count;
+    JFISH_UNICODE *pool;
+    size_t *offsets;        /* count + 1 entries into pool */
+    int *by_length;         /* ids sorted by length */
+    size_t *length_start;   /* max_len + 2 entries into by_length */
+    int max_len;
+    size_t ngrams;
+    uint64_t *grams;        /* sorted distinct gram hashes */
+    size_t *postings_start; /* ngrams + 1 entries into postings */
+    struct qgram_posting *postings;
+};
+
+struct qgram_entry {
+    uint64_t gram;
+    uint32_t id;
+};
+
+
+static uint64_t qgram_hash(const JFISH_UNICODE *s, int q)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    int i;
+
+    for (i = 0; i < q; i++) {
+        h ^= (uint64_t)s[i];
+        h *= 0x100000001b3ull;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+
+static int qgram_entry_cmp(const void *a, const void *b)
+{
+    const struct qgram_entry *x = a, *y = b;
+
+    if (x->gram != y->gram) {
+        return x->gram < y->gram ? -1 : 1;
+    }
+    return x->id < y->id ? -1 : x->id > y->id;
+}
+
+
+static int uint64_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+
+static int qgram_string_len(const struct qgram_index *idx, int id)
+{
+    return (int)(idx->offsets[id + 1] - idx->offsets[id]);
+}
+
+
+void qgram_index_free(struct qgram_index *idx)
+{
+    if (!idx) {
+        return;
+    }
+    free(idx->pool);
+    free(idx->offsets);
+    free(idx->by_length);
+    free(idx->length_start);
+    free(idx->grams);
+    free(idx->postings_start);
+    free(idx->postings);
+    free(idx);
+}
+
+
+struct qgram_index* qgram_index_create(const JFISH_UNICODE *const *strs, const int *lens,
+                                       int count, int q)
+{
+    struct qgram_index *idx;
+    struct qgram_entry *entries = NULL;
+    size_t *fill = NULL;
+    size_t total_len = 0, total_grams = 0, n, i, g, p;
+    int id, len, j;
+
+    if (q < 1 || count < 0) {
+        return NULL;
+    }
+
+    idx = calloc(1, sizeof(struct qgram_index));
+    if (!idx) {
+        return NULL;
+    }
+    idx->q = q;
+    idx->count = count;
+
+    for (id = 0; id < count; id++) {
+        total_len += lens[id];
+        if (lens[id] >= q) {
+            total_grams += lens[id] - q + 1;
+        }
+        if (lens[id] > idx->max_len) {
+            idx->max_len = lens[id];
+        }
+    }
+
+    idx->pool = safe_malloc(total_len + 1, sizeof(JFISH_UNICODE));
+    idx->offsets = safe_malloc((size_t)count + 1, sizeof(size_t));
+    idx->by_length = safe_malloc((size_t)count + 1, sizeof(int));
+    idx->length_start = calloc((size_t)idx->max_len + 2, sizeof(size_t));
+    entries = safe_malloc(total_grams + 1, sizeof(struct qgram_entry));
+    if (!idx->pool || !idx->offsets || !idx->by_length || !idx->length_start || !entries) {
+        goto fail;
+    }
+
+    /* copy strings into the pool and emit (gram, id) pairs */
+    idx->offsets[0] = 0;
+    n = 0;
+    for (id = 0; id < count; id++) {
+        len = lens[id];
+        memcpy(idx->pool + idx->offsets[id], strs[id], len * sizeof(JFISH_UNICODE));
+        idx->offsets[id + 1] = idx->offsets[id] + len;
+        for (j = 0; j + q <= len; j++) {
+            entries[n].gram = qgram_hash(idx->pool + idx->offsets[id] + j, q);
+            entries[n].id = id;
+            n++;
+        }
+        idx->length_start[len + 1]++;
+    }
+
+    /* counting sort of ids by length */
+    for (j = 0; j <= idx->max_len; j++) {
+        idx->length_start[j + 1] += idx->length_start[j];
+    }
+    fill = safe_malloc((size_t)idx->max_len + 1, sizeof(size_t));
+    if (!fill) {
+        goto fail;
+    }
+    memcpy(fill, idx->length_start, ((size_t)idx->max_len + 1) * sizeof(size_t));
+    for (id = 0; id < count; id++) {
+        idx->by_length[fill[lens[id]]++] = id;
+    }
+    free(fill);
+
+    qsort(entries, n, sizeof(struct qgram_entry), qgram_entry_cmp);
+
+    /* collapse into distinct grams and (id, occurrences) postings */
+    idx->ngrams = 0;
+    for (i = 0; i < n; i++) {
+        if (!i || entries[i].gram != entries[i - 1].gram) {
+            idx->ngrams++;
+        }
+    }
+    idx->grams = safe_malloc(idx->ngrams + 1, sizeof(uint64_t));
+    idx->postings_start = safe_malloc(idx->ngrams + 1, sizeof(size_t));
+    idx->postings = safe_malloc(n + 1, sizeof(struct qgram_posting));
+    if (!idx->grams || !idx->postings_start || !idx->postings) {
+        goto fail;
+    }
+
+    g = 0;
+    p = 0;
+    for (i = 0; i < n; i++) {
+        if (!i || entries[i].gram != entries[i - 1].gram) {
+            idx->grams[g] = entries[i].gram;
+            idx->postings_start[g] = p;
+            g++;
+        } else if (entries[i].id == entries[i - 1].id) {
+            idx->postings[p - 1].count++;
+            continue;
+        }
+        idx->postings[p].id = entries[i].id;
+        idx->postings[p].count = 1;
+        p++;
+    }
+    idx->postings_start[g] = p;
+
+    free(entries);
+    return idx;
+
+ fail:
+    free(entries);
+    qgram_index_free(idx);
+    return NULL;
+}
+
+
+static const struct qgram_posting* qgram_lookup(const struct qgram_index *idx, uint64_t gram,
+                                               size_t *npostings)
+{
+    size_t lo = 0, hi = idx->ngrams, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (idx->grams[mid] < gram) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == idx->ngrams || idx->grams[lo] != gram) {
+        *npostings = 0;
+        return NULL;
+    }
+    *npostings = idx->postings_start[lo + 1] - idx->postings_start[lo];
+    return idx->postings + idx->postings_start[lo];
+}
+
+
+struct qgram_counter {
+    int id;
+    int count;
+};
+
+struct qgram_result {
+    int id;
+    int distance;
+};
+
+
+static int qgram_result_cmp(const void *a, const void *b)
+{
+    const struct qgram_result *x = a, *y = b;
+
+    if (x->distance != y->distance) {
+        return x->distance - y->distance;
+    }
+    return x->id - y->id;
+}
+
+
+/* Append to a growable result array, returning 0 on allocation failure. */
+static int qgram_push(struct qgram_result **results, size_t *n, size_t *cap, int id, int distance)
+{
+    struct qgram_result *grown;
+
+    if (*n == *cap) {
+        *cap = *cap ? *cap * 2 : 16;
+        grown = realloc(*results, *cap * sizeof(struct qgram_result));
+        if (!grown) {
+            return 0;
+        }
+        *results = grown;
+    }
+    (*results)[*n].id = id;
+    (*results)[*n].distance = distance;
+    (*n)++;
+    return 1;
+}
+
+
+/*
+  Find all strings within max_distance edits of query.
+
+  Up to max_results (id, distance) pairs are written to out_ids/out_dists,
+  ordered by distance then id.  Returns the total number of matches (which
+  may exceed max_results) or -1 on allocation failure.
+*/
+int qgram_index_search(const struct qgram_index *idx, const JFISH_UNICODE *query, int len,
+                       int max_distance, int *out_ids, int *out_dists, int max_results)
+{
+    const struct qgram_posting *postings;
+    struct qgram_counter *counters = NULL;
+    struct qgram_result *results = NULL;
+    uint64_t *qgrams = NULL;
+    size_t nqgrams, npostings, touched = 0, table_size = 8, mask, slot;
+    size_t nresults = 0, cap = 0, i, k, g;
+    int q = idx->q, id, cand_len, min_len, max_len, threshold, dist, mult;
+    int ret = -1;
+
+    if (max_distance < 0) {
+        return 0;
+    }
+
+    min_len = len - max_distance > 0 ? len - max_distance : 0;
+    max_len = len + max_distance < idx->max_len ? len + max_distance : idx->max_len;
+
+    /* distinct query grams with multiplicities */
+    nqgrams = len >= q ? (size_t)(len - q + 1) : 0;
+    qgrams = safe_malloc(nqgrams + 1, sizeof(uint64_t));
+    if (!qgrams) {
+        return -1;
+    }
+    for (i = 0; i < nqgrams; i++) {
+        qgrams[i] = qgram_hash(query + i, q);
+    }
+    qsort(qgrams, nqgrams, sizeof(uint64_t), uint64_cmp);
+
+    for (i = 0; i < nqgrams; i++) {
+        if (!i || qgrams[i] != qgrams[i - 1]) {
+            qgram_lookup(idx, qgrams[i], &npostings);
+            touched += npostings;
+        }
+    }
+
+    /* ScanCount into an open-addressing table sized by the touched postings */
+    while (table_size < touched * 2) {
+        table_size *= 2;
+    }
+    mask = table_size - 1;
+    counters = safe_malloc(table_size, sizeof(struct qgram_counter));
+    if (!counters) {
+        goto cleanup;
+    }
+    for (i = 0; i < table_size; i++) {
+        counters[i].id = -1;
+        counters[i].count = 0;
+    }
+
+    for (i = 0; i < nqgrams; i = g) {
+        for (g = i + 1; g < nqgrams && qgrams[g] == qgrams[i]; g++);
+        mult = (int)(g - i);
+        postings = qgram_lookup(idx, qgrams[i], &npostings);
+        for (k = 0; k < npostings; k++) {
+            id = postings[k].id;
+            cand_len = qgram_string_len(idx, id);
+            if (cand_len < min_len || cand_len > max_len) {
+                continue;
+            }
+            slot = ((size_t)id * 2654435761u) & mask;
+            while (counters[slot].id != -1 && counters[slot].id != id) {
+                slot = (slot + 1) & mask;
+            }
+            counters[slot].id = id;
+            counters[slot].count += MIN(mult, (int)postings[k].count);
+        }
+    }
+
+    /* ids reaching the count threshold for their length */
+    for (slot = 0; slot < table_size; slot++) {
+        id = counters[slot].id;
+        if (id == -1) {
+            continue;
+        }
+        cand_len = qgram_string_len(idx, id);
+        threshold = (cand_len > len ? cand_len : len) - q + 1 - max_distance * q;
+        if (threshold <= 0 || counters[slot].count < threshold) {
+            continue;
+        }
+        dist = levenshtein_distance(query, len, idx->pool + idx->offsets[id], cand_len);
+        if (dist < 0) {
+            goto cleanup;
+        }
+        if (dist <= max_distance && !qgram_push(&results, &nresults, &cap, id, dist)) {
+            goto cleanup;
+        }
+    }
+
+    /* lengths where the lemma gives no bound: every id must be verified */
+    for (cand_len = min_len; cand_len <= max_len; cand_len++) {
+        threshold = (cand_len > len ? cand_len : len) - q + 1 - max_distance * q;
+        if (threshold > 0) {
+            continue;
+        }
+        for (k = idx->length_start[cand_len]; k < idx->length_start[cand_len + 1]; k++) {
+            id = idx->by_length[k];
+            dist = levenshtein_distance(query, len, idx->pool + idx->offsets[id], cand_len);
+            if (dist < 0) {
+                goto cleanup;
+            }
+            if (dist <= max_distance && !qgram_push(&results, &nresults, &cap, id, dist)) {
+                goto cleanup;
+            }
+        }
+    }
+
+    qsort(results, nresults, sizeof(struct qgram_result), qgram_result_cmp);
+    for (i = 0; i < nresults && i < (size_t)max_results; i++) {
+        out_ids[i] = results[i].id;
+        if (out_dists) {
+            out_dists[i] = results[i].distance;
+        }
+    }
+    ret = (int)nresults;
+
+ cleanup:
+    free(results);
+    free(counters);
+    free(qgrams);
+    return ret;
+}
+
+
+int qgram_index_size(const struct qgram_index *idx)
+{
+    return idx->count;
+}
@@ -0,0 +1,211 @@
+#include "jellyfish.h"
+#include <string.h>
+#include <stdlib.h>
+
+/*
+  Precompiled query.
+
+  When one string is compared against many candidates, everything that only
+  depends on it is built once: a private copy of the string and its pattern
+  match vectors, which drive the bit-parallel Levenshtein kernel and, for
+  queries of up to 64 characters, a bit-parallel version of the Jaro
+  matching step.  An ASCII character histogram (everything else pooled) is
+  kept for the pruning bound of jellyfish_query_jaro_winkler_threshold().
+
+  The Jaro methods treat the query as the second string, so
+  jellyfish_query_jaro_winkler(q, s, ...) equals
+  jaro_winkler_similarity(s, ..., q, ...).
+*/
+
+struct jellyfish_query {
+    JFISH_UNICODE *str;
+    int len;
+    struct jfish_peq peq;
+    int hist[129];
+};
+
+
+struct jellyfish_query* jellyfish_query_create(const JFISH_UNICODE *str, int len)
+{
+    struct jellyfish_query *query = calloc(1, sizeof(struct jellyfish_query));
+    int i;
+
+    if (!query) {
+        return NULL;
+    }
+
+    query->str = safe_malloc((size_t)len + 1, sizeof(JFISH_UNICODE));
+    if (!query->str) {
+        free(query);
+        return NULL;
+    }
+    memcpy(query->str, str, len * sizeof(JFISH_UNICODE));
+    query->str[len] = 0;
+    query->len = len;
+    for (i = 0; i < len; i++) {
+        query->hist[str[i] < 128 ? str[i] : 128]++;
+    }
+
+    if (!jfish_peq_init(&query->peq, query->str, len)) {
+        free(query->str);
+        free(query);
+        return NULL;
+    }
+    return query;
+}
+
+
+void jellyfish_query_free(struct jellyfish_query *query)
+{
+    if (!query) {
+        return;
+    }
+    jfish_peq_free(&query->peq);
+    free(query->str);
+    free(query);
+}
+
+
+int jellyfish_query_levenshtein(const struct jellyfish_query *query, const JFISH_UNICODE *str, int len)
+{
+    return jfish_myers_distance(&query->peq, query->len, str, len);
+}
+
+
+/* Levenshtein distance, or max_distance + 1 once it is known to be larger. */
+int jellyfish_query_levenshtein_bounded(const struct jellyfish_query *query,
+                                        const JFISH_UNICODE *str, int len, int max_distance)
+{
+    return jfish_myers_distance_bounded(&query->peq, query->len, str, len, max_distance);
+}
+
+
+int jellyfish_query_damerau_levenshtein(const struct jellyfish_query *query,
+                                        const JFISH_UNICODE *str, int len)
+{
+    return damerau_levenshtein_distance(query->str, str, query->len, len);
+}
+
+
+size_t jellyfish_query_hamming(const struct jellyfish_query *query, const JFISH_UNICODE *str, int len)
+{
+    return hamming_distance(query->str, query->len, str, len);
+}
+
+
+/*
+  Same matching as _jaro_winkler() with the candidate as `ying`: for each
+  candidate character the first unflagged query position inside the search
+  window is the lowest set bit of peq[c] & window & ~flagged.
+*/
+static double query_jaro_winkler(const struct jellyfish_query *query,
+                                 const JFISH_UNICODE *ying, int ying_length,
+                                 int long_tolerance, int winklerize)
+{
+    const JFISH_UNICODE *yang = query->str;
+    int yang_length = query->len;
+    JFISH_UNICODE matched[64];
+    uint64_t flagged = 0, window, candidates;
+    long search_range, lowlim, hilim;
+    long common_chars = 0, trans_count = 0;
+    int i, j;
+
+    if (!ying_length || !yang_length) return 0;
+
+    if (yang_length > 64) {
+        return _jaro_winkler(ying, ying_length, yang, yang_length, long_tolerance, winklerize);
+    }
+
+    search_range = ying_length > yang_length ? ying_length : yang_length;
+    search_range = (search_range / 2) - 1;
+    if (search_range < 0) search_range = 0;
+
+    for (i = 0; i < ying_length; i++) {
+        lowlim = (i >= search_range) ? i - search_range : 0;
+        hilim = (i + search_range <= yang_length - 1) ? (i + search_range) : yang_length - 1;
+        if (lowlim > hilim) {
+            continue;
+        }
+        window = (hilim == 63) ? ~(uint64_t)0 : ((uint64_t)1 << (hilim + 1)) - 1;
+        window &= ~(((uint64_t)1 << lowlim) - 1);
+
+        candidates = jfish_peq_get(&query->peq, ying[i])[0] & window & ~flagged;
+        if (candidates) {
+            flagged |= candidates & (~candidates + 1);
+            matched[common_chars++] = ying[i];
+        }
+    }
+
+    if (!common_chars) {
+        return 0;
+    }
+
+    // pair the matched candidate characters, in order, with the flagged
+    // query positions
+    for (i = 0, j = 0; j < yang_length; j++) {
+        if (flagged & ((uint64_t)1 << j)) {
+            if (matched[i++] != yang[j]) {
+                trans_count++;
+            }
+        }
+    }
+    trans_count /= 2;
+
+    return _jaro_winkler_weight(ying, ying_length, yang, yang_length,
+                                common_chars, trans_count, long_tolerance, winklerize);
+}
+
+
+double jellyfish_query_jaro(const struct jellyfish_query *query, const JFISH_UNICODE *str, int len)
+{
+    return query_jaro_winkler(query, str, len, 0, 0);
+}
+
+
+double jellyfish_query_jaro_winkler(const struct jellyfish_query *query,
+                                    const JFISH_UNICODE *str, int len, int long_tolerance)
+{
+    return query_jaro_winkler(query, str, len, long_tolerance, 1);
+}
+
+
+/*
+  jaro_winkler_similarity_threshold() against the query: 0 for candidates
+  scoring below min_score, with the length and histogram bounds checked
+  before any matching is done.
+*/
+double jellyfish_query_jaro_winkler_threshold(const struct jellyfish_query *query,
+                                              const JFISH_UNICODE *str, int len,
+                                              int long_tolerance, double min_score)
+{
+    int hist[129];
+    int i, prefix;
+    long common;
+    double weight;
+
+    if (!len || !query->len) {
+        return 0;
+    }
+
+    for (prefix = 0; prefix < 4 && prefix < len && prefix < query->len &&
+             str[prefix] == query->str[prefix]; prefix++);
+
+    common = MIN(len, query->len);
+    if (_jaro_winkler_bound(common, len, query->len, prefix, long_tolerance) < min_score) {
+        return 0;
+    }
+
+    memcpy(hist, query->hist, sizeof(hist));
+    common = 0;
+    for (i = 0; i < len; i++) {
+        if (hist[str[i] < 128 ? str[i] : 128]-- > 0) {
+            common++;
+        }
+    }
+    if (_jaro_winkler_bound(common, len, query->len, prefix, long_tolerance) < min_score) {
+        return 0;
+    }
+
+    weight = query_jaro_winkler(query, str, len, long_tolerance, 1);
+    return (weight < min_score && weight >= 0) ? 0 : weight;
+}
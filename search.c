@@ -0,0 +1,285 @@
+#include "jellyfish.h"
+#include <string.h>
+#include <stdlib.h>
+
+/*
+  Approximate substring search: every end position in a text where some
+  substring is within max_distance Levenshtein edits of the pattern.
+
+  This is Sellers' dynamic programming with a free start in the text (the
+  top row is 0 everywhere instead of j), computed column by column with
+  Myers' bit-vector algorithm.  A pattern of up to 64 characters is one
+  word of state per text character.  Longer patterns are split into 64-row
+  blocks and, following Myers, only the blocks down to the last one that
+  can still hold a value <= max_distance are computed: the active region is
+  extended by at most one block per text character (its first row can only
+  come within the bound through the block above) and shrunk when a block's
+  bottom row is so high that none of its cells can be within the bound.
+  Cells below the active region are taken to grow by one per row, which
+  over-estimates them but never pulls a value above the bound below it.
+
+  The text is consumed in pieces by jellyfish_search_feed(), so a long
+  buffer can be streamed through without holding it all; end positions
+  count from the start of the first piece.  End 0, the empty substring
+  before the text, is within the bound when m <= max_distance and is
+  reported by the first feed.  An empty pattern matches at every end.
+*/
+
+struct jellyfish_search {
+    struct jfish_peq peq;
+    int m;
+    int max_distance;
+    size_t words;
+    size_t last;        /* last computed block */
+    size_t position;    /* text characters consumed */
+    int at_start;       /* end 0 not reported yet */
+    uint64_t *pv;
+    uint64_t *mv;
+    int *score;         /* value of each computed block's bottom row */
+};
+
+
+static int block_height(const struct jellyfish_search *search, size_t b)
+{
+    return b == search->words - 1 ? search->m - (int)b * 64 : 64;
+}
+
+
+/* Advance block b by one text character; returns its bottom row's
+ * horizontal delta. */
+static inline int search_block(uint64_t *pv_word, uint64_t *mv_word, uint64_t eq,
+                               uint64_t high, int carry)
+{
+    uint64_t pv = *pv_word, mv = *mv_word;
+    uint64_t xv, xh, ph, mh;
+    int hout;
+
+    xv = eq | mv;
+    if (carry < 0) {
+        eq |= 1;
+    }
+    xh = (((eq & pv) + pv) ^ pv) | eq;
+    ph = mv | ~(xh | pv);
+    mh = pv & xh;
+
+    hout = (ph & high) ? 1 : (mh & high) ? -1 : 0;
+
+    ph <<= 1;
+    mh <<= 1;
+    if (carry < 0) {
+        mh |= 1;
+    } else if (carry > 0) {
+        ph |= 1;
+    }
+    *pv_word = mh | ~(xv | ph);
+    *mv_word = ph & xv;
+    return hout;
+}
+
+
+/* Put the search back at the start of a text: column 0 is D[i][0] = i. */
+void jellyfish_search_reset(struct jellyfish_search *search)
+{
+    size_t b;
+
+    search->position = 0;
+    search->at_start = 1;
+    search->last = search->max_distance > 0 ? (size_t)(search->max_distance - 1) / 64 : 0;
+    if (search->last >= search->words) {
+        search->last = search->words - 1;
+    }
+    for (b = 0; b <= search->last; b++) {
+        search->pv[b] = ~(uint64_t)0;
+        search->mv[b] = 0;
+        search->score[b] = (int)b * 64 + block_height(search, b);
+    }
+}
+
+
+/*
+  Prepare a search for pattern (m characters) with at most max_distance
+  edits.  Returns NULL on allocation failure or a negative max_distance.
+*/
+struct jellyfish_search* jellyfish_search_create(const JFISH_UNICODE *pattern, int m, int max_distance)
+{
+    struct jellyfish_search *search;
+
+    if (m < 0 || max_distance < 0) {
+        return NULL;
+    }
+    search = calloc(1, sizeof(struct jellyfish_search));
+    if (!search) {
+        return NULL;
+    }
+    if (!jfish_peq_init(&search->peq, pattern, m)) {
+        free(search);
+        return NULL;
+    }
+    search->m = m;
+    search->max_distance = max_distance;
+    search->words = search->peq.words;
+    search->pv = safe_matrix_malloc(2, search->words, sizeof(uint64_t));
+    search->score = safe_malloc(search->words, sizeof(int));
+    if (!search->pv || !search->score) {
+        jellyfish_search_free(search);
+        return NULL;
+    }
+    search->mv = search->pv + search->words;
+    jellyfish_search_reset(search);
+    return search;
+}
+
+
+void jellyfish_search_free(struct jellyfish_search *search)
+{
+    if (!search) {
+        return;
+    }
+    jfish_peq_free(&search->peq);
+    free(search->pv);
+    free(search->score);
+    free(search);
+}
+
+
+/* The single-word case: no blocks to track. */
+static int search_feed_word(struct jellyfish_search *search, const JFISH_UNICODE *text, size_t n,
+                            jfish_search_fn fn, void *ctx)
+{
+    uint64_t pv = search->pv[0], mv = search->mv[0];
+    uint64_t eq, xv, xh, ph, mh;
+    uint64_t high = (uint64_t)1 << (search->m - 1);
+    int score = search->score[0], k = search->max_distance;
+    size_t j;
+    int stopped = 0;
+
+    for (j = 0; j < n; j++) {
+        eq = *jfish_peq_get(&search->peq, text[j]);
+        xv = eq | mv;
+        xh = (((eq & pv) + pv) ^ pv) | eq;
+        ph = mv | ~(xh | pv);
+        mh = pv & xh;
+        if (ph & high) {
+            score++;
+        } else if (mh & high) {
+            score--;
+        }
+        ph <<= 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+
+        if (score <= k && fn(ctx, search->position + j + 1, score)) {
+            j++;
+            stopped = 1;
+            break;
+        }
+    }
+
+    search->pv[0] = pv;
+    search->mv[0] = mv;
+    search->score[0] = score;
+    search->position += j;
+    return stopped;
+}
+
+
+/*
+  Scan the next n characters of the text, calling fn(ctx, end, distance)
+  for every end position (exclusive, counted over everything fed since the
+  last reset) whose best substring is within max_distance.  fn returns
+  non-zero to stop the scan early.  Returns 1 if fn stopped it, else 0.
+*/
+int jellyfish_search_feed(struct jellyfish_search *search, const JFISH_UNICODE *text, size_t n,
+                          jfish_search_fn fn, void *ctx)
+{
+    const uint64_t *eq_row;
+    uint64_t *pv = search->pv, *mv = search->mv;
+    uint64_t last_high = (uint64_t)1 << ((search->m - 1) % 64);
+    size_t words = search->words, y = search->last, b, j;
+    int *score = search->score;
+    int k = search->max_distance, carry, bottom;
+
+    if (search->at_start) {
+        search->at_start = 0;
+        if (search->m <= k && fn(ctx, 0, search->m)) {
+            return 1;
+        }
+    }
+    if (search->m == 0) {
+        /* the empty substring ending anywhere is an exact match */
+        for (j = 0; j < n; j++) {
+            if (fn(ctx, search->position + j + 1, 0)) {
+                search->position += j + 1;
+                return 1;
+            }
+        }
+        search->position += n;
+        return 0;
+    }
+    if (words == 1) {
+        return search_feed_word(search, text, n, fn, ctx);
+    }
+
+    for (j = 0; j < n; j++) {
+        eq_row = jfish_peq_get(&search->peq, text[j]);
+
+        /* the top row is 0 in every column, so nothing enters block 0 */
+        carry = 0;
+        for (b = 0; b <= y; b++) {
+            carry = search_block(&pv[b], &mv[b], eq_row[b],
+                                 b == words - 1 ? last_high : (uint64_t)1 << 63, carry);
+            score[b] += carry;
+        }
+
+        if (y + 1 < words && score[y] - carry <= k && ((eq_row[y + 1] & 1) || carry < 0)) {
+            /* the row below block y comes within the bound: start the next
+             * block from the assumed +1 per row of the previous column */
+            y++;
+            pv[y] = ~(uint64_t)0;
+            mv[y] = 0;
+            bottom = score[y - 1] - carry + block_height(search, y);
+            carry = search_block(&pv[y], &mv[y], eq_row[y],
+                                 y == words - 1 ? last_high : (uint64_t)1 << 63, carry);
+            score[y] = bottom + carry;
+        } else {
+            while (y > 0 && score[y] >= k + block_height(search, y)) {
+                y--;
+            }
+        }
+
+        if (y == words - 1 && score[y] <= k && fn(ctx, search->position + j + 1, score[y])) {
+            search->last = y;
+            search->position += j + 1;
+            return 1;
+        }
+    }
+
+    search->last = y;
+    search->position += n;
+    return 0;
+}
+
+
+/*
+  One-shot search of text for pattern.  Returns 1 if fn stopped the scan,
+  0 if it ran to the end, or -1 on allocation failure.  A negative
+  max_distance matches nowhere.
+*/
+int approximate_search(const JFISH_UNICODE *pattern, int m, const JFISH_UNICODE *text, size_t n,
+                       int max_distance, jfish_search_fn fn, void *ctx)
+{
+    struct jellyfish_search *search;
+    int result;
+
+    if (max_distance < 0) {
+        return 0;
+    }
+    search = jellyfish_search_create(pattern, m, max_distance);
+    if (!search) {
+        return -1;
+    }
+    result = jellyfish_search_feed(search, text, n, fn, ctx);
+    jellyfish_search_free(search);
+    return result;
+}
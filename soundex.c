@@ -1,74 +1,125 @@
 #include "jellyfish.h"
 #include <ctype.h>
 #include <stdlib.h>
+#include <string.h>
 
 char* soundex(const char *str)
 {
-    const char *s;
-    char c, prev;
-    int i;
     char *result = calloc(5, sizeof(char));
 
     if (!result) {
         return NULL;
     }
+    soundex_into(str, result);
+    return result;
+}
+
 
-    if (!*str) {
-        return result;
+/* The digit for byte ch; h and w keep the previous digit so that letters
+ * coded the same on either side of them are not repeated. */
+static char soundex_code(char ch, char prev)
+{
+    switch(tolower(ch)) {
+    case 'b':
+    case 'f':
+    case 'p':
+    case 'v':
+        return '1';
+    case 'c':
+    case 'g':
+    case 'j':
+    case 'k':
+    case 'q':
+    case 's':
+    case 'x':
+    case 'z':
+        return '2';
+    case 'd':
+    case 't':
+        return '3';
+    case 'l':
+        return '4';
+    case 'm':
+    case 'n':
+        return '5';
+    case 'r':
+        return '6';
+    case 'h':
+    case 'w':
+        // do nothing - h and w should allow prior character to pass through
+        return prev;
+    default:
+        return '\0';
     }
+}
 
-    prev = '\0';
-    for(s = str, i = 1; *s && i < 4; s++) {
-        switch(tolower(*s)) {
-        case 'b':
-        case 'f':
-        case 'p':
-        case 'v':
-            c = '1';
-            break;
-        case 'c':
-        case 'g':
-        case 'j':
-        case 'k':
-        case 'q':
-        case 's':
-        case 'x':
-        case 'z':
-            c = '2';
-            break;
-        case 'd':
-        case 't':
-            c = '3';
-            break;
-        case 'l':
-            c = '4';
-            break;
-        case 'm':
-        case 'n':
-            c = '5';
-            break;
-        case 'r':
-            c = '6';
-            break;
-        case 'h':
-        case 'w':
-            // do nothing - h and w should allow prior character to pass through
-            break;
-        default:
-            c = '\0';
-        }
 
-        if (c && c != prev && s != str) {
-            result[i++] = c;
-        }
-        prev = c;
+/* Feed the next byte to the encoder; *i is the next digit to write, 0
+ * before the first byte.  Returns non-zero while more digits are wanted. */
+static int soundex_step(char result[5], int *i, char *prev, char ch)
+{
+    char c = soundex_code(ch, *prev);
+
+    if (!*i) {
+        result[0] = toupper(ch);
+        *i = 1;
+    } else if (c && c != *prev) {
+        result[(*i)++] = c;
     }
+    *prev = c;
+    return *i < 4;
+}
+
 
-    for ( ; i < 4; i++) {
+static void soundex_pad(char result[5], int i)
+{
+    for ( ; i && i < 4; i++) {
         result[i] = '0';
     }
+}
 
-    result[0] = toupper(*str);
 
-    return result;
+/* Write the soundex code of str into result (4 characters and a NUL, or an
+ * empty string for empty input). */
+void soundex_into(const char *str, char result[5])
+{
+    char prev = '\0';
+    int i = 0;
+
+    memset(result, 0, 5);
+    for ( ; *str && soundex_step(result, &i, &prev, *str); str++);
+    soundex_pad(result, i);
+}
+
+
+/*
+  soundex_into() for the NFKD form of str (Latin decompositions from
+  nfkd.c, as phonetic_keys() uses), encoded as UTF-8 one character at a
+  time, so nothing is allocated and the scan stops as soon as the code is
+  complete.  Like soundex_into(), stops at an embedded NUL.
+*/
+void soundex_ucs(const JFISH_UNICODE *str, int len, char result[5])
+{
+    JFISH_UNICODE decomposed[3];
+    char bytes[4];
+    char prev = '\0';
+    int i = 0, k, b, n, nbytes;
+
+    memset(result, 0, 5);
+    for ( ; len > 0 && *str; str++, len--) {
+        n = jfish_nfkd_latin(*str, decomposed);
+        if (!n) {
+            decomposed[0] = *str;
+            n = 1;
+        }
+        for (k = 0; k < n; k++) {
+            nbytes = jfish_utf8_encode(decomposed[k], bytes);
+            for (b = 0; b < nbytes; b++) {
+                if (!soundex_step(result, &i, &prev, bytes[b])) {
+                    return;
+                }
+            }
+        }
+    }
+    soundex_pad(result, i);
 }
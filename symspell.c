@@ -0,0 +1,384 @@
+#include "jellyfish.h"
+#include <string.h>
+#include <stdlib.h>
+
+/*
+  Symmetric delete index (SymSpell) for dictionary lookups within a small
+  number of edits.
+
+  If two strings are within k Damerau-Levenshtein edits, deleting at most
+  k characters from each makes them equal: every edit (substitution,
+  insertion, deletion or transposition) costs at most one character of
+  their longest common subsequence.  So every deletion variant of every
+  term (up to max_distance deletions) is hashed to 64 bits and indexed,
+  and a lookup generates the query's own deletion variants, collects the
+  terms any of them point at and verifies those candidates with
+  damerau_levenshtein_distance().  Hash collisions can only add
+  candidates, so results are exact.
+
+  Terms are copied into one pool.  The (variant hash, term id) pairs are
+  sorted and collapsed CSR style into a flat array of term ids per
+  distinct hash, and the hashes go into an open-addressing table that maps
+  each to its range of ids.
+*/
+
+struct symspell_index {
+    int max_distance;
+    int count;
+    int max_len;
+    JFISH_UNICODE *pool;
+    size_t *offsets;        /* count + 1 entries into pool */
+    size_t nkeys;
+    size_t *postings_start; /* nkeys + 1 entries into postings */
+    uint32_t *postings;     /* term ids */
+    size_t capacity;        /* table slots, a power of two */
+    uint64_t *keys;         /* variant hash per slot, 0 for empty */
+    uint32_t *key_index;    /* position of the slot's hash among the nkeys */
+};
+
+struct symspell_entry {
+    uint64_t hash;
+    uint32_t id;
+};
+
+struct symspell_entries {
+    struct symspell_entry *entries;
+    size_t n;
+    size_t cap;
+};
+
+
+static uint64_t symspell_hash(const JFISH_UNICODE *s, int len)
+{
+    uint64_t h = 0xcbf29ce484222325ull ^ (uint64_t)len;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        h ^= (uint64_t)s[i];
+        h *= 0x100000001b3ull;
+        h ^= h >> 29;
+    }
+    /* 0 marks empty table slots */
+    return h ? h : 1;
+}
+
+
+static int symspell_entry_cmp(const void *a, const void *b)
+{
+    const struct symspell_entry *x = a, *y = b;
+
+    if (x->hash != y->hash) {
+        return x->hash < y->hash ? -1 : 1;
+    }
+    return x->id < y->id ? -1 : x->id > y->id;
+}
+
+
+static int symspell_push(struct symspell_entries *out, uint64_t hash, uint32_t id)
+{
+    struct symspell_entry *grown;
+
+    if (out->n == out->cap) {
+        out->cap = out->cap ? out->cap * 2 : 256;
+        grown = realloc(out->entries, out->cap * sizeof(struct symspell_entry));
+        if (!grown) {
+            return 0;
+        }
+        out->entries = grown;
+    }
+    out->entries[out->n].hash = hash;
+    out->entries[out->n].id = id;
+    out->n++;
+    return 1;
+}
+
+
+/*
+  Emit s and every string made from it by deleting up to deletes more
+  characters at positions from `from` on, so each set of deleted positions
+  is produced once.  work holds deletes rows of len characters.  Returns 0
+  on allocation failure.
+*/
+static int symspell_variants(const JFISH_UNICODE *s, int len, int from, int deletes,
+                             JFISH_UNICODE *work, uint32_t id, struct symspell_entries *out)
+{
+    int i;
+
+    if (!symspell_push(out, symspell_hash(s, len), id)) {
+        return 0;
+    }
+    if (!deletes) {
+        return 1;
+    }
+    for (i = from; i < len; i++) {
+        memcpy(work, s, i * sizeof(JFISH_UNICODE));
+        memcpy(work + i, s + i + 1, (len - i - 1) * sizeof(JFISH_UNICODE));
+        if (!symspell_variants(work, len - 1, i, deletes - 1, work + len, id, out)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+static int symspell_string_len(const struct symspell_index *idx, int id)
+{
+    return (int)(idx->offsets[id + 1] - idx->offsets[id]);
+}
+
+
+void symspell_index_free(struct symspell_index *idx)
+{
+    if (!idx) {
+        return;
+    }
+    free(idx->pool);
+    free(idx->offsets);
+    free(idx->postings_start);
+    free(idx->postings);
+    free(idx->keys);
+    free(idx->key_index);
+    free(idx);
+}
+
+
+struct symspell_index* symspell_index_create(const JFISH_UNICODE *const *strs, const int *lens,
+                                             int count, int max_distance)
+{
+    struct symspell_index *idx;
+    struct symspell_entries variants = {NULL, 0, 0};
+    JFISH_UNICODE *work = NULL;
+    size_t total_len = 0, i, g, p, slot, mask;
+    int id;
+
+    if (max_distance < 0 || count < 0) {
+        return NULL;
+    }
+
+    idx = calloc(1, sizeof(struct symspell_index));
+    if (!idx) {
+        return NULL;
+    }
+    idx->max_distance = max_distance;
+    idx->count = count;
+
+    for (id = 0; id < count; id++) {
+        total_len += lens[id];
+        if (lens[id] > idx->max_len) {
+            idx->max_len = lens[id];
+        }
+    }
+
+    idx->pool = safe_malloc(total_len + 1, sizeof(JFISH_UNICODE));
+    idx->offsets = safe_malloc((size_t)count + 1, sizeof(size_t));
+    work = safe_matrix_malloc((size_t)max_distance + 1, (size_t)idx->max_len + 1,
+                              sizeof(JFISH_UNICODE));
+    if (!idx->pool || !idx->offsets || !work) {
+        goto fail;
+    }
+
+    /* copy terms into the pool and emit (variant hash, id) pairs */
+    idx->offsets[0] = 0;
+    for (id = 0; id < count; id++) {
+        memcpy(idx->pool + idx->offsets[id], strs[id], lens[id] * sizeof(JFISH_UNICODE));
+        idx->offsets[id + 1] = idx->offsets[id] + lens[id];
+        if (!symspell_variants(idx->pool + idx->offsets[id], lens[id], 0,
+                               MIN(max_distance, lens[id]), work, id, &variants)) {
+            goto fail;
+        }
+    }
+    free(work);
+    work = NULL;
+
+    qsort(variants.entries, variants.n, sizeof(struct symspell_entry), symspell_entry_cmp);
+
+    /* collapse into distinct hashes and their distinct ids */
+    idx->nkeys = 0;
+    for (i = 0; i < variants.n; i++) {
+        if (!i || variants.entries[i].hash != variants.entries[i - 1].hash) {
+            idx->nkeys++;
+        }
+    }
+    idx->capacity = 8;
+    while (idx->capacity < idx->nkeys * 2) {
+        idx->capacity *= 2;
+    }
+    idx->postings_start = safe_malloc(idx->nkeys + 1, sizeof(size_t));
+    idx->postings = safe_malloc(variants.n + 1, sizeof(uint32_t));
+    idx->keys = calloc(idx->capacity, sizeof(uint64_t));
+    idx->key_index = safe_malloc(idx->capacity, sizeof(uint32_t));
+    if (!idx->postings_start || !idx->postings || !idx->keys || !idx->key_index) {
+        goto fail;
+    }
+
+    mask = idx->capacity - 1;
+    g = 0;
+    p = 0;
+    for (i = 0; i < variants.n; i++) {
+        if (!i || variants.entries[i].hash != variants.entries[i - 1].hash) {
+            slot = variants.entries[i].hash & mask;
+            while (idx->keys[slot]) {
+                slot = (slot + 1) & mask;
+            }
+            idx->keys[slot] = variants.entries[i].hash;
+            idx->key_index[slot] = (uint32_t)g;
+            idx->postings_start[g] = p;
+            g++;
+        } else if (variants.entries[i].id == variants.entries[i - 1].id) {
+            continue;
+        }
+        idx->postings[p++] = variants.entries[i].id;
+    }
+    idx->postings_start[g] = p;
+
+    free(variants.entries);
+    return idx;
+
+ fail:
+    free(work);
+    free(variants.entries);
+    symspell_index_free(idx);
+    return NULL;
+}
+
+
+static const uint32_t* symspell_lookup(const struct symspell_index *idx, uint64_t hash,
+                                       size_t *npostings)
+{
+    size_t mask = idx->capacity - 1, slot = hash & mask, g;
+
+    while (idx->keys[slot]) {
+        if (idx->keys[slot] == hash) {
+            g = idx->key_index[slot];
+            *npostings = idx->postings_start[g + 1] - idx->postings_start[g];
+            return idx->postings + idx->postings_start[g];
+        }
+        slot = (slot + 1) & mask;
+    }
+    *npostings = 0;
+    return NULL;
+}
+
+
+struct symspell_result {
+    int id;
+    int distance;
+};
+
+
+static int symspell_result_cmp(const void *a, const void *b)
+{
+    const struct symspell_result *x = a, *y = b;
+
+    if (x->distance != y->distance) {
+        return x->distance - y->distance;
+    }
+    return x->id - y->id;
+}
+
+
+/*
+  Find all terms within max_distance Damerau-Levenshtein edits of query.
+  Lookups are exact up to the max_distance the index was built with;
+  larger values are reduced to it.
+
+  Up to max_results (id, distance) pairs are written to out_ids/out_dists,
+  ordered by distance then id.  Returns the total number of matches (which
+  may exceed max_results) or -1 on allocation failure.
+*/
+int symspell_index_search(const struct symspell_index *idx, const JFISH_UNICODE *query, int len,
+                          int max_distance, int *out_ids, int *out_dists, int max_results)
+{
+    struct symspell_entries variants = {NULL, 0, 0};
+    struct symspell_result *results = NULL;
+    const uint32_t *postings;
+    JFISH_UNICODE *work = NULL;
+    int *seen = NULL;
+    size_t npostings, touched = 0, table_size = 8, mask, slot, nresults = 0, i, k;
+    int id, cand_len, dist, ret = -1;
+
+    if (max_distance < 0) {
+        return 0;
+    }
+    if (max_distance > idx->max_distance) {
+        max_distance = idx->max_distance;
+    }
+
+    work = safe_matrix_malloc((size_t)max_distance + 1, (size_t)len + 1, sizeof(JFISH_UNICODE));
+    if (!work || !symspell_variants(query, len, 0, MIN(max_distance, len), work, 0, &variants)) {
+        goto cleanup;
+    }
+    for (i = 0; i < variants.n; i++) {
+        symspell_lookup(idx, variants.entries[i].hash, &npostings);
+        touched += npostings;
+    }
+
+    /* each candidate is verified once: remember ids in an open-addressing set */
+    while (table_size < touched * 2) {
+        table_size *= 2;
+    }
+    mask = table_size - 1;
+    seen = safe_malloc(table_size, sizeof(int));
+    results = safe_malloc(touched + 1, sizeof(struct symspell_result));
+    if (!seen || !results) {
+        goto cleanup;
+    }
+    memset(seen, 0xff, table_size * sizeof(int));
+
+    for (i = 0; i < variants.n; i++) {
+        postings = symspell_lookup(idx, variants.entries[i].hash, &npostings);
+        for (k = 0; k < npostings; k++) {
+            id = postings[k];
+            slot = ((size_t)id * 2654435761u) & mask;
+            while (seen[slot] != -1 && seen[slot] != id) {
+                slot = (slot + 1) & mask;
+            }
+            if (seen[slot] == id) {
+                continue;
+            }
+            seen[slot] = id;
+
+            cand_len = symspell_string_len(idx, id);
+            if (abs(cand_len - len) > max_distance) {
+                continue;
+            }
+            dist = damerau_levenshtein_distance(query, idx->pool + idx->offsets[id], len, cand_len);
+            if (dist < 0) {
+                goto cleanup;
+            }
+            if (dist <= max_distance) {
+                results[nresults].id = id;
+                results[nresults].distance = dist;
+                nresults++;
+            }
+        }
+    }
+
+    qsort(results, nresults, sizeof(struct symspell_result), symspell_result_cmp);
+    for (i = 0; i < nresults && i < (size_t)max_results; i++) {
+        out_ids[i] = results[i].id;
+        if (out_dists) {
+            out_dists[i] = results[i].distance;
+        }
+    }
+    ret = (int)nresults;
+
+ cleanup:
+    free(results);
+    free(seen);
+    free(work);
+    free(variants.entries);
+    return ret;
+}
+
+
+int symspell_index_size(const struct symspell_index *idx)
+{
+    return idx->count;
+}
+
+
+int symspell_index_max_distance(const struct symspell_index *idx)
+{
+    return idx->max_distance;
+}
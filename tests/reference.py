@@ -0,0 +1,160 @@
+"""Plain Python versions of the metrics, for the tests to check against.
+
+These follow the textbook definitions with full matrices and no shortcuts,
+so they are slow and only suited to short strings.
+"""
+import random
+
+
+def levenshtein(s1, s2):
+    prev = list(range(len(s2) + 1))
+    for i, c1 in enumerate(s1, 1):
+        cur = [i]
+        for j, c2 in enumerate(s2, 1):
+            cur.append(min(prev[j] + 1, cur[j - 1] + 1, prev[j - 1] + (c1 != c2)))
+        prev = cur
+    return prev[-1]
+
+
+def osa(s1, s2):
+    d = [[i + j if not i or not j else 0 for j in range(len(s2) + 1)]
+         for i in range(len(s1) + 1)]
+    for i in range(1, len(s1) + 1):
+        for j in range(1, len(s2) + 1):
+            cost = s1[i - 1] != s2[j - 1]
+            d[i][j] = min(d[i - 1][j] + 1, d[i][j - 1] + 1, d[i - 1][j - 1] + cost)
+            if (i > 1 and j > 1 and s1[i - 1] == s2[j - 2]
+                    and s1[i - 2] == s2[j - 1]):
+                d[i][j] = min(d[i][j], d[i - 2][j - 2] + 1)
+    return d[-1][-1]
+
+
+def damerau_levenshtein(s1, s2):
+    # Lowrance-Wagner: transposed pairs may be edited in between
+    inf = len(s1) + len(s2)
+    last_row = {}
+    d = [[inf] * (len(s2) + 2) for _ in range(len(s1) + 2)]
+    for i in range(len(s1) + 1):
+        d[i + 1][1] = i
+    for j in range(len(s2) + 1):
+        d[1][j + 1] = j
+    for i in range(1, len(s1) + 1):
+        last_col = 0
+        for j in range(1, len(s2) + 1):
+            k = last_row.get(s2[j - 1], 0)
+            l = last_col
+            cost = 1
+            if s1[i - 1] == s2[j - 1]:
+                cost = 0
+                last_col = j
+            d[i + 1][j + 1] = min(
+                d[i][j] + cost,
+                d[i + 1][j] + 1,
+                d[i][j + 1] + 1,
+                d[k][l] + (i - k - 1) + 1 + (j - l - 1),
+            )
+        last_row[s1[i - 1]] = i
+    return d[-1][-1]
+
+
+def jaro_winkler(s1, s2, long_tolerance=False, winklerize=True):
+    len1, len2 = len(s1), len(s2)
+    if not len1 or not len2:
+        return 0.0
+    min_len = min(len1, len2)
+    search_range = max(max(len1, len2) // 2 - 1, 0)
+    flags1 = [False] * len1
+    flags2 = [False] * len2
+    common = 0
+    for i, c in enumerate(s1):
+        for j in range(max(0, i - search_range), min(i + search_range, len2 - 1) + 1):
+            if not flags2[j] and s2[j] == c:
+                flags1[i] = flags2[j] = True
+                common += 1
+                break
+    if not common:
+        return 0.0
+    k = trans = 0
+    for i in range(len1):
+        if flags1[i]:
+            for j in range(k, len2):
+                if flags2[j]:
+                    k = j + 1
+                    break
+            if s1[i] != s2[j]:
+                trans += 1
+    trans //= 2
+    weight = (common / len1 + common / len2 + (common - trans) / common) / 3
+    if winklerize and weight > 0.7:
+        i = 0
+        while i < min(min_len, 4) and s1[i] == s2[i]:
+            i += 1
+        if i:
+            weight += i * 0.1 * (1.0 - weight)
+        if (long_tolerance and min_len > 4 and common > i + 1
+                and 2 * common >= min_len + i):
+            weight += (1.0 - weight) * (common - i - 1) / (len1 + len2 - i * 2 + 2)
+    return weight
+
+
+def jaro(s1, s2):
+    return jaro_winkler(s1, s2, winklerize=False)
+
+
+def lcs_length(s1, s2):
+    prev = [0] * (len(s2) + 1)
+    for c1 in s1:
+        cur = [0]
+        for j, c2 in enumerate(s2, 1):
+            cur.append(prev[j - 1] + 1 if c1 == c2 else max(prev[j], cur[j - 1]))
+        prev = cur
+    return prev[-1]
+
+
+def longest_common_substring_length(s1, s2):
+    best = 0
+    prev = [0] * (len(s2) + 1)
+    for c1 in s1:
+        cur = [0]
+        for j, c2 in enumerate(s2, 1):
+            cur.append(prev[j - 1] + 1 if c1 == c2 else 0)
+        best = max([best] + cur)
+        prev = cur
+    return best
+
+
+def random_word(rng, length, alphabet="abcde"):
+    return "".join(rng.choice(alphabet) for _ in range(length))
+
+
+def mutate(rng, word, edits, alphabet="abcde"):
+    """word with edits random insertions, deletions, substitutions and
+    adjacent transpositions applied."""
+    chars = list(word)
+    for _ in range(edits):
+        op = rng.randrange(4)
+        pos = rng.randrange(len(chars) + 1)
+        if op == 0 or not chars:
+            chars.insert(pos, rng.choice(alphabet))
+        elif op == 1:
+            del chars[min(pos, len(chars) - 1)]
+        elif op == 2:
+            chars[min(pos, len(chars) - 1)] = rng.choice(alphabet)
+        elif len(chars) > 1:
+            pos = min(pos, len(chars) - 2)
+            chars[pos], chars[pos + 1] = chars[pos + 1], chars[pos]
+    return "".join(chars)
+
+
+def random_pairs(seed, count, max_len, alphabet="abcde"):
+    """Random pairs, about half of them near-duplicates."""
+    rng = random.Random(seed)
+    pairs = []
+    for _ in range(count):
+        a = random_word(rng, rng.randrange(max_len + 1), alphabet)
+        if rng.random() < 0.5:
+            b = mutate(rng, a, rng.randrange(4), alphabet)
+        else:
+            b = random_word(rng, rng.randrange(max_len + 1), alphabet)
+        pairs.append((a, b))
+    return pairs
@@ -0,0 +1,45 @@
+"""Near-duplicate distances found by band doubling, against the reference.
+
+Past 32 characters the unbounded distances try bands of doubling width
+around the diagonal before filling the whole matrix, so pairs are built
+with distances on both sides of several band widths.
+"""
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+
+def near_duplicates(seed, count):
+    rng = random.Random(seed)
+    for _ in range(count):
+        a = reference.random_word(rng, rng.randrange(40, 220), "abcdefgh")
+        edits = rng.choice([0, 1, 2, 3, 5, 8, 9, 16, 17, 33, 60])
+        b = reference.mutate(rng, a, edits, "abcdefgh")
+        # shifts push the alignment off the diagonal
+        if rng.random() < 0.3:
+            b = reference.random_word(rng, rng.randrange(1, 20), "abcdefgh") + b
+        yield a, b
+
+
+class BandDoublingTest(unittest.TestCase):
+    def test_levenshtein(self):
+        for a, b in near_duplicates(49, 40):
+            self.assertEqual(cjellyfish.levenshtein_distance(a, b),
+                             reference.levenshtein(a, b), (a, b))
+            self.assertEqual(cjellyfish.levenshtein_distance(b, a),
+                             reference.levenshtein(a, b), (b, a))
+
+    def test_damerau_levenshtein(self):
+        for a, b in near_duplicates(490, 15):
+            self.assertEqual(cjellyfish.damerau_levenshtein_distance(a, b),
+                             reference.damerau_levenshtein(a, b), (a, b))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,67 @@
+"""The *_batch() functions against their scalar counterparts."""
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+PAIR_BATCHES = [
+    ("levenshtein_distance", "i"),
+    ("damerau_levenshtein_distance", "i"),
+    ("hamming_distance", "i"),
+    ("jaro_similarity", "d"),
+    ("jaro_winkler_similarity", "d"),
+]
+
+KEY_BATCHES = ["soundex", "metaphone", "nysiis", "match_rating_codex"]
+
+
+class BatchTest(unittest.TestCase):
+    def setUp(self):
+        pairs = reference.random_pairs(33, 500, 40, "abcdéf")
+        pairs += [("", ""), ("Zoë", "Zoe"), ("\U0001f600a", "a\U0001f600")]
+        self.s1 = [a for a, _ in pairs]
+        self.s2 = [b for _, b in pairs]
+
+    def test_pairs(self):
+        for name, fmt in PAIR_BATCHES:
+            scalar = getattr(cjellyfish, name)
+            batch = getattr(cjellyfish, name + "_batch")
+            expected = [scalar(a, b) for a, b in zip(self.s1, self.s2)]
+            for threads in (1, 4):
+                result = batch(self.s1, self.s2, threads=threads)
+                self.assertEqual(result.format, fmt)
+                self.assertEqual(result.tolist(), expected, (name, threads))
+            # any iterable, not only lists
+            self.assertEqual(batch(iter(self.s1), tuple(self.s2)).tolist(), expected)
+
+    def test_one_string_against_a_sequence(self):
+        for name, _ in PAIR_BATCHES:
+            scalar = getattr(cjellyfish, name)
+            batch = getattr(cjellyfish, name + "_batch")
+            self.assertEqual(
+                batch("abcde", self.s2, threads=3).tolist(),
+                [scalar("abcde", b) for b in self.s2],
+            )
+
+    def test_errors(self):
+        for name, _ in PAIR_BATCHES:
+            batch = getattr(cjellyfish, name + "_batch")
+            self.assertEqual(batch([], []).tolist(), [])
+            self.assertRaises(ValueError, batch, ["a"], ["a", "b"])
+            self.assertRaises(TypeError, batch, [b"a"], ["a"])
+
+    def test_keys(self):
+        words = [w for w in self.s1 if w.isalpha()] + ["Smith", "Schmidt", "Zoë", "MacDonald"]
+        for name in KEY_BATCHES:
+            scalar = getattr(cjellyfish, name)
+            batch = getattr(cjellyfish, name + "_batch")
+            self.assertEqual(batch(words), [scalar(w) for w in words], name)
+            self.assertEqual(batch(iter(words)), [scalar(w) for w in words], name)
+
+
+if __name__ == "__main__":
+    unittest.main()
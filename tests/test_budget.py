@@ -0,0 +1,53 @@
+"""The *_budget() distances against the unbudgeted ones."""
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+FUNCTIONS = [
+    (cjellyfish.levenshtein_distance_budget, cjellyfish.levenshtein_distance),
+    (cjellyfish.damerau_levenshtein_distance_budget, cjellyfish.damerau_levenshtein_distance),
+]
+
+
+class BudgetTest(unittest.TestCase):
+    def setUp(self):
+        self.pairs = reference.random_pairs(45, 300, 40) + [
+            ("", ""), ("abc", ""), ("ab" * 100, "ba" * 150), ("a" * 100, "b" * 300)
+        ]
+
+    def test_no_limit_is_exact(self):
+        for budgeted, exact in FUNCTIONS:
+            for a, b in self.pairs:
+                self.assertEqual(budgeted(a, b), (exact(a, b), False), (a, b))
+                self.assertEqual(
+                    budgeted(a, b, max_cells=len(a) * len(b)), (exact(a, b), False)
+                )
+
+    def test_exceeded_gives_a_lower_bound(self):
+        for budgeted, exact in FUNCTIONS:
+            for a, b in self.pairs:
+                distance = exact(a, b)
+                for max_cells in (1, 10, 100, 1000):
+                    result, exceeded = budgeted(a, b, max_cells=max_cells)
+                    if exceeded:
+                        self.assertLessEqual(result, distance, (a, b, max_cells))
+                        self.assertGreaterEqual(result, abs(len(a) - len(b)))
+                    else:
+                        self.assertEqual(result, distance, (a, b, max_cells))
+
+    def test_timeout(self):
+        a, b = "abcdefghij" * 200, "bacdefghij" * 200
+        for budgeted, exact in FUNCTIONS:
+            result, exceeded = budgeted(a, b, timeout=1e-6)
+            self.assertTrue(exceeded)
+            self.assertLessEqual(result, exact(a, b))
+            self.assertEqual(budgeted(a, b, timeout=60.0), (exact(a, b), False))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,56 @@
+"""sorted_neighborhood_pairs() against sorting and scanning in Python."""
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+
+def blocking_key(s, key):
+    code = cjellyfish.soundex(s) if key == "soundex" else cjellyfish.nysiis(s)
+    # eight bytes, one per character, clamped to 0xff
+    return [min(ord(c), 0xFF) for c in code[:8]] + [0] * (8 - len(code[:8]))
+
+
+def neighborhood(strings, key="soundex", window=10, min_score=0.9):
+    order = sorted(range(len(strings)), key=lambda i: blocking_key(strings[i], key))
+    pairs = []
+    for p, a in enumerate(order):
+        for b in order[p + 1:p + 1 + window]:
+            if cjellyfish.jaro_winkler_similarity(strings[a], strings[b]) >= min_score:
+                pairs.append((min(a, b), max(a, b)))
+    return pairs
+
+
+class SortedNeighborhoodTest(unittest.TestCase):
+    def setUp(self):
+        rng = random.Random(31)
+        names = ["Smith", "Smyth", "Schmidt", "Johnson", "Jonson", "Müller",
+                 "Mueller", "Miller", "Nguyen", "Ng", "O'Brien", "OBrien",
+                 "Zoë", "Zoe", "", "A", "Kowalski", "Kovalsky"]
+        self.strings = [rng.choice(names) + rng.choice(["", "", "s", "e", "son"])
+                        for _ in range(400)]
+
+    def test_matches_python(self):
+        for key in ("soundex", "nysiis"):
+            for window, min_score in ((1, 0.9), (5, 0.85), (30, 0.95)):
+                expected = neighborhood(self.strings, key, window, min_score)
+                self.assertTrue(expected)
+                for threads in (1, 3, 8):
+                    self.assertEqual(
+                        cjellyfish.sorted_neighborhood_pairs(
+                            self.strings, key=key, window=window,
+                            min_score=min_score, threads=threads,
+                        ),
+                        expected,
+                        (key, window, min_score, threads),
+                    )
+
+    def test_empty(self):
+        self.assertEqual(cjellyfish.sorted_neighborhood_pairs([]), [])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,106 @@
+"""pair_features() against the single-metric functions."""
+import itertools
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+# in output order
+FEATURES = ["levenshtein", "damerau_levenshtein", "jaro", "jaro_winkler", "hamming",
+            "match_rating", "soundex", "metaphone", "nysiis"]
+
+
+def single(name, a, b):
+    """The feature as the separate function computes it."""
+    if name == "match_rating":
+        result = cjellyfish.match_rating_comparison(a, b)
+        return -1.0 if result is None else float(result)
+    if name in ("soundex", "metaphone", "nysiis"):
+        key = getattr(cjellyfish, name)
+        return float(key(a) == key(b))
+    suffix = "_similarity" if name.startswith("jaro") else "_distance"
+    return float(getattr(cjellyfish, name + suffix)(a, b))
+
+
+def feature_pairs():
+    pairs = reference.random_pairs(44, 600, 16, "abcdeéhsmt")
+    pairs += [("", ""), ("", "abc"), ("Smith", "Smyth"), ("Zoë", "Zoe"),
+              ("MARTHA", "MARHTA"), ("Jellyfish" * 10, "Jellyfysh" * 10)]
+    return pairs
+
+
+class MetricFeatureTest(unittest.TestCase):
+    def test_all_features(self):
+        for a, b in feature_pairs():
+            expected = tuple(single(name, a, b) for name in FEATURES)
+            result = cjellyfish.pair_features(a, b)
+            self.assertEqual(len(result), len(FEATURES))
+            for name, x, y in zip(FEATURES, result, expected):
+                self.assertAlmostEqual(x, y, msg=(name, a, b))
+
+    def test_subsets_come_out_in_bit_order(self):
+        a, b = "Jonathan", "Johnathon"
+        for n in (1, 2, 3):
+            for names in itertools.combinations(FEATURES, n):
+                reordered = list(reversed(names))
+                result = cjellyfish.pair_features(a, b, reordered)
+                for name, x in zip(names, result):
+                    self.assertAlmostEqual(x, single(name, a, b), msg=names)
+
+    def test_batch_matches_scalar(self):
+        pairs = feature_pairs()
+        s1 = [a for a, _ in pairs]
+        s2 = [b for _, b in pairs]
+        for features in (None, ["jaro_winkler", "nysiis"], ["hamming"]):
+            expected = [list(cjellyfish.pair_features(a, b, features)) for a, b in pairs]
+            for threads in (1, 4):
+                self.assertEqual(
+                    cjellyfish.pair_features_batch(s1, s2, features, threads=threads).tolist(),
+                    expected,
+                )
+        self.assertEqual(cjellyfish.pair_features_batch([], []).tolist(), [])
+        self.assertRaises(ValueError, cjellyfish.pair_features, "a", "b", ["levenstein"])
+
+
+class PhoneticFeatureTest(unittest.TestCase):
+    def assertMatchesKeys(self, a, b):
+        names = ["soundex", "metaphone", "nysiis"]
+        expected = tuple(
+            float(getattr(cjellyfish, name)(a) == getattr(cjellyfish, name)(b))
+            for name in names
+        )
+        self.assertEqual(cjellyfish.pair_features(a, b, names), expected)
+        self.assertEqual(
+            tuple(cjellyfish.pair_features_batch([a], [b], names).tolist()[0]),
+            expected,
+        )
+
+    def test_keys_longer_than_phonetic_key_max(self):
+        # the keys only differ past their 63rd character
+        a = "Smith" + "bcd" * 30 + "x"
+        b = "Smith" + "bcd" * 30 + "q"
+        self.assertNotEqual(cjellyfish.metaphone(a), cjellyfish.metaphone(b))
+        self.assertNotEqual(cjellyfish.nysiis(a), cjellyfish.nysiis(b))
+        self.assertEqual(
+            cjellyfish.pair_features(a, b, ["metaphone", "nysiis"]), (0.0, 0.0)
+        )
+        self.assertMatchesKeys(a, b)
+        self.assertMatchesKeys(a, a[:-1] + "x")
+
+    def test_characters_outside_the_nfkd_table(self):
+        # U+FB01 (fi ligature) decomposes through unicodedata, not nfkd.c
+        self.assertEqual(
+            cjellyfish.pair_features("a\ufb01sh", "afish", ["soundex", "metaphone"]),
+            (1.0, 1.0),
+        )
+        self.assertMatchesKeys("a\ufb01sh", "afish")
+        self.assertMatchesKeys("\ufb01sh", "fist")
+        self.assertMatchesKeys("Zo\u00eb \ufb01ne", "Zoe fine")
+
+
+if __name__ == "__main__":
+    unittest.main()
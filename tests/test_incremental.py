@@ -0,0 +1,57 @@
+"""IncrementalQuery against recomputing every distance from scratch."""
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+
+class IncrementalQueryTest(unittest.TestCase):
+    def test_random_edits(self):
+        rng = random.Random(38)
+        alphabet = "abcdé\U0001f600"
+        candidates = [reference.random_word(rng, rng.randrange(20), alphabet)
+                      for _ in range(40)] + ["", "a" * 70]
+        inc = cjellyfish.IncrementalQuery(candidates)
+        self.assertEqual(len(inc), len(candidates))
+        query = ""
+        for _ in range(300):
+            if rng.random() < 0.55:
+                text = reference.random_word(rng, rng.randrange(1, 4), alphabet)
+                inc.push(text)
+                query += text
+            else:
+                n = rng.randrange(1, 4)
+                inc.pop(n)
+                query = query[:max(0, len(query) - n)]
+            self.assertEqual(inc.query, query)
+            self.assertEqual(
+                inc.distances(), [reference.levenshtein(query, c) for c in candidates], query
+            )
+
+    def test_long_query(self):
+        candidates = ["jellyfish" * 8, "jelly", ""]
+        inc = cjellyfish.IncrementalQuery(candidates)
+        for _ in range(10):
+            inc.push("jellyfysh")
+        self.assertEqual(
+            inc.distances(),
+            [cjellyfish.levenshtein_distance(inc.query, c) for c in candidates],
+        )
+        inc.pop()
+        self.assertEqual(inc.query, ("jellyfysh" * 10)[:-1])
+
+    def test_empty(self):
+        inc = cjellyfish.IncrementalQuery(["abc", ""])
+        self.assertEqual(inc.query, "")
+        self.assertEqual(inc.distances(), [3, 0])
+        inc.pop(3)
+        self.assertEqual(inc.distances(), [3, 0])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,42 @@
+"""jaro_winkler_similarity_threshold() against the unfiltered score."""
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+
+class JaroThresholdTest(unittest.TestCase):
+    def test_filters_agree_with_the_score(self):
+        pairs = reference.random_pairs(30, 1500, 14, "abcdefg")
+        pairs += [("MARTHA", "MARHTA"), ("DIXON", "DICKSONX"), ("", "abc"), ("a", "a")]
+        for a, b in pairs:
+            for long_tolerance in (0, 1):
+                score = cjellyfish.jaro_winkler_similarity(a, b, long_tolerance)
+                # the score itself sits right on the boundary
+                for min_score in (0.0, 0.5, 0.7, 0.8, 0.9, 0.95, 1.0, score):
+                    self.assertEqual(
+                        cjellyfish.jaro_winkler_similarity_threshold(
+                            a, b, min_score, long_tolerance
+                        ),
+                        score if score >= min_score else 0.0,
+                        (a, b, min_score, long_tolerance),
+                    )
+
+    def test_long_strings(self):
+        # length filters on strings past the small kernels
+        for a, b in reference.random_pairs(300, 200, 80, "abcdefghij"):
+            score = cjellyfish.jaro_winkler_similarity(a, b)
+            self.assertAlmostEqual(score, reference.jaro_winkler(a, b))
+            for min_score in (0.6, 0.85, score):
+                self.assertEqual(
+                    cjellyfish.jaro_winkler_similarity_threshold(a, b, min_score),
+                    score if score >= min_score else 0.0,
+                )
+
+
+if __name__ == "__main__":
+    unittest.main()
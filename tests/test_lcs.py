@@ -0,0 +1,74 @@
+"""Longest common subsequence and substring against dynamic programming."""
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+
+def leftmost_common_substring(s1, s2, length):
+    """(start1, start2) of the first length long substring of s2 that also
+    occurs in s1, taking the first occurrence in s1."""
+    for start2 in range(len(s2) - length + 1):
+        start1 = s1.find(s2[start2:start2 + length])
+        if start1 >= 0:
+            return start1, start2
+    return 0, 0
+
+
+class LCSTest(unittest.TestCase):
+    def assertLCS(self, a, b):
+        expected = reference.lcs_length(a, b)
+        self.assertEqual(cjellyfish.lcs_length(a, b), expected, (a, b))
+        self.assertEqual(cjellyfish.lcs_length(b, a), expected, (b, a))
+        total = len(a) + len(b)
+        self.assertAlmostEqual(
+            cjellyfish.lcs_similarity(a, b), 2.0 * expected / total if total else 0.0
+        )
+
+    def assertSubstring(self, a, b):
+        length = reference.longest_common_substring_length(a, b)
+        result = cjellyfish.longest_common_substring(a, b)
+        self.assertEqual(
+            result, (length,) + leftmost_common_substring(a, b, length), (a, b)
+        )
+        total = len(a) + len(b)
+        self.assertAlmostEqual(
+            cjellyfish.longest_common_substring_similarity(a, b),
+            2.0 * length / total if total else 0.0,
+        )
+
+    def test_empty(self):
+        self.assertEqual(cjellyfish.lcs_length("", ""), 0)
+        self.assertEqual(cjellyfish.lcs_length("abc", ""), 0)
+        self.assertEqual(cjellyfish.lcs_similarity("", ""), 0.0)
+        self.assertEqual(cjellyfish.longest_common_substring("", "abc"), (0, 0, 0))
+        self.assertEqual(cjellyfish.longest_common_substring_similarity("", ""), 0.0)
+
+    def test_short_pairs(self):
+        for a, b in reference.random_pairs(26, 1000, 20):
+            self.assertLCS(a, b)
+            self.assertSubstring(a, b)
+
+    def test_patterns_across_several_words(self):
+        # the bit-parallel recurrence carries between 64-bit blocks
+        for a, b in reference.random_pairs(260, 60, 200, "abcdefgh"):
+            self.assertLCS(a, b)
+            self.assertSubstring(a, b)
+
+    def test_wide_characters(self):
+        rng = random.Random(2026)
+        alphabet = "aé中\U0001f600\U00010348"
+        for _ in range(200):
+            a = reference.random_word(rng, rng.randrange(90), alphabet)
+            b = reference.mutate(rng, a, rng.randrange(6), alphabet)
+            self.assertLCS(a, b)
+            self.assertSubstring(a, b)
+
+
+if __name__ == "__main__":
+    unittest.main()
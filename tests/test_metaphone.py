@@ -0,0 +1,47 @@
+"""metaphone() against known codes.
+
+The expected codes were produced by the original character-by-character
+implementation and cover each of its special cases.
+"""
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+CODES = [
+    ("Aachen", "XN"), ("Aeneas", "ENS"), ("Gnome", "NM"), ("Knight", "NT"),
+    ("Pneumonia", "NMN"), ("Wright", "RT"), ("Xavier", "SFR"), ("Whale", "WL"),
+    ("Thompson", "0MPSN"), ("Schmidt", "SXMTT"), ("School", "SXL"),
+    ("Science", "SSNS"), ("Philip", "FLP"), ("Laugh", "L"), ("Night", "NT"),
+    ("Though", "0"), ("Hugh", "H"), ("Ghost", "KHST"), ("Gnat", "NT"),
+    ("Sign", "S"), ("Signed", "SKNT"), ("Dodge", "TJ"), ("Chris", "XRS"),
+    ("Character", "XRKTR"), ("Church", "XRX"), ("Machine", "MXN"), ("Which", "WX"),
+    ("Ciao", "X"), ("Cycle", "SKL"), ("Accident", "AKSTNT"), ("Back", "BK"),
+    ("Acquire", "AKKR"), ("Queue", "K"), ("Tiger", "TJR"), ("Tia", "X"),
+    ("Nation", "NXN"), ("Those", "0S"), ("Asia", "AX"), ("Mission", "MXN"),
+    ("Dumb", "TM"), ("Walk", "WLK"), ("Yellow", "YL"), ("Young", "YNK"),
+    ("Yacht", "YXT"), ("Gaelic", "KLK"), ("Cough", "K"), ("MacDonald", "MKTNLT"),
+    ("McGee", "MKJ"), ("O'Neil", "ONL"), ("Smith", "SM0"), ("Jellyfish", "JLFX"),
+    ("Ghislaine", "KHSLN"), ("Zoë", "S"),
+]
+
+
+class MetaphoneTest(unittest.TestCase):
+    def test_codes(self):
+        for word, code in CODES:
+            self.assertEqual(cjellyfish.metaphone(word), code, word)
+            self.assertEqual(cjellyfish.metaphone(word.lower()), code, word)
+            self.assertEqual(cjellyfish.metaphone(word.upper()), code, word)
+
+    def test_words_are_coded_separately(self):
+        self.assertEqual(cjellyfish.metaphone("Knight Wright"), "NT RT")
+        self.assertEqual(cjellyfish.metaphone(""), "")
+
+    def test_long_input(self):
+        self.assertEqual(cjellyfish.metaphone("Smith" * 200), "SM0" * 200)
+
+
+if __name__ == "__main__":
+    unittest.main()
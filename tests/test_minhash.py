@@ -0,0 +1,73 @@
+"""MinHash signatures against exact Jaccard, LSH against band comparison."""
+import array
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+
+def shingles(s, n):
+    if len(s) < n:
+        return {s} if s else set()
+    return {s[i:i + n] for i in range(len(s) - n + 1)}
+
+
+def rows(signatures, num_perm):
+    values = array.array("I", signatures)
+    return [values[i:i + num_perm] for i in range(0, len(values), num_perm)]
+
+
+class MinHashTest(unittest.TestCase):
+    def test_layout_and_seed(self):
+        strings = ["jellyfish", "jellyfsh", "", "a"]
+        sigs = cjellyfish.minhash_signatures(strings, num_perm=64)
+        self.assertEqual(len(sigs), 4 * 64 * 4)
+        self.assertEqual(sigs, cjellyfish.minhash_signatures(strings, num_perm=64))
+        self.assertNotEqual(sigs, cjellyfish.minhash_signatures(strings, num_perm=64, seed=2))
+        self.assertEqual(list(rows(sigs, 64)[2]), [0xFFFFFFFF] * 64)
+
+    def test_same_shingles_same_signature(self):
+        sig1, sig2 = rows(cjellyfish.minhash_signatures(["abcabc", "bcabca"]), 128)
+        self.assertEqual(sig1, sig2)
+
+    def test_estimates_jaccard(self):
+        rng = random.Random(29)
+        num_perm = 512
+        for _ in range(40):
+            a = reference.random_word(rng, rng.randrange(5, 40), "abcdefgh")
+            b = reference.mutate(rng, a, rng.randrange(8), "abcdefgh")
+            sig1, sig2 = rows(cjellyfish.minhash_signatures([a, b], num_perm=num_perm), num_perm)
+            estimate = sum(x == y for x, y in zip(sig1, sig2)) / num_perm
+            set1, set2 = shingles(a, 3), shingles(b, 3)
+            exact = len(set1 & set2) / len(set1 | set2)
+            self.assertAlmostEqual(estimate, exact, delta=0.1, msg=(a, b))
+
+    def test_lsh_matches_band_comparison(self):
+        rng = random.Random(290)
+        strings = [reference.random_word(rng, rng.randrange(3, 9), "abc") for _ in range(120)]
+        for num_perm, bands in ((16, 8), (16, 16), (30, 7), (8, 1)):
+            sigs = cjellyfish.minhash_signatures(strings, num_perm=num_perm, shingle=2)
+            sig = rows(sigs, num_perm)
+            width = num_perm // bands
+            expected = [
+                (i, j)
+                for i in range(len(strings))
+                for j in range(i + 1, len(strings))
+                if any(sig[i][b * width:(b + 1) * width] == sig[j][b * width:(b + 1) * width]
+                       for b in range(bands))
+            ]
+            self.assertEqual(cjellyfish.lsh_candidate_pairs(sigs, num_perm, bands), expected)
+
+    def test_lsh_bad_bands(self):
+        sigs = cjellyfish.minhash_signatures(["abc"], num_perm=4)
+        self.assertRaises(ValueError, cjellyfish.lsh_candidate_pairs, sigs, 4, 5)
+        self.assertRaises(ValueError, cjellyfish.lsh_candidate_pairs, sigs, 4, 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,41 @@
+"""Distances on either side of the 8-bit cell limit.
+
+Dissimilar pairs defeat the band search, so they are filled in a full
+matrix whose cell width depends on the lengths; distances close to 255
+are the ones that would wrap in a too-narrow cell.
+"""
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+
+class NarrowCellTest(unittest.TestCase):
+    def test_levenshtein(self):
+        rng = random.Random(46)
+        for len1, len2 in ((200, 240), (254, 254), (254, 255), (255, 255), (256, 300)):
+            a = reference.random_word(rng, len1, "abcd")
+            b = reference.random_word(rng, len2, "abcd")
+            self.assertEqual(cjellyfish.levenshtein_distance(a, b), reference.levenshtein(a, b))
+            # disjoint alphabets: the distance is the longer length
+            self.assertEqual(cjellyfish.levenshtein_distance("x" * len1, "y" * len2),
+                             max(len1, len2))
+
+    def test_damerau_levenshtein(self):
+        rng = random.Random(460)
+        for len1, len2 in ((100, 120), (127, 127), (127, 128), (128, 128), (150, 170)):
+            a = reference.random_word(rng, len1, "abcd")
+            b = reference.random_word(rng, len2, "abcd")
+            self.assertEqual(cjellyfish.damerau_levenshtein_distance(a, b),
+                             reference.damerau_levenshtein(a, b), (len1, len2))
+            self.assertEqual(cjellyfish.damerau_levenshtein_distance("x" * len1, "y" * len2),
+                             max(len1, len2))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,61 @@
+"""The native NFKD table against unicodedata."""
+import ctypes
+import unicodedata
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+RANGES = [(0x00, 0x300), (0x1DF0, 0x1F10)]
+
+
+def nfkd_latin():
+    try:
+        fn = ctypes.CDLL(cjellyfish.__file__).jfish_nfkd_latin
+    except (OSError, AttributeError):
+        return None
+    fn.argtypes = [ctypes.c_uint32, ctypes.POINTER(ctypes.c_uint32)]
+    fn.restype = ctypes.c_int
+    return fn
+
+
+class NFKDTableTest(unittest.TestCase):
+    def test_table_matches_unicodedata(self):
+        fn = nfkd_latin()
+        if fn is None:
+            self.skipTest("jfish_nfkd_latin is not exported by this build")
+        out = (ctypes.c_uint32 * 3)()
+        covered = 0
+        for lo, hi in RANGES:
+            for c in range(lo, hi):
+                n = fn(c, out)
+                if 0x80 <= c < 0xA0 or 0x250 <= c < 0x1E00 or c >= 0x1F00:
+                    self.assertEqual(n, 0, hex(c))
+                    continue
+                self.assertEqual(
+                    "".join(map(chr, out[:n])), unicodedata.normalize("NFKD", chr(c)), hex(c)
+                )
+                covered += 1
+        self.assertEqual(covered, 0x80 + 0x1B0 + 0x100)
+
+    def test_phonetic_keys_see_the_nfkd_form(self):
+        # soundex() only takes strings whose first letter decomposes to ASCII
+        decomposable = ["Zoë", "Ångström", "Şahin", "Ēriks", "Ỳvonne", "ǅenan",
+                        "Ĳsbrand", "Müller", "Ḿarta"]
+        other = ["Ðorđe", "Łukasz", "Øster", "Ƀill", "Ŋwa", "Æsop", "Œuvre"]
+        for word in decomposable:
+            nfkd = unicodedata.normalize("NFKD", word)
+            self.assertEqual(cjellyfish.soundex(word), cjellyfish.soundex(nfkd), word)
+            self.assertEqual(
+                cjellyfish.phonetic_keys(word, ["soundex", "metaphone"])[:2],
+                (cjellyfish.soundex(nfkd), cjellyfish.metaphone(nfkd)),
+            )
+        for word in decomposable + other:
+            nfkd = unicodedata.normalize("NFKD", word)
+            self.assertEqual(cjellyfish.metaphone(word), cjellyfish.metaphone(nfkd), word)
+
+
+if __name__ == "__main__":
+    unittest.main()
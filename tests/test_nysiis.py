@@ -0,0 +1,45 @@
+"""nysiis() against known codes.
+
+The expected codes were produced by the original implementation and cover
+each of its prefix, suffix and in-word rules.
+"""
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+CODES = [
+    ("Aachen", "ACAN"), ("Bishop", "BASAP"), ("Carlson", "CARLSAN"),
+    ("Knight", "NAGT"), ("Knuth", "NAT"), ("Kessler", "CASLAR"),
+    ("MacIntosh", "MCANT"), ("McKnight", "MCNAGT"), ("Philips", "FALAP"),
+    ("Phillipson", "FALAPSAN"), ("Schmidt", "SNAD"), ("Schoenberg", "SANBARG"),
+    ("Ghislaine", "GASLAN"), ("Wright", "WRAGT"), ("Evans", "EVAN"),
+    ("Jones", "JAN"), ("Hedges", "HADG"), ("Tsch", "TS"), ("Sch", "S"),
+    ("Pfeffer", "FAFAR"), ("Quinn", "QAN"), ("Strong", "STRANG"),
+    ("Sandee", "SANDY"), ("Sandie", "SANDY"), ("Hubbard", "HABAD"),
+    ("Richards", "RACARD"), ("Lloyd", "LAYD"), ("Dyke", "DYC"),
+    ("Yeager", "YAGAR"), ("Ex", "EX"), ("Ee", "Y"), ("Ie", "Y"), ("Dt", "D"),
+    ("Rt", "D"), ("Rd", "D"), ("Nt", "D"), ("Nd", "D"), ("O'Daniel", "O'DANAL"),
+    ("Watkins", "WATCAN"), ("Bowman", "BAONAN"), ("Jacobs", "JACAB"),
+    ("Shackleford", "SACLAFAD"), ("Reeves", "RAAF"),
+]
+
+
+class NYSIISTest(unittest.TestCase):
+    def test_codes(self):
+        for word, code in CODES:
+            self.assertEqual(cjellyfish.nysiis(word), code, word)
+            self.assertEqual(cjellyfish.nysiis(word.lower()), code, word)
+
+    def test_empty(self):
+        self.assertEqual(cjellyfish.nysiis(""), "")
+
+    def test_not_truncated(self):
+        # the Python function returns the full code, however long
+        self.assertEqual(cjellyfish.nysiis("Macintosh" * 50), "MCANT" + "ASNACANT" * 49)
+
+
+if __name__ == "__main__":
+    unittest.main()
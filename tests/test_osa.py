@@ -0,0 +1,28 @@
+"""osa_distance() against the full-matrix recurrence."""
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+
+class OSATest(unittest.TestCase):
+    def test_matches_reference(self):
+        pairs = reference.random_pairs(37, 1500, 14) + reference.random_pairs(370, 60, 120)
+        for a, b in pairs:
+            self.assertEqual(cjellyfish.osa_distance(a, b), reference.osa(a, b), (a, b))
+
+    def test_restricted_transpositions(self):
+        # OSA may not edit a transposed pair again; Damerau-Levenshtein may
+        self.assertEqual(cjellyfish.osa_distance("ca", "abc"), 3)
+        self.assertEqual(cjellyfish.damerau_levenshtein_distance("ca", "abc"), 2)
+        self.assertEqual(cjellyfish.osa_distance("abcd", "badc"), 2)
+        self.assertEqual(cjellyfish.osa_distance("", "abc"), 3)
+        self.assertEqual(cjellyfish.osa_distance("\U0001f600a", "a\U0001f600"), 1)
+
+
+if __name__ == "__main__":
+    unittest.main()
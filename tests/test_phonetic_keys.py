@@ -0,0 +1,57 @@
+"""phonetic_keys() against the separate phonetic functions."""
+import itertools
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+KEYS = ["soundex", "metaphone", "nysiis", "match_rating_codex"]
+
+NAMES = ["Smith", "Schmidt", "MacDonald", "McDonald", "Knight", "Phillips",
+         "Wright", "Thompson", "Zoë", "Müller", "Ångström", "O'Brien", "van der Berg",
+         "Xavier", "Ghislaine", "Schwarzenegger", "Lloyd", "Tsjechov", "aﬁsh",
+         "ǅenan", "Hugh", "Y", "", "Smith" + "bcd" * 30 + "x"]
+
+
+def words(seed, count):
+    rng = random.Random(seed)
+    letters = "aeiouybcdghklmnpqrstwxzAEKPSTCHGW '-"
+    return NAMES + ["".join(rng.choice(letters) for _ in range(rng.randrange(1, 14)))
+                    for _ in range(count)]
+
+
+class PhoneticKeysTest(unittest.TestCase):
+    def expected(self, word, keys):
+        return tuple(getattr(cjellyfish, k)(word) if k in keys else None for k in KEYS)
+
+    def test_all_keys(self):
+        for word in words(39, 1000):
+            self.assertEqual(cjellyfish.phonetic_keys(word), self.expected(word, KEYS), word)
+
+    def test_key_subsets(self):
+        for n in range(1, 5):
+            for keys in itertools.combinations(KEYS, n):
+                for word in NAMES:
+                    self.assertEqual(
+                        cjellyfish.phonetic_keys(word, list(keys)),
+                        self.expected(word, keys),
+                        (word, keys),
+                    )
+
+    def test_batch(self):
+        batch = words(390, 700)
+        for keys in (None, ["nysiis"], ["soundex", "match_rating_codex"]):
+            self.assertEqual(
+                cjellyfish.phonetic_keys_batch(batch, keys),
+                [cjellyfish.phonetic_keys(word, keys) for word in batch],
+            )
+
+    def test_unknown_key(self):
+        self.assertRaises(ValueError, cjellyfish.phonetic_keys, "Smith", ["soundx"])
+
+
+if __name__ == "__main__":
+    unittest.main()
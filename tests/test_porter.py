@@ -0,0 +1,89 @@
+"""porter_stem() against the reference outputs.
+
+VOCABULARY is the start of Martin Porter's sample vocabulary (voc.txt)
+with the stems his reference implementation produces (output.txt); PAPER
+holds the examples from the 1980 paper.
+"""
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+VOCABULARY = [
+    ("a", "a"), ("aaron", "aaron"), ("abaissiez", "abaissiez"),
+    ("abandon", "abandon"), ("abandoned", "abandon"), ("abase", "abas"),
+    ("abash", "abash"), ("abate", "abat"), ("abated", "abat"), ("abatement", "abat"),
+    ("abatements", "abat"), ("abates", "abat"), ("abbess", "abbess"),
+    ("abbey", "abbei"), ("abbeys", "abbei"), ("abbominable", "abbomin"),
+    ("abbot", "abbot"), ("abbots", "abbot"), ("abbreviated", "abbrevi"),
+    ("abed", "ab"), ("abel", "abel"), ("aberga", "aberga"),
+    ("abergavenny", "abergavenni"), ("abet", "abet"), ("abetting", "abet"),
+    ("abhominable", "abhomin"), ("abhor", "abhor"), ("abhorr", "abhorr"),
+    ("abhorred", "abhor"), ("abhorring", "abhor"), ("abhors", "abhor"),
+    ("abhorson", "abhorson"), ("abide", "abid"), ("abides", "abid"),
+    ("abilities", "abil"), ("ability", "abil"), ("abject", "abject"),
+    ("abjectly", "abjectli"), ("abjects", "abject"), ("abjur", "abjur"),
+    ("abjure", "abjur"), ("able", "abl"), ("abler", "abler"), ("aboard", "aboard"),
+    ("abode", "abod"), ("aboded", "abod"), ("abodements", "abod"),
+    ("aboding", "abod"), ("abominable", "abomin"), ("abominably", "abomin"),
+    ("abominations", "abomin"), ("abortive", "abort"), ("abortives", "abort"),
+    ("abound", "abound"), ("abounding", "abound"), ("about", "about"),
+    ("above", "abov"), ("abr", "abr"), ("abraham", "abraham"), ("abram", "abram"),
+    ("abreast", "abreast"), ("abridg", "abridg"), ("abridge", "abridg"),
+    ("abridged", "abridg"), ("abridgment", "abridg"), ("abroach", "abroach"),
+    ("abroad", "abroad"), ("abrogate", "abrog"), ("abrook", "abrook"),
+    ("abrupt", "abrupt"), ("abruption", "abrupt"), ("abruptly", "abruptli"),
+    ("absence", "absenc"), ("absent", "absent"), ("absey", "absei"),
+    ("absolute", "absolut"), ("absolutely", "absolut"), ("absolv", "absolv"),
+    ("absolver", "absolv"), ("abstains", "abstain"), ("abstemious", "abstemi"),
+    ("abstinence", "abstin"), ("abstract", "abstract"), ("absurd", "absurd"),
+    ("abuse", "abus"), ("abused", "abus"), ("abuses", "abus"), ("abusing", "abus"),
+]
+
+PAPER = [
+    ("caresses", "caress"), ("ponies", "poni"), ("ties", "ti"), ("caress", "caress"),
+    ("cats", "cat"), ("feed", "feed"), ("agreed", "agre"), ("plastered", "plaster"),
+    ("bled", "bled"), ("motoring", "motor"), ("sing", "sing"),
+    ("conflated", "conflat"), ("troubled", "troubl"), ("sized", "size"),
+    ("hopping", "hop"), ("tanned", "tan"), ("falling", "fall"), ("hissing", "hiss"),
+    ("fizzed", "fizz"), ("failing", "fail"), ("filing", "file"), ("happy", "happi"),
+    ("sky", "sky"), ("relational", "relat"), ("conditional", "condit"),
+    ("rational", "ration"), ("valenci", "valenc"), ("hesitanci", "hesit"),
+    ("digitizer", "digit"), ("conformabli", "conform"), ("radicalli", "radic"),
+    ("differentli", "differ"), ("vileli", "vile"), ("analogousli", "analog"),
+    ("vietnamization", "vietnam"), ("predication", "predic"), ("operator", "oper"),
+    ("feudalism", "feudal"), ("decisiveness", "decis"), ("hopefulness", "hope"),
+    ("callousness", "callous"), ("formaliti", "formal"), ("sensitiviti", "sensit"),
+    ("sensibiliti", "sensibl"), ("triplicate", "triplic"), ("formative", "form"),
+    ("formalize", "formal"), ("electriciti", "electr"), ("electrical", "electr"),
+    ("hopeful", "hope"), ("goodness", "good"), ("revival", "reviv"),
+    ("allowance", "allow"), ("inference", "infer"), ("airliner", "airlin"),
+    ("gyroscopic", "gyroscop"), ("adjustable", "adjust"), ("defensible", "defens"),
+    ("irritant", "irrit"), ("replacement", "replac"), ("adjustment", "adjust"),
+    ("dependent", "depend"), ("adoption", "adopt"), ("homologou", "homolog"),
+    ("communism", "commun"), ("activate", "activ"), ("angulariti", "angular"),
+    ("homologous", "homolog"), ("effective", "effect"), ("bowdlerize", "bowdler"),
+    ("probate", "probat"), ("rate", "rate"), ("cease", "ceas"),
+    ("controll", "control"), ("roll", "roll"), ("generalizations", "gener"),
+    ("oscillators", "oscil"),
+]
+
+
+class PorterTest(unittest.TestCase):
+    def test_vocabulary(self):
+        for word, stem in VOCABULARY:
+            self.assertEqual(cjellyfish.porter_stem(word), stem, word)
+
+    def test_paper_examples(self):
+        for word, stem in PAPER:
+            self.assertEqual(cjellyfish.porter_stem(word), stem, word)
+
+    def test_short_words_are_left_alone(self):
+        for word in ("", "a", "is", "as"):
+            self.assertEqual(cjellyfish.porter_stem(word), word)
+
+
+if __name__ == "__main__":
+    unittest.main()
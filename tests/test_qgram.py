@@ -0,0 +1,51 @@
+"""QGramIndex.search() against a brute-force scan."""
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+
+def brute_force(words, query, max_distance):
+    found = [(reference.levenshtein(query, w), i) for i, w in enumerate(words)]
+    return [(i, d) for d, i in sorted(found) if d <= max_distance]
+
+
+class QGramIndexTest(unittest.TestCase):
+    def setUp(self):
+        rng = random.Random(28)
+        base = [reference.random_word(rng, rng.randrange(1, 12), "abcdef")
+                for _ in range(150)]
+        # near-duplicates, repeats and the empty string
+        self.words = base + [reference.mutate(rng, w, 1, "abcdef") for w in base[:80]]
+        self.words += base[:10] + [""]
+        self.queries = [reference.mutate(rng, rng.choice(self.words), rng.randrange(3), "abcdef")
+                        for _ in range(60)] + ["", "a", "zzzz"]
+
+    def test_matches_brute_force(self):
+        for q in (1, 2, 3):
+            index = cjellyfish.QGramIndex(self.words, q=q)
+            self.assertEqual(len(index), len(self.words))
+            for query in self.queries:
+                for max_distance in (0, 1, 2, 3):
+                    self.assertEqual(
+                        index.search(query, max_distance),
+                        brute_force(self.words, query, max_distance),
+                        (q, query, max_distance),
+                    )
+
+    def test_more_matches_than_the_first_buffer(self):
+        words = ["ab", "ba", "aa", "bb"] * 40
+        index = cjellyfish.QGramIndex(words)
+        self.assertEqual(index.search("ab", 2), brute_force(words, "ab", 2))
+
+    def test_negative_distance(self):
+        self.assertEqual(cjellyfish.QGramIndex(["abc"]).search("abc", -1), [])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,55 @@
+"""Query methods against the module functions."""
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+METHODS = ["levenshtein_distance", "damerau_levenshtein_distance", "hamming_distance",
+           "jaro_similarity", "jaro_winkler_similarity"]
+
+
+class QueryTest(unittest.TestCase):
+    def assertQuery(self, query, candidates):
+        compiled = cjellyfish.Query(query)
+        self.assertEqual(compiled.string, query)
+        for candidate in candidates:
+            for name in METHODS:
+                self.assertEqual(
+                    getattr(compiled, name)(candidate),
+                    getattr(cjellyfish, name)(query, candidate),
+                    (name, query, candidate),
+                )
+            self.assertEqual(
+                compiled.jaro_winkler_similarity(candidate, True),
+                cjellyfish.jaro_winkler_similarity(query, candidate, True),
+            )
+
+    def test_short_queries(self):
+        rng = random.Random(34)
+        for _ in range(100):
+            query = reference.random_word(rng, rng.randrange(12), "abcdé")
+            candidates = [reference.mutate(rng, query, rng.randrange(4), "abcdé")
+                          for _ in range(10)] + ["", "xyz"]
+            self.assertQuery(query, candidates)
+
+    def test_long_queries(self):
+        # queries past one 64-bit word of pattern bitmasks
+        rng = random.Random(340)
+        for length in (63, 64, 65, 130, 300):
+            query = reference.random_word(rng, length, "abcdefgh\U0001f600")
+            candidates = [reference.mutate(rng, query, rng.randrange(20), "abcdefgh\U0001f600")
+                          for _ in range(6)] + ["", query[:10]]
+            self.assertQuery(query, candidates)
+
+    def test_bytes_rejected(self):
+        self.assertRaises(TypeError, cjellyfish.Query, b"abc")
+        self.assertRaises(TypeError, cjellyfish.Query("abc").levenshtein_distance, b"abc")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,60 @@
+"""approximate_search() against Sellers' dynamic programming."""
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+
+def sellers(pattern, text, max_distance):
+    """(end, distance) for every end whose best match is within reach."""
+    column = list(range(len(pattern) + 1))
+    found = [(0, column[-1])] if column[-1] <= max_distance else []
+    for end, c in enumerate(text, 1):
+        # a match may start anywhere, so the top cell is always 0
+        new = [0]
+        for i, p in enumerate(pattern, 1):
+            new.append(min(column[i] + 1, new[i - 1] + 1, column[i - 1] + (p != c)))
+        column = new
+        if column[-1] <= max_distance:
+            found.append((end, column[-1]))
+    return found
+
+
+class ApproximateSearchTest(unittest.TestCase):
+    def assertSearch(self, pattern, text, max_distance):
+        self.assertEqual(
+            cjellyfish.approximate_search(pattern, text, max_distance),
+            sellers(pattern, text, max_distance),
+            (pattern, text, max_distance),
+        )
+
+    def test_short_patterns(self):
+        rng = random.Random(47)
+        for _ in range(300):
+            text = reference.random_word(rng, rng.randrange(60), "abcd")
+            pattern = reference.random_word(rng, rng.randrange(8), "abcd")
+            for max_distance in (0, 1, 2, 4):
+                self.assertSearch(pattern, text, max_distance)
+
+    def test_patterns_over_several_words(self):
+        # the bit-parallel scan keeps one 64-bit block per 64 pattern characters
+        rng = random.Random(470)
+        for length in (63, 64, 65, 100, 129):
+            pattern = reference.random_word(rng, length, "abcdefgh")
+            text = (reference.random_word(rng, 80, "abcdefgh")
+                    + reference.mutate(rng, pattern, 6, "abcdefgh")
+                    + reference.random_word(rng, 80, "abcdefgh"))
+            for max_distance in (0, 3, 10, 40):
+                self.assertSearch(pattern, text, max_distance)
+
+    def test_wide_characters(self):
+        self.assertSearch("\U0001f600é", "a\U0001f600eé\U0001f600é", 1)
+
+
+if __name__ == "__main__":
+    unittest.main()
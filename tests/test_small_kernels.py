@@ -0,0 +1,51 @@
+"""The fixed-size kernels against the reference at every length up to 40.
+
+Lengths on both sides of 8, 16 and 32 go through different kernels (and
+pairs with one side past a threshold through the generic path), so every
+combination of lengths is tried.
+"""
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+
+class SmallKernelTest(unittest.TestCase):
+    def pairs(self, seed):
+        rng = random.Random(seed)
+        for len1 in range(41):
+            for len2 in range(max(0, len1 - 9), min(40, len1 + 9) + 1):
+                a = reference.random_word(rng, len1, "abcdé\U0001f600")
+                b = reference.random_word(rng, len2, "abcdé\U0001f600")
+                if len1 == len2 and rng.random() < 0.5:
+                    b = reference.mutate(rng, a, 3, "abcd")[:len2]
+                yield a, b
+
+    def test_levenshtein(self):
+        for a, b in self.pairs(36):
+            self.assertEqual(cjellyfish.levenshtein_distance(a, b),
+                             reference.levenshtein(a, b), (a, b))
+
+    def test_damerau_levenshtein(self):
+        for a, b in self.pairs(360):
+            self.assertEqual(cjellyfish.damerau_levenshtein_distance(a, b),
+                             reference.damerau_levenshtein(a, b), (a, b))
+
+    def test_jaro_winkler(self):
+        for a, b in self.pairs(3600):
+            for long_tolerance in (False, True):
+                self.assertAlmostEqual(
+                    cjellyfish.jaro_winkler_similarity(a, b, long_tolerance),
+                    reference.jaro_winkler(a, b, long_tolerance),
+                    msg=(a, b, long_tolerance),
+                )
+            self.assertAlmostEqual(cjellyfish.jaro_similarity(a, b), reference.jaro(a, b))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,62 @@
+"""SymSpellIndex.search() against a brute-force scan."""
+import functools
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+
+distance = functools.lru_cache(maxsize=None)(reference.damerau_levenshtein)
+
+
+def brute_force(words, query, max_distance):
+    found = [(distance(query, w), i) for i, w in enumerate(words)]
+    return [(i, d) for d, i in sorted(found) if d <= max_distance]
+
+
+class SymSpellIndexTest(unittest.TestCase):
+    def setUp(self):
+        rng = random.Random(50)
+        base = [reference.random_word(rng, rng.randrange(1, 10), "abcdef")
+                for _ in range(120)]
+        self.words = base + [reference.mutate(rng, w, rng.randrange(1, 3), "abcdef")
+                             for w in base[:80]] + base[:5] + [""]
+        self.queries = [reference.mutate(rng, rng.choice(self.words), rng.randrange(4), "abcdef")
+                        for _ in range(50)] + ["", "ca", "zzzz"]
+
+    def test_matches_brute_force(self):
+        for index_distance in (1, 2, 3):
+            index = cjellyfish.SymSpellIndex(self.words, max_distance=index_distance)
+            self.assertEqual(len(index), len(self.words))
+            for query in self.queries:
+                self.assertEqual(index.search(query),
+                                 brute_force(self.words, query, index_distance), query)
+                for max_distance in range(index_distance):
+                    self.assertEqual(
+                        index.search(query, max_distance),
+                        brute_force(self.words, query, max_distance),
+                        (index_distance, query, max_distance),
+                    )
+
+    def test_transpositions_with_edits_between(self):
+        # "ca" -> "abc" takes a transposition and an insertion between
+        index = cjellyfish.SymSpellIndex(["abc"], max_distance=2)
+        self.assertEqual(index.search("ca"), [(0, 2)])
+
+    def test_more_matches_than_the_first_buffer(self):
+        words = ["ab", "ba", "aa", "bb"] * 40
+        index = cjellyfish.SymSpellIndex(words)
+        self.assertEqual(index.search("ab"), brute_force(words, "ab", 2))
+
+    def test_distance_above_the_index(self):
+        index = cjellyfish.SymSpellIndex(["abc"], max_distance=1)
+        self.assertRaises(ValueError, index.search, "abc", 2)
+
+
+if __name__ == "__main__":
+    unittest.main()
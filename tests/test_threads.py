@@ -0,0 +1,35 @@
+"""Regression tests for thread counts above the worker pool's limit.
+
+Run against a built extension:  python -m unittest discover tests
+"""
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+
+NAMES = ["Émile", "Emile", "Emil", "Smith", "Smyth", "Schmidt",
+         "Müller", "Mueller", "Miller", "Jon", "John", "Joan"] * 40
+
+
+class ThreadLimitTest(unittest.TestCase):
+    def test_topk_more_threads_than_pool(self):
+        expected = cjellyfish.topk("Smith", NAMES, 5, threads=1)
+        for threads in (256, 300, 1000):
+            self.assertEqual(
+                cjellyfish.topk("Smith", NAMES, 5, threads=threads), expected
+            )
+
+    def test_sorted_neighborhood_more_threads_than_pool(self):
+        expected = cjellyfish.sorted_neighborhood_pairs(NAMES, threads=1)
+        for threads in (300, 1000):
+            self.assertEqual(
+                cjellyfish.sorted_neighborhood_pairs(NAMES, threads=threads),
+                expected,
+            )
+
+
+if __name__ == "__main__":
+    unittest.main()
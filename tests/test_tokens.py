@@ -0,0 +1,99 @@
+"""Token sort, set and alignment scorers against their definitions."""
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+METRICS = ("levenshtein", "jaro_winkler")
+
+
+def tokens(s):
+    out, word = [], ""
+    for c in s:
+        if c.isalnum():
+            word += c
+        elif word:
+            out.append(word)
+            word = ""
+    return out + [word] if word else out
+
+
+def score(metric, a, b):
+    if not a or not b:
+        return 0.0
+    if metric == "jaro_winkler":
+        return reference.jaro_winkler(a, b)
+    return 1.0 - reference.levenshtein(a, b) / max(len(a), len(b))
+
+
+def token_sort(a, b, metric):
+    return score(metric, " ".join(sorted(tokens(a))), " ".join(sorted(tokens(b))))
+
+
+def token_set(a, b, metric):
+    set1, set2 = set(tokens(a)), set(tokens(b))
+    t0 = " ".join(sorted(set1 & set2))
+    t1 = " ".join([t0] * bool(t0) + sorted(set1 - set2))
+    t2 = " ".join([t0] * bool(t0) + sorted(set2 - set1))
+    return max(score(metric, t0, t1), score(metric, t0, t2), score(metric, t1, t2))
+
+
+def token_alignment(a, b, metric):
+    words1, words2 = tokens(a), tokens(b)
+    if len(words1) > len(words2):
+        words1, words2 = words2, words1
+    if not words1:
+        return 0.0
+    return sum(
+        max([score(metric, w1, w2) for w2 in words2] + [0.0]) for w1 in words1
+    ) / len(words1)
+
+
+def phrases(seed, count):
+    rng = random.Random(seed)
+    words = ["john", "jon", "smith", "smyth", "jr", "ann", "anne", "de",
+             "la", "cruz", "o'neil", "oneil", "müller", "mueller", "42"]
+    out = []
+    for _ in range(count):
+        a = [rng.choice(words) for _ in range(rng.randrange(5))]
+        b = rng.sample(a, len(a)) if rng.random() < 0.5 else list(a)
+        if b and rng.random() < 0.7:
+            b[rng.randrange(len(b))] = rng.choice(words)
+        if rng.random() < 0.3:
+            b.append(rng.choice(words))
+        out.append((rng.choice([" ", ", ", "-"]).join(a), "  ".join(b)))
+    return out
+
+
+class TokenTest(unittest.TestCase):
+    def assertScorer(self, function, expected):
+        for a, b in phrases(27, 400) + [("", ""), ("a b", ""), ("...", "a")]:
+            for metric in METRICS:
+                self.assertAlmostEqual(
+                    function(a, b, metric=metric), expected(a, b, metric),
+                    msg=(a, b, metric),
+                )
+
+    def test_token_sort(self):
+        self.assertScorer(cjellyfish.token_sort_similarity, token_sort)
+
+    def test_token_set(self):
+        self.assertScorer(cjellyfish.token_set_similarity, token_set)
+
+    def test_token_alignment(self):
+        self.assertScorer(cjellyfish.token_alignment_similarity, token_alignment)
+
+    def test_word_order_does_not_matter(self):
+        for function in (cjellyfish.token_sort_similarity,
+                         cjellyfish.token_set_similarity,
+                         cjellyfish.token_alignment_similarity):
+            self.assertEqual(function("John Smith", "smith, John".title()), 1.0)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,53 @@
+"""topk() against scoring and sorting every candidate."""
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+
+def brute_force(query, candidates, k, metric):
+    if metric == "jaro_winkler":
+        scored = [(-cjellyfish.jaro_winkler_similarity(query, c), i)
+                  for i, c in enumerate(candidates)]
+        return [(i, -s) for s, i in sorted(scored)[:k]]
+    scored = [(cjellyfish.levenshtein_distance(query, c), i) for i, c in enumerate(candidates)]
+    return [(i, s) for s, i in sorted(scored)[:k]]
+
+
+class TopKTest(unittest.TestCase):
+    def setUp(self):
+        rng = random.Random(35)
+        base = [reference.random_word(rng, rng.randrange(1, 15), "abcdef") for _ in range(50)]
+        # lots of ties, so the lower-index rule is exercised
+        self.candidates = [reference.mutate(rng, rng.choice(base), rng.randrange(4), "abcdef")
+                           for _ in range(600)] + [""]
+        self.queries = [rng.choice(base) for _ in range(15)] + ["", "f" * 80]
+
+    def test_matches_brute_force(self):
+        for metric in ("levenshtein", "jaro_winkler"):
+            for query in self.queries:
+                for k in (1, 5, 40):
+                    expected = brute_force(query, self.candidates, k, metric)
+                    for threads in (1, 4):
+                        self.assertEqual(
+                            cjellyfish.topk(query, self.candidates, k, metric=metric,
+                                            threads=threads),
+                            expected,
+                            (metric, query, k, threads),
+                        )
+
+    def test_k_out_of_range(self):
+        self.assertEqual(cjellyfish.topk("abc", [], 3), [])
+        self.assertEqual(cjellyfish.topk("abc", ["abc"], 0), [])
+        self.assertEqual(
+            cjellyfish.topk("abc", ["abd", "abc"], 10), [(1, 0), (0, 1)]
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
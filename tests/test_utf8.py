@@ -0,0 +1,84 @@
+"""The UTF-8 C entry points against the str functions.
+
+These functions are not wrapped for Python; they are reached through
+ctypes on the extension module and skipped if it does not export them.
+"""
+import ctypes
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+FUNCTIONS = [
+    ("levenshtein_distance", ctypes.c_int),
+    ("damerau_levenshtein_distance", ctypes.c_int),
+    ("osa_distance", ctypes.c_int),
+    ("hamming_distance", ctypes.c_size_t),
+    ("jaro_similarity", ctypes.c_double),
+]
+
+
+def utf8_functions():
+    try:
+        lib = ctypes.CDLL(cjellyfish.__file__)
+        functions = {name: getattr(lib, name + "_utf8") for name, _ in FUNCTIONS}
+        functions["jaro_winkler_similarity"] = lib.jaro_winkler_similarity_utf8
+    except (OSError, AttributeError):
+        return None
+    args = [ctypes.c_char_p, ctypes.c_size_t, ctypes.c_char_p, ctypes.c_size_t]
+    for name, restype in FUNCTIONS:
+        functions[name].argtypes = args
+        functions[name].restype = restype
+    functions["jaro_winkler_similarity"].argtypes = args + [ctypes.c_int]
+    functions["jaro_winkler_similarity"].restype = ctypes.c_double
+    return functions
+
+
+def byte_pairs():
+    pairs = [(a.encode(), b.encode()) for a, b in reference.random_pairs(42, 400, 20)]
+    pairs += [(a.encode(), b.encode()) for a, b in reference.random_pairs(420, 50, 150)]
+    # multi-byte characters, then malformed sequences
+    alphabet = "aé中\U0001f600"
+    pairs += [(a.encode(), b.encode()) for a, b in reference.random_pairs(4200, 300, 20, alphabet)]
+    rng = random.Random(42000)
+    for _ in range(200):
+        a = bytes(rng.choice(b"ab\xc3\xa9\x80\xff\xe4") for _ in range(rng.randrange(12)))
+        b = bytes(rng.choice(b"ab\xc3\xa9\x80\xff\xe4") for _ in range(rng.randrange(12)))
+        pairs.append((a, b))
+    return pairs
+
+
+class UTF8Test(unittest.TestCase):
+    def setUp(self):
+        self.functions = utf8_functions()
+        if self.functions is None:
+            self.skipTest("the *_utf8 functions are not exported by this build")
+
+    def test_matches_str_functions(self):
+        for a, b in byte_pairs():
+            # invalid bytes decode to lone surrogates, like surrogateescape
+            u1 = a.decode("utf-8", "surrogateescape")
+            u2 = b.decode("utf-8", "surrogateescape")
+            for name, _ in FUNCTIONS:
+                expected = getattr(cjellyfish, name)(u1, u2)
+                result = self.functions[name](a, len(a), b, len(b))
+                if isinstance(expected, float):
+                    self.assertAlmostEqual(result, expected, msg=(name, a, b))
+                else:
+                    self.assertEqual(result, expected, (name, a, b))
+            for long_tolerance in (0, 1):
+                self.assertAlmostEqual(
+                    self.functions["jaro_winkler_similarity"](a, len(a), b, len(b),
+                                                              long_tolerance),
+                    cjellyfish.jaro_winkler_similarity(u1, u2, long_tolerance),
+                    msg=(a, b),
+                )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,41 @@
+"""levenshtein_distance_parallel() against the serial distance."""
+import random
+import unittest
+
+try:
+    from jellyfish import cjellyfish
+except ImportError:
+    import cjellyfish
+
+import reference
+
+
+class WavefrontTest(unittest.TestCase):
+    def test_matches_reference(self):
+        for a, b in reference.random_pairs(48, 40, 300, "abcd"):
+            expected = reference.levenshtein(a, b)
+            for threads in (1, 2, 3, 8):
+                self.assertEqual(
+                    cjellyfish.levenshtein_distance_parallel(a, b, threads=threads),
+                    expected,
+                    (len(a), len(b), threads),
+                )
+
+    def test_long_pairs(self):
+        # several 1024-character tiles in each direction, partial edge tiles
+        rng = random.Random(480)
+        a = reference.random_word(rng, 5000, "abcdefgh")
+        for b in (reference.mutate(rng, a, 300, "abcdefgh"),
+                  reference.random_word(rng, 3000, "abcdefgh"), a[:1], ""):
+            expected = cjellyfish.levenshtein_distance(a, b)
+            for threads in (1, 4, 300):
+                self.assertEqual(
+                    cjellyfish.levenshtein_distance_parallel(a, b, threads=threads), expected
+                )
+                self.assertEqual(
+                    cjellyfish.levenshtein_distance_parallel(b, a, threads=threads), expected
+                )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,327 @@
+#include "jellyfish.h"
+#include <string.h>
+#include <stdlib.h>
+
+/*
+  Token-based scorers.
+
+  Strings are split into runs of alphanumeric characters; everything else
+  (whitespace, punctuation) separates tokens.  Tokens are spans into the
+  original buffer so tokenizing never copies or allocates, and each scorer
+  makes a single workspace allocation for the token arrays and the joined
+  strings it hands to the underlying metric.  The alignment scorer compiles
+  one jellyfish_query per token of the side with fewer tokens and scores
+  every token of the other side through it.
+*/
+
+struct token_ref {
+    const JFISH_UNICODE *str;
+    int len;
+};
+
+
+int jfish_tokenize(const JFISH_UNICODE *str, int len, struct jfish_token *tokens, int max_tokens)
+{
+    int i = 0, start, count = 0;
+
+    while (i < len) {
+        while (i < len && !ISALNUM(str[i])) {
+            i++;
+        }
+        if (i == len) {
+            break;
+        }
+        start = i;
+        while (i < len && ISALNUM(str[i])) {
+            i++;
+        }
+        if (count < max_tokens) {
+            tokens[count].start = start;
+            tokens[count].len = i - start;
+        }
+        count++;
+    }
+
+    return count;
+}
+
+
+static int token_cmp(const struct token_ref *a, const struct token_ref *b)
+{
+    int i, n = MIN(a->len, b->len);
+
+    for (i = 0; i < n; i++) {
+        if (a->str[i] != b->str[i]) {
+            return a->str[i] < b->str[i] ? -1 : 1;
+        }
+    }
+    return a->len - b->len;
+}
+
+
+static int token_qsort_cmp(const void *a, const void *b)
+{
+    return token_cmp(a, b);
+}
+
+
+/* Tokenize into refs and return the count.  spans is scratch for
+ * jfish_tokenize(); both are sized for the worst case, len / 2 + 1. */
+static int token_refs(const JFISH_UNICODE *str, int len, struct jfish_token *spans,
+                      struct token_ref *refs)
+{
+    int i, n;
+
+    n = jfish_tokenize(str, len, spans, len / 2 + 1);
+    for (i = 0; i < n; i++) {
+        refs[i].str = str + spans[i].start;
+        refs[i].len = spans[i].len;
+    }
+    return n;
+}
+
+
+/* Join refs with single spaces, appending to out at offset pos. */
+static int token_join(JFISH_UNICODE *out, int pos, const struct token_ref *refs, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        if (pos) {
+            out[pos++] = ' ';
+        }
+        memcpy(out + pos, refs[i].str, refs[i].len * sizeof(JFISH_UNICODE));
+        pos += refs[i].len;
+    }
+    return pos;
+}
+
+
+static double token_score(int metric, const JFISH_UNICODE *s1, int len1,
+                          const JFISH_UNICODE *s2, int len2)
+{
+    int dist;
+
+    if (!len1 || !len2) return 0;
+
+    if (metric == JFISH_TOKEN_JARO_WINKLER) {
+        return jaro_winkler_similarity(s1, len1, s2, len2, 0);
+    }
+
+    dist = levenshtein_distance(s1, len1, s2, len2);
+    if (dist < 0) {
+        return -100;
+    }
+    return 1.0 - (double)dist / (len1 > len2 ? len1 : len2);
+}
+
+
+/* One allocation: worst-case token refs for both strings, the spans
+ * jfish_tokenize() writes for either of them (separate from the refs, which
+ * have a different layout), then `buffers` join buffers large enough for
+ * either string. */
+static void* token_workspace(int len1, int len2, int buffers,
+                             struct token_ref **refs1, struct token_ref **refs2,
+                             struct jfish_token **spans, JFISH_UNICODE **joined)
+{
+    size_t nrefs = (size_t)(len1 / 2 + 1) + (len2 / 2 + 1);
+    size_t nspans = (size_t)(len1 > len2 ? len1 : len2) / 2 + 1;
+    size_t buf_len = (size_t)len1 + len2 + 2;
+    size_t refs_size = nrefs * sizeof(struct token_ref);
+    size_t spans_size = nspans * sizeof(struct jfish_token);
+    char *work;
+
+    work = safe_malloc(refs_size + spans_size + buffers * buf_len * sizeof(JFISH_UNICODE), 1);
+    if (!work) {
+        return NULL;
+    }
+    *refs1 = (struct token_ref *)work;
+    *refs2 = *refs1 + (len1 / 2 + 1);
+    *spans = (struct jfish_token *)(work + refs_size);
+    *joined = (JFISH_UNICODE *)(work + refs_size + spans_size);
+    return work;
+}
+
+
+double token_sort_similarity(const JFISH_UNICODE *s1, int len1,
+                             const JFISH_UNICODE *s2, int len2, int metric)
+{
+    struct token_ref *refs1, *refs2;
+    struct jfish_token *spans;
+    JFISH_UNICODE *joined;
+    int n1, n2, j1, j2;
+    double result;
+    void *work;
+
+    work = token_workspace(len1, len2, 1, &refs1, &refs2, &spans, &joined);
+    if (!work) {
+        return -100;
+    }
+
+    n1 = token_refs(s1, len1, spans, refs1);
+    n2 = token_refs(s2, len2, spans, refs2);
+    qsort(refs1, n1, sizeof(struct token_ref), token_qsort_cmp);
+    qsort(refs2, n2, sizeof(struct token_ref), token_qsort_cmp);
+
+    j1 = token_join(joined, 0, refs1, n1);
+    j2 = token_join(joined + j1, 0, refs2, n2);
+
+    result = token_score(metric, joined, j1, joined + j1, j2);
+    free(work);
+    return result;
+}
+
+
+/* Sort and drop duplicate tokens in place, returning the new count. */
+static int token_set(struct token_ref *refs, int n)
+{
+    int i, out = 0;
+
+    qsort(refs, n, sizeof(struct token_ref), token_qsort_cmp);
+    for (i = 0; i < n; i++) {
+        if (!out || token_cmp(&refs[out - 1], &refs[i])) {
+            refs[out++] = refs[i];
+        }
+    }
+    return out;
+}
+
+
+double token_set_similarity(const JFISH_UNICODE *s1, int len1,
+                            const JFISH_UNICODE *s2, int len2, int metric)
+{
+    struct token_ref *refs1, *refs2;
+    struct jfish_token *spans;
+    JFISH_UNICODE *joined, *t0, *t1, *t2;
+    int n1, n2, i, j, c, ndiff1, ndiff2;
+    int t0_len, t1_len, t2_len;
+    double sim01, sim02, sim12;
+    void *work;
+
+    work = token_workspace(len1, len2, 3, &refs1, &refs2, &spans, &joined);
+    if (!work) {
+        return -100;
+    }
+    t0 = joined;
+    t1 = joined + (len1 + len2 + 2);
+    t2 = t1 + (len1 + len2 + 2);
+
+    n1 = token_set(refs1, token_refs(s1, len1, spans, refs1));
+    n2 = token_set(refs2, token_refs(s2, len2, spans, refs2));
+
+    /* merge the sorted sets: the intersection is joined straight into t0,
+     * the tokens unique to each side are compacted to the front of their
+     * own array */
+    t0_len = 0;
+    ndiff1 = ndiff2 = 0;
+    for (i = 0, j = 0; i < n1 || j < n2; ) {
+        c = (i == n1) ? 1 : (j == n2) ? -1 : token_cmp(&refs1[i], &refs2[j]);
+        if (c == 0) {
+            t0_len = token_join(t0, t0_len, &refs1[i], 1);
+            i++;
+            j++;
+        } else if (c < 0) {
+            refs1[ndiff1++] = refs1[i++];
+        } else {
+            refs2[ndiff2++] = refs2[j++];
+        }
+    }
+
+    memcpy(t1, t0, t0_len * sizeof(JFISH_UNICODE));
+    memcpy(t2, t0, t0_len * sizeof(JFISH_UNICODE));
+    t1_len = token_join(t1, t0_len, refs1, ndiff1);
+    t2_len = token_join(t2, t0_len, refs2, ndiff2);
+
+    sim01 = token_score(metric, t0, t0_len, t1, t1_len);
+    sim02 = token_score(metric, t0, t0_len, t2, t2_len);
+    sim12 = token_score(metric, t1, t1_len, t2, t2_len);
+    free(work);
+
+    if (sim01 < -1 || sim02 < -1 || sim12 < -1) {
+        return -100;
+    }
+    if (sim02 > sim01) sim01 = sim02;
+    if (sim12 > sim01) sim01 = sim12;
+    return sim01;
+}
+
+
+/* token_score() of the query's token against (str, len). */
+static double token_query_score(int metric, const struct jellyfish_query *query, int query_len,
+                                const JFISH_UNICODE *str, int len)
+{
+    int dist;
+
+    if (metric == JFISH_TOKEN_JARO_WINKLER) {
+        /* Jaro-Winkler is symmetric, so the query may be either side */
+        return jellyfish_query_jaro_winkler(query, str, len, 0);
+    }
+
+    dist = jellyfish_query_levenshtein(query, str, len);
+    if (dist < 0) {
+        return -100;
+    }
+    return 1.0 - (double)dist / (query_len > len ? query_len : len);
+}
+
+
+/*
+  Best token alignment (Monge-Elkan): every token of the string with fewer
+  tokens is matched against all tokens of the other and the best scores are
+  averaged.  Each of those tokens is compiled once into a jellyfish_query
+  and the other side's tokens are scored through it straight from their
+  spans, so no copies are made in the inner loop.
+*/
+double token_alignment_similarity(const JFISH_UNICODE *s1, int len1,
+                                  const JFISH_UNICODE *s2, int len2, int metric)
+{
+    struct token_ref *refs1, *refs2, *tmp;
+    struct jfish_token *spans;
+    struct jellyfish_query *query;
+    JFISH_UNICODE *joined;
+    int n1, n2, i, j, tmp_n;
+    double best, score, total = 0;
+    void *work;
+
+    work = token_workspace(len1, len2, 0, &refs1, &refs2, &spans, &joined);
+    if (!work) {
+        return -100;
+    }
+
+    n1 = token_refs(s1, len1, spans, refs1);
+    n2 = token_refs(s2, len2, spans, refs2);
+    if (n1 > n2) {
+        tmp = refs1; refs1 = refs2; refs2 = tmp;
+        tmp_n = n1; n1 = n2; n2 = tmp_n;
+    }
+
+    for (i = 0; i < n1; i++) {
+        query = jellyfish_query_create(refs1[i].str, refs1[i].len);
+        if (!query) {
+            total = -100;
+            break;
+        }
+        best = 0;
+        for (j = 0; j < n2; j++) {
+            score = token_query_score(metric, query, refs1[i].len, refs2[j].str, refs2[j].len);
+            if (score < -1) {
+                break;
+            }
+            if (score > best) {
+                best = score;
+            }
+        }
+        jellyfish_query_free(query);
+        if (j < n2) {
+            total = -100;
+            break;
+        }
+        total += best;
+    }
+
+    free(work);
+    if (total < -1) {
+        return -100;
+    }
+    return n1 ? total / n1 : 0;
+}
@@ -0,0 +1,251 @@
+#include "jellyfish.h"
+#include <string.h>
+#include <stdlib.h>
+
+/*
+  Top-k nearest candidates.
+
+  The k best candidates seen so far are kept in a bounded heap with the
+  worst of them at the root.  Once the heap is full the root is the score a
+  candidate has to beat, and it is passed down as the cutoff: the maximum
+  distance for jellyfish_query_levenshtein_bounded(), which abandons the
+  scan once the distance is known to be too large, or the minimum score for
+  jellyfish_query_jaro_winkler_threshold(), which rejects most candidates
+  from their lengths and character histograms alone.  The cutoff only
+  tightens as better candidates arrive.
+
+  metric is JFISH_TOKEN_LEVENSHTEIN (smaller distances are better) or
+  JFISH_TOKEN_JARO_WINKLER (larger similarities are better).  Ties go to
+  the lower candidate index, so the parallel version, which merges one heap
+  per thread, returns exactly the same matches.
+*/
+
+struct topk_heap {
+    struct jfish_match *items;
+    int size;
+    int k;
+    int metric;
+};
+
+struct topk_search {
+    int metric;
+    struct jellyfish_query *query;
+    int query_len;
+    const JFISH_UNICODE *const *candidates;
+    const int *lens;
+    int count;
+    int k;
+    struct jfish_match *heaps;
+    int *sizes;         /* per thread, -1 if its scan failed */
+};
+
+
+/* non-zero if a ranks strictly before b */
+static int match_better(int metric, const struct jfish_match *a, const struct jfish_match *b)
+{
+    if (a->score != b->score) {
+        return metric == JFISH_TOKEN_LEVENSHTEIN ? a->score < b->score : a->score > b->score;
+    }
+    return a->index < b->index;
+}
+
+
+static int match_cmp_distance(const void *a, const void *b)
+{
+    return match_better(JFISH_TOKEN_LEVENSHTEIN, a, b) ? -1 : 1;
+}
+
+
+static int match_cmp_similarity(const void *a, const void *b)
+{
+    return match_better(JFISH_TOKEN_JARO_WINKLER, a, b) ? -1 : 1;
+}
+
+
+/* Offer a match to the heap, keeping the k best with the worst at the root. */
+static void heap_offer(struct topk_heap *heap, int index, double score)
+{
+    struct jfish_match *items = heap->items;
+    struct jfish_match m, tmp;
+    int i, child;
+
+    m.index = index;
+    m.score = score;
+
+    if (heap->size < heap->k) {
+        i = heap->size++;
+        items[i] = m;
+        while (i > 0 && match_better(heap->metric, &items[(i - 1) / 2], &items[i])) {
+            tmp = items[i];
+            items[i] = items[(i - 1) / 2];
+            items[(i - 1) / 2] = tmp;
+            i = (i - 1) / 2;
+        }
+        return;
+    }
+
+    if (!match_better(heap->metric, &m, &items[0])) {
+        return;
+    }
+    items[0] = m;
+    i = 0;
+    for (;;) {
+        child = 2 * i + 1;
+        if (child >= heap->size) {
+            break;
+        }
+        if (child + 1 < heap->size && match_better(heap->metric, &items[child], &items[child + 1])) {
+            child++;
+        }
+        if (!match_better(heap->metric, &items[i], &items[child])) {
+            break;
+        }
+        tmp = items[i];
+        items[i] = items[child];
+        items[child] = tmp;
+        i = child;
+    }
+}
+
+
+/* Scan candidates [lo, hi) into heap.  Returns 0 on allocation failure. */
+static int topk_scan(struct topk_search *search, struct topk_heap *heap, int lo, int hi)
+{
+    const struct jellyfish_query *query = search->query;
+    int i, distance, max_distance;
+    double score, min_score;
+
+    for (i = lo; i < hi; i++) {
+        if (search->metric == JFISH_TOKEN_LEVENSHTEIN) {
+            if (heap->size < heap->k) {
+                max_distance = search->query_len + search->lens[i];
+            } else if (heap->items[0].score == 0) {
+                break;
+            } else {
+                max_distance = (int)heap->items[0].score - 1;
+            }
+            distance = jellyfish_query_levenshtein_bounded(query, search->candidates[i],
+                                                           search->lens[i], max_distance);
+            if (distance < 0) {
+                return 0;
+            }
+            if (distance <= max_distance) {
+                heap_offer(heap, i, distance);
+            }
+        } else {
+            if (heap->size < heap->k) {
+                min_score = 0;
+            } else if (heap->items[0].score >= 1.0) {
+                break;
+            } else {
+                min_score = heap->items[0].score;
+            }
+            score = jellyfish_query_jaro_winkler_threshold(query, search->candidates[i],
+                                                           search->lens[i], 0, min_score);
+            if (score < -1) {
+                return 0;
+            }
+            heap_offer(heap, i, score);
+        }
+    }
+    return 1;
+}
+
+
+static void topk_worker(void *arg, int index, int nthreads)
+{
+    struct topk_search *search = arg;
+    struct topk_heap heap;
+    int chunk = (search->count + nthreads - 1) / nthreads;
+    int lo = MIN(search->count, index * chunk);
+    int hi = MIN(search->count, lo + chunk);
+
+    heap.items = search->heaps + (size_t)index * search->k;
+    heap.size = 0;
+    heap.k = search->k;
+    heap.metric = search->metric;
+
+    search->sizes[index] = topk_scan(search, &heap, lo, hi) ? heap.size : -1;
+}
+
+
+/*
+  Write the (up to) k best candidates for query into out, best first, and
+  return how many were written, or -1 on allocation failure.  Candidates
+  are split over nthreads threads, each keeping its own heap; the heaps are
+  merged at the end.
+*/
+int jellyfish_topk_parallel(int metric, const JFISH_UNICODE *query, int query_len,
+                            const JFISH_UNICODE *const *candidates, const int *lens, int count,
+                            int k, struct jfish_match *out, int nthreads)
+{
+    struct topk_search search;
+    struct topk_heap merged;
+    int t, i, ret = -1;
+
+    if (k < 1 || count < 1) {
+        return 0;
+    }
+    if (k > count) {
+        k = count;
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    if (nthreads > count) {
+        nthreads = count;
+    }
+    if (nthreads > JFISH_MAX_THREADS) {
+        nthreads = JFISH_MAX_THREADS;
+    }
+
+    memset(&search, 0, sizeof(search));
+    search.metric = metric;
+    search.query_len = query_len;
+    search.candidates = candidates;
+    search.lens = lens;
+    search.count = count;
+    search.k = k;
+
+    search.query = jellyfish_query_create(query, query_len);
+    search.heaps = safe_matrix_malloc(nthreads, k, sizeof(struct jfish_match));
+    search.sizes = safe_malloc(nthreads, sizeof(int));
+    if (!search.query || !search.heaps || !search.sizes) {
+        goto cleanup;
+    }
+
+    jfish_parallel_run(topk_worker, &search, nthreads);
+    for (t = 0; t < nthreads; t++) {
+        if (search.sizes[t] < 0) {
+            goto cleanup;
+        }
+    }
+
+    merged.items = out;
+    merged.size = 0;
+    merged.k = k;
+    merged.metric = metric;
+    for (t = 0; t < nthreads; t++) {
+        for (i = 0; i < search.sizes[t]; i++) {
+            heap_offer(&merged, search.heaps[(size_t)t * k + i].index,
+                       search.heaps[(size_t)t * k + i].score);
+        }
+    }
+    qsort(out, merged.size, sizeof(struct jfish_match),
+          metric == JFISH_TOKEN_LEVENSHTEIN ? match_cmp_distance : match_cmp_similarity);
+    ret = merged.size;
+
+ cleanup:
+    jellyfish_query_free(search.query);
+    free(search.heaps);
+    free(search.sizes);
+    return ret;
+}
+
+
+int jellyfish_topk(int metric, const JFISH_UNICODE *query, int query_len,
+                   const JFISH_UNICODE *const *candidates, const int *lens, int count,
+                   int k, struct jfish_match *out)
+{
+    return jellyfish_topk_parallel(metric, query, query_len, candidates, lens, count, k, out, 1);
+}
@@ -0,0 +1,441 @@
+#include "jellyfish.h"
+#include <string.h>
+#include <stdlib.h>
+
+/*
+  UTF-8 entry points for C callers that hold byte slices.
+
+  Inputs are first checked for bytes >= 0x80, eight at a time.  When both
+  strings are pure ASCII the short-string kernels below run directly on the
+  bytes: Levenshtein as a single-word Myers bit-vector scan and Jaro with
+  bit-mask flags, both for strings of up to 64 characters, and Hamming at
+  any length.  Anything else is turned into JFISH_UNICODE in a workspace
+  (on the stack for up to UTF8_STACK characters), widening ASCII bytes
+  directly and decoding only when multi-byte sequences are present, and
+  handed to the regular implementation.
+
+  Malformed sequences decode one byte at a time to U+DC80..U+DCFF, as
+  Python's "surrogateescape" handler does, so an invalid byte only ever
+  equals the same invalid byte.
+*/
+
+#define UTF8_STACK 128
+#define UTF8_ASCII_MASK 0x8080808080808080ULL
+
+struct utf8_buffer {
+    JFISH_UNICODE stack[UTF8_STACK];
+    JFISH_UNICODE *str;
+    int len;
+};
+
+
+static int utf8_is_ascii(const char *str, size_t len)
+{
+    uint64_t word, acc = 0;
+    size_t i;
+
+    for (i = 0; i + 8 <= len; i += 8) {
+        memcpy(&word, str + i, 8);
+        acc |= word;
+    }
+    for (; i < len; i++) {
+        acc |= (unsigned char)str[i];
+    }
+    return !(acc & UTF8_ASCII_MASK);
+}
+
+
+/* Decode the character at *pos and advance past it. */
+static JFISH_UNICODE utf8_next(const unsigned char *s, size_t len, size_t *pos)
+{
+    size_t i = *pos, n, k;
+    uint32_t c = s[i], min;
+
+    if (c < 0x80) {
+        *pos = i + 1;
+        return c;
+    }
+    if (c >= 0xC2 && c <= 0xDF) {
+        n = 1;
+        min = 0x80;
+        c &= 0x1F;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        n = 2;
+        min = 0x800;
+        c &= 0x0F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        n = 3;
+        min = 0x10000;
+        c &= 0x07;
+    } else {
+        goto invalid;
+    }
+    if (i + n >= len) {
+        goto invalid;
+    }
+    for (k = 1; k <= n; k++) {
+        if ((s[i + k] & 0xC0) != 0x80) {
+            goto invalid;
+        }
+        c = (c << 6) | (s[i + k] & 0x3F);
+    }
+    if (c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
+        goto invalid;
+    }
+    *pos = i + n + 1;
+    return c;
+
+ invalid:
+    *pos = i + 1;
+    return 0xDC00 + s[i];
+}
+
+
+/*
+  Decode len bytes of UTF-8 into out, which must hold len characters, and
+  return the number of characters written.
+*/
+size_t jfish_utf8_decode(const char *str, size_t len, JFISH_UNICODE *out)
+{
+    const unsigned char *s = (const unsigned char *)str;
+    size_t pos = 0, n = 0;
+
+    while (pos < len) {
+        if (s[pos] < 0x80) {
+            out[n++] = s[pos++];
+        } else {
+            out[n++] = utf8_next(s, len, &pos);
+        }
+    }
+    return n;
+}
+
+
+/* Write c as UTF-8 into out (up to 4 bytes) and return the byte count. */
+int jfish_utf8_encode(JFISH_UNICODE c, char *out)
+{
+    if (c < 0x80) {
+        out[0] = (char)c;
+        return 1;
+    } else if (c < 0x800) {
+        out[0] = (char)(0xC0 | (c >> 6));
+        out[1] = (char)(0x80 | (c & 0x3F));
+        return 2;
+    } else if (c < 0x10000) {
+        out[0] = (char)(0xE0 | (c >> 12));
+        out[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (c & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (c >> 18));
+    out[1] = (char)(0x80 | ((c >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((c >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (c & 0x3F));
+    return 4;
+}
+
+
+/* Fill buf with str as JFISH_UNICODE.  Returns 0 on allocation failure. */
+static int utf8_widen(struct utf8_buffer *buf, const char *str, size_t len, int ascii)
+{
+    size_t i;
+
+    buf->str = buf->stack;
+    if (len > UTF8_STACK) {
+        buf->str = safe_malloc(len, sizeof(JFISH_UNICODE));
+        if (!buf->str) {
+            return 0;
+        }
+    }
+    if (ascii) {
+        for (i = 0; i < len; i++) {
+            buf->str[i] = (unsigned char)str[i];
+        }
+        buf->len = (int)len;
+    } else {
+        buf->len = (int)jfish_utf8_decode(str, len, buf->str);
+    }
+    return 1;
+}
+
+
+static void utf8_release(struct utf8_buffer *buf)
+{
+    if (buf->str != buf->stack) {
+        free(buf->str);
+    }
+}
+
+
+/*
+  Widen both strings, returning 0 (with nothing left to release) on
+  allocation failure.
+*/
+static int utf8_widen_pair(struct utf8_buffer *b1, const char *s1, size_t len1,
+                           struct utf8_buffer *b2, const char *s2, size_t len2)
+{
+    int ascii = utf8_is_ascii(s1, len1) && utf8_is_ascii(s2, len2);
+
+    if (!utf8_widen(b1, s1, len1, ascii)) {
+        return 0;
+    }
+    if (!utf8_widen(b2, s2, len2, ascii)) {
+        utf8_release(b1);
+        return 0;
+    }
+    return 1;
+}
+
+
+/*
+  Levenshtein distance of two ASCII strings, the shorter (the pattern, m)
+  at most 64 bytes, with Myers' algorithm in a single machine word.  Only
+  the match table entries of characters that occur in either string are
+  cleared, so the table never needs a full reset.
+*/
+static int levenshtein_ascii(const unsigned char *p, int m, const unsigned char *t, int n)
+{
+    uint64_t peq[128];
+    uint64_t eq, pv = ~(uint64_t)0, mv = 0, xv, xh, ph, mh;
+    uint64_t high = (uint64_t)1 << (m - 1);
+    int i, score = m;
+
+    for (i = 0; i < m; i++) {
+        peq[p[i]] = 0;
+    }
+    for (i = 0; i < n; i++) {
+        peq[t[i]] = 0;
+    }
+    for (i = 0; i < m; i++) {
+        peq[p[i]] |= (uint64_t)1 << i;
+    }
+
+    for (i = 0; i < n; i++) {
+        eq = peq[t[i]];
+        xv = eq | mv;
+        xh = (((eq & pv) + pv) ^ pv) | eq;
+        ph = mv | ~(xh | pv);
+        mh = pv & xh;
+        if (ph & high) {
+            score++;
+        } else if (mh & high) {
+            score--;
+        }
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+    return score;
+}
+
+
+int levenshtein_distance_utf8(const char *s1, size_t len1, const char *s2, size_t len2)
+{
+    struct utf8_buffer b1, b2;
+    const unsigned char *u1 = (const unsigned char *)s1;
+    const unsigned char *u2 = (const unsigned char *)s2;
+    int result;
+
+    if (utf8_is_ascii(s1, len1) && utf8_is_ascii(s2, len2)) {
+        /* common affixes never change the distance */
+        while (len1 && len2 && *u1 == *u2) {
+            u1++;
+            u2++;
+            len1--;
+            len2--;
+        }
+        while (len1 && len2 && u1[len1 - 1] == u2[len2 - 1]) {
+            len1--;
+            len2--;
+        }
+        if (!len1 || !len2) {
+            return (int)(len1 + len2);
+        }
+        if (len1 <= len2 && len1 <= 64) {
+            return levenshtein_ascii(u1, (int)len1, u2, (int)len2);
+        }
+        if (len2 <= 64) {
+            return levenshtein_ascii(u2, (int)len2, u1, (int)len1);
+        }
+        s1 = (const char *)u1;
+        s2 = (const char *)u2;
+    }
+
+    if (!utf8_widen_pair(&b1, s1, len1, &b2, s2, len2)) {
+        return -1;
+    }
+    result = levenshtein_distance(b1.str, b1.len, b2.str, b2.len);
+    utf8_release(&b1);
+    utf8_release(&b2);
+    return result;
+}
+
+
+int damerau_levenshtein_distance_utf8(const char *s1, size_t len1, const char *s2, size_t len2)
+{
+    struct utf8_buffer b1, b2;
+    int result;
+
+    if (!utf8_widen_pair(&b1, s1, len1, &b2, s2, len2)) {
+        return -1;
+    }
+    result = damerau_levenshtein_distance(b1.str, b2.str, b1.len, b2.len);
+    utf8_release(&b1);
+    utf8_release(&b2);
+    return result;
+}
+
+
+int osa_distance_utf8(const char *s1, size_t len1, const char *s2, size_t len2)
+{
+    struct utf8_buffer b1, b2;
+    int result;
+
+    if (!utf8_widen_pair(&b1, s1, len1, &b2, s2, len2)) {
+        return -1;
+    }
+    result = osa_distance(b1.str, b1.len, b2.str, b2.len);
+    utf8_release(&b1);
+    utf8_release(&b2);
+    return result;
+}
+
+
+/* Hamming distance never needs a buffer: characters are decoded in step. */
+size_t hamming_distance_utf8(const char *s1, size_t len1, const char *s2, size_t len2)
+{
+    const unsigned char *u1 = (const unsigned char *)s1;
+    const unsigned char *u2 = (const unsigned char *)s2;
+    size_t distance = 0, i1 = 0, i2 = 0, i;
+
+    if (utf8_is_ascii(s1, len1) && utf8_is_ascii(s2, len2)) {
+        for (i = 0; i < len1 && i < len2; i++) {
+            distance += u1[i] != u2[i];
+        }
+        return distance + (len1 > len2 ? len1 - len2 : len2 - len1);
+    }
+
+    while (i1 < len1 && i2 < len2) {
+        if (utf8_next(u1, len1, &i1) != utf8_next(u2, len2, &i2)) {
+            distance++;
+        }
+    }
+    while (i1 < len1) {
+        utf8_next(u1, len1, &i1);
+        distance++;
+    }
+    while (i2 < len2) {
+        utf8_next(u2, len2, &i2);
+        distance++;
+    }
+    return distance;
+}
+
+
+/*
+  _jaro_winkler() for two non-empty ASCII strings of at most 64 bytes.
+  Positions of each byte in yang come from a match table, the flags are bit
+  masks, and the final weight is left to _jaro_winkler_weight(), which only
+  reads the first four characters of each string, so only those are widened.
+*/
+static double jaro_winkler_ascii(const unsigned char *ying, int ying_length,
+                                 const unsigned char *yang, int yang_length,
+                                 int long_tolerance, int winklerize)
+{
+    uint64_t peq[128];
+    uint64_t flagged = 0, window, candidates;
+    unsigned char matched[64];
+    JFISH_UNICODE ying_prefix[4], yang_prefix[4];
+    long search_range, lowlim, hilim;
+    long common_chars = 0, trans_count = 0;
+    int i, j;
+
+    for (j = 0; j < yang_length; j++) {
+        peq[yang[j]] = 0;
+    }
+    for (i = 0; i < ying_length; i++) {
+        peq[ying[i]] = 0;
+    }
+    for (j = 0; j < yang_length; j++) {
+        peq[yang[j]] |= (uint64_t)1 << j;
+    }
+
+    search_range = ying_length > yang_length ? ying_length : yang_length;
+    search_range = (search_range / 2) - 1;
+    if (search_range < 0) search_range = 0;
+
+    for (i = 0; i < ying_length; i++) {
+        lowlim = (i >= search_range) ? i - search_range : 0;
+        hilim = (i + search_range <= yang_length - 1) ? (i + search_range) : yang_length - 1;
+        if (lowlim > hilim) {
+            continue;
+        }
+        window = (hilim == 63) ? ~(uint64_t)0 : ((uint64_t)1 << (hilim + 1)) - 1;
+        window &= ~(((uint64_t)1 << lowlim) - 1);
+
+        candidates = peq[ying[i]] & window & ~flagged;
+        if (candidates) {
+            flagged |= candidates & (~candidates + 1);
+            matched[common_chars++] = ying[i];
+        }
+    }
+
+    if (!common_chars) {
+        return 0;
+    }
+
+    for (i = 0, j = 0; j < yang_length; j++) {
+        if (flagged & ((uint64_t)1 << j)) {
+            if (matched[i++] != yang[j]) {
+                trans_count++;
+            }
+        }
+    }
+    trans_count /= 2;
+
+    for (i = 0; i < 4; i++) {
+        ying_prefix[i] = i < ying_length ? ying[i] : 0;
+        yang_prefix[i] = i < yang_length ? yang[i] : 0;
+    }
+    return _jaro_winkler_weight(ying_prefix, ying_length, yang_prefix, yang_length,
+                                common_chars, trans_count, long_tolerance, winklerize);
+}
+
+
+static double jaro_winkler_utf8(const char *s1, size_t len1, const char *s2, size_t len2,
+                                int long_tolerance, int winklerize)
+{
+    struct utf8_buffer b1, b2;
+    double result;
+
+    if (!len1 || !len2) {
+        return 0;
+    }
+    if (len1 <= 64 && len2 <= 64 && utf8_is_ascii(s1, len1) && utf8_is_ascii(s2, len2)) {
+        return jaro_winkler_ascii((const unsigned char *)s1, (int)len1,
+                                  (const unsigned char *)s2, (int)len2,
+                                  long_tolerance, winklerize);
+    }
+
+    if (!utf8_widen_pair(&b1, s1, len1, &b2, s2, len2)) {
+        return -100;
+    }
+    result = _jaro_winkler(b1.str, b1.len, b2.str, b2.len, long_tolerance, winklerize);
+    utf8_release(&b1);
+    utf8_release(&b2);
+    return result;
+}
+
+
+double jaro_similarity_utf8(const char *s1, size_t len1, const char *s2, size_t len2)
+{
+    return jaro_winkler_utf8(s1, len1, s2, len2, 0, 0);
+}
+
+
+double jaro_winkler_similarity_utf8(const char *s1, size_t len1, const char *s2, size_t len2,
+                                    int long_tolerance)
+{
+    return jaro_winkler_utf8(s1, len1, s2, len2, long_tolerance, 1);
+}
@@ -0,0 +1,169 @@
+#include "jellyfish.h"
+#include <stdlib.h>
+
+/*
+  Levenshtein distance of one very long pair, computed over threads.
+
+  The matrix is cut into WAVEFRONT_TILE x WAVEFRONT_TILE tiles.  A tile
+  needs the row above it, the column to its left and the corner between
+  them, so all tiles of one anti-diagonal (tile row + tile column = d) are
+  independent once diagonal d - 1 is done; each diagonal is one
+  jfish_parallel_run() with its tiles split between the threads.
+
+  Only tile boundaries are kept, O(len1 + len2) in all:
+
+  - bottom[j]: the last row of the latest tile in j's tile column;
+  - right[i]: the last column of the latest tile in i's tile row;
+  - corner[c]: the top-left value for the next tile in tile column c.
+    Tile (r, c) knows it as the bottom of its own left column and stores
+    it before anything else on its diagonal can overwrite that column.
+
+  Each tile column and tile row has exactly one tile per diagonal, so no
+  two threads ever touch the same entries.
+*/
+
+#define WAVEFRONT_TILE 1024
+
+struct wavefront {
+    const JFISH_UNICODE *s1;
+    const JFISH_UNICODE *s2;
+    size_t len1;
+    size_t len2;
+    size_t tile_cols;
+    size_t diagonal;
+    size_t first_row;   /* tile row of the diagonal's first tile */
+    size_t tiles;       /* tiles on the diagonal */
+    unsigned *bottom;   /* len2 + 1 */
+    unsigned *right;    /* len1 + 1 */
+    unsigned *corner;   /* tile_cols */
+    unsigned *rows;     /* nthreads scratch rows of WAVEFRONT_TILE + 1 */
+};
+
+
+static void wavefront_tile(struct wavefront *wf, size_t r, size_t c, unsigned *row)
+{
+    size_t i0 = r * WAVEFRONT_TILE, i1 = MIN(wf->len1, i0 + WAVEFRONT_TILE);
+    size_t j0 = c * WAVEFRONT_TILE, j1 = MIN(wf->len2, j0 + WAVEFRONT_TILE);
+    size_t width = j1 - j0, i, j;
+    const JFISH_UNICODE *s2 = wf->s2 + j0;
+    unsigned diag, up, cur;
+    JFISH_UNICODE ch;
+
+    row[0] = r == 0 ? (unsigned)j0 : c == 0 ? (unsigned)i0 : wf->corner[c];
+    for (j = 1; j <= width; j++) {
+        row[j] = r == 0 ? (unsigned)(j0 + j) : wf->bottom[j0 + j];
+    }
+    /* the next tile down this column starts at our left column's bottom */
+    wf->corner[c] = c == 0 ? (unsigned)i1 : wf->right[i1];
+
+    for (i = i0 + 1; i <= i1; i++) {
+        ch = wf->s1[i - 1];
+        diag = row[0];
+        row[0] = c == 0 ? (unsigned)i : wf->right[i];
+        for (j = 1; j <= width; j++) {
+            up = row[j];
+            cur = diag + (ch != s2[j - 1]);
+            cur = MIN(cur, up + 1);
+            cur = MIN(cur, row[j - 1] + 1);
+            diag = up;
+            row[j] = cur;
+        }
+        wf->right[i] = row[width];
+    }
+
+    for (j = 1; j <= width; j++) {
+        wf->bottom[j0 + j] = row[j];
+    }
+}
+
+
+static void wavefront_worker(void *arg, int index, int nthreads)
+{
+    struct wavefront *wf = arg;
+    size_t chunk = (wf->tiles + nthreads - 1) / nthreads;
+    size_t lo = MIN(wf->tiles, index * chunk);
+    size_t hi = MIN(wf->tiles, lo + chunk);
+    unsigned *row = wf->rows + (size_t)index * (WAVEFRONT_TILE + 1);
+    size_t t, r;
+
+    for (t = lo; t < hi; t++) {
+        r = wf->first_row + t;
+        wavefront_tile(wf, r, wf->diagonal - r, row);
+    }
+}
+
+
+/*
+  levenshtein_distance() for long strings, split over nthreads threads and
+  using memory linear in the string lengths.  Pairs that fit in a single
+  tile go straight to levenshtein_distance().  Returns -1 on failed malloc.
+*/
+int levenshtein_distance_parallel(const JFISH_UNICODE *s1, size_t len1,
+                                  const JFISH_UNICODE *s2, size_t len2, int nthreads)
+{
+    struct wavefront wf;
+    size_t tile_rows, widest;
+    int threads, result;
+
+    while (len1 && len2 && *s1 == *s2) {
+        s1++;
+        s2++;
+        len1--;
+        len2--;
+    }
+    while (len1 && len2 && s1[len1 - 1] == s2[len2 - 1]) {
+        len1--;
+        len2--;
+    }
+    if (!len1 || !len2) {
+        return (int)(len1 + len2);
+    }
+    if (len1 <= WAVEFRONT_TILE && len2 <= WAVEFRONT_TILE) {
+        return levenshtein_distance(s1, (int)len1, s2, (int)len2);
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+
+    wf.s1 = s1;
+    wf.s2 = s2;
+    wf.len1 = len1;
+    wf.len2 = len2;
+    tile_rows = (len1 + WAVEFRONT_TILE - 1) / WAVEFRONT_TILE;
+    wf.tile_cols = (len2 + WAVEFRONT_TILE - 1) / WAVEFRONT_TILE;
+    widest = MIN(tile_rows, wf.tile_cols);
+    if ((size_t)nthreads > widest) {
+        nthreads = (int)widest;
+    }
+    if (nthreads > JFISH_MAX_THREADS) {
+        nthreads = JFISH_MAX_THREADS;
+    }
+
+    wf.bottom = safe_malloc(len2 + 1, sizeof(unsigned));
+    wf.right = safe_malloc(len1 + 1, sizeof(unsigned));
+    wf.corner = safe_malloc(wf.tile_cols, sizeof(unsigned));
+    wf.rows = safe_matrix_malloc(nthreads, WAVEFRONT_TILE + 1, sizeof(unsigned));
+    if (!wf.bottom || !wf.right || !wf.corner || !wf.rows) {
+        result = -1;
+        goto cleanup;
+    }
+
+    for (wf.diagonal = 0; wf.diagonal < tile_rows + wf.tile_cols - 1; wf.diagonal++) {
+        wf.first_row = wf.diagonal < wf.tile_cols ? 0 : wf.diagonal - wf.tile_cols + 1;
+        wf.tiles = MIN(wf.diagonal, tile_rows - 1) - wf.first_row + 1;
+        threads = (size_t)nthreads < wf.tiles ? nthreads : (int)wf.tiles;
+        if (threads == 1) {
+            wavefront_worker(&wf, 0, 1);
+        } else {
+            jfish_parallel_run(wavefront_worker, &wf, threads);
+        }
+    }
+    result = (int)wf.bottom[len2];
+
+ cleanup:
+    free(wf.bottom);
+    free(wf.right);
+    free(wf.corner);
+    free(wf.rows);
+    return result;
+}